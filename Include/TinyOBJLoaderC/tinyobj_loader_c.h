@@ -106,6 +106,14 @@ typedef struct {
  */
 typedef void (*file_reader_callback)(void *ctx, const char *filename, int is_mtl, const char *obj_filename, char **buf, size_t *len);
 
+/* Release a buffer returned by the file reader callback. Provided by the application.
+ *
+ * @param[in] ctx User provided context, as passed to the file reader callback.
+ * @param[in] buf Content of loaded file
+ * @param[in] len Size of content(file)
+ */
+void tinyobj_file_release_callback(void *ctx, char *buf, size_t len);
+
 /* Parse wavefront .obj
  * @param[out] attrib Attibutes
  * @param[out] shapes Array of parsed shapes
@@ -871,7 +879,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
 
   if (get_line_infos(buf, len, &line_infos, &num_lines) != 0) {
 		TINYOBJ_FREE(line_infos);
-    SDL_free(buf);
+    tinyobj_file_release_callback(ctx, buf, len);
     return TINYOBJ_ERROR_EMPTY;
   }
 
@@ -1090,7 +1098,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
   (*num_materials_out) = num_materials;
   (*materials_out) = materials;
 
-  SDL_free(buf);
+  tinyobj_file_release_callback(ctx, buf, len);
   return TINYOBJ_SUCCESS;
 }
 
@@ -1440,7 +1448,7 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
 
   /* 1. create line data */
   if (get_line_infos(buf, len, &line_infos, &num_lines) != 0) {
-    SDL_free(buf);
+    tinyobj_file_release_callback(ctx, buf, len);
     return TINYOBJ_ERROR_EMPTY;
   }
 
@@ -1714,7 +1722,7 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   (*materials_out) = materials;
   (*num_materials_out) = num_materials;
 
-  SDL_free(buf);
+  tinyobj_file_release_callback(ctx, buf, len);
   return TINYOBJ_SUCCESS;
 }
 
@@ -0,0 +1,79 @@
+#include "File.h"
+
+#ifdef MP_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int mp_file_open(mp_file_t *file, const char *path, uint32_t flags)
+{
+	memset(file, 0, sizeof(mp_file_t));
+
+	#ifdef MP_FILE_MMAP
+	if (flags & MP_FILE_FLAG_MAP)
+	{
+		int descriptor = open(path, O_RDONLY);
+		if (descriptor != -1)
+		{
+			struct stat status;
+			if (!fstat(descriptor, &status) && (status.st_size > 0))
+			{
+				int protection = PROT_READ;
+				if (flags & MP_FILE_FLAG_WRITABLE) { protection |= PROT_WRITE; }
+				void *data = mmap(NULL, status.st_size, protection, MAP_PRIVATE,
+								descriptor, 0);
+				if (data != MAP_FAILED)
+				{
+					if (flags & MP_FILE_FLAG_SEQUENTIAL)
+					{
+						madvise(data, status.st_size, MADV_SEQUENTIAL);
+					}
+					file->data = data;
+					file->length = status.st_size;
+					file->is_mapped = 1;
+				}
+			}
+			close(descriptor);
+			if (file->is_mapped) { return 0; }
+		}
+	}
+	#endif
+
+	// Fall back to reading the whole file into memory:
+	file->data = SDL_LoadFile(path, &(file->length));
+	if (!file->data)
+	{
+		file->length = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void mp_file_close(mp_file_t *file)
+{
+	if (!file->data) { return; }
+
+	#ifdef MP_FILE_MMAP
+	if (file->is_mapped) { munmap(file->data, file->length); }
+	else { SDL_free(file->data); }
+	#else
+	SDL_free(file->data);
+	#endif
+
+	memset(file, 0, sizeof(mp_file_t));
+}
+
+void mp_file_release_range(mp_file_t *file, const char *start, const char *end)
+{
+	#ifdef MP_FILE_MMAP
+	if (!file->is_mapped) { return; }
+
+	// Only whole pages inside the range can be dropped:
+	uintptr_t page_size = sysconf(_SC_PAGESIZE);
+	uintptr_t first = ((uintptr_t)start + page_size - 1) & ~(page_size - 1);
+	uintptr_t last = (uintptr_t)end & ~(page_size - 1);
+	if (last > first) { madvise((void *)first, last - first, MADV_DONTNEED); }
+	#endif
+}
@@ -0,0 +1,29 @@
+#ifndef MP_FILE_H
+#define MP_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <SDL2/SDL_rwops.h>
+
+#if defined(__linux__)
+#define MP_FILE_MMAP
+#endif
+
+#define MP_FILE_FLAG_MAP		(1 << 0)
+#define MP_FILE_FLAG_WRITABLE		(1 << 1)	// Private, copy-on-write mapping.
+#define MP_FILE_FLAG_SEQUENTIAL		(1 << 2)
+
+typedef struct
+{
+	char *data;
+	size_t length;
+	uint8_t is_mapped;	// Otherwise loaded into a heap buffer by SDL.
+} mp_file_t;
+
+int mp_file_open(mp_file_t *file, const char *path, uint32_t flags);
+void mp_file_close(mp_file_t *file);
+void mp_file_release_range(mp_file_t *file, const char *start, const char *end);
+
+#endif
@@ -0,0 +1,251 @@
+#include "Mesh-Adjacency.h"
+
+int mp_mesh_build_vertex_edges(mp_mesh_t *mesh, mp_mesh_vertex_edges_t *vertex_edges,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	uint32_t *cursors = NULL;
+	memset(vertex_edges, 0, sizeof(mp_mesh_vertex_edges_t));
+	vertex_edges->num_vertices = mesh->num_vertices;
+
+	vertex_edges->offsets = calloc((size_t)mesh->num_vertices + 1, sizeof(uint32_t));
+	vertex_edges->edges = malloc(((size_t)mesh->num_edges + 1) * sizeof(uint32_t));
+	cursors = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint32_t));
+	if (!vertex_edges->offsets || !vertex_edges->edges || !cursors)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex adjacency on mesh \"%s\".", mesh->name);
+		mp_mesh_vertex_edges_free(vertex_edges);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/* Counting sort of edges by "from". Scattering with atomic cursors leaves each vertex's
+	 * edges in arbitrary order, but the fan ordering afterwards makes the result exact: */
+	uint32_t *offsets = vertex_edges->offsets;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		__atomic_fetch_add(&(offsets[mp_mesh_get_edge_from(mesh, i)]), 1, __ATOMIC_RELAXED);
+	}
+	mp_mesh_adjacency_counts_to_offsets(offsets, mesh->num_vertices);
+	memcpy(cursors, offsets, mesh->num_vertices * sizeof(uint32_t));
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		uint32_t slot = __atomic_fetch_add(&(cursors[mp_mesh_get_edge_from(mesh, i)]), 1,
+									__ATOMIC_RELAXED);
+		vertex_edges->edges[slot] = i;
+	}
+
+	// Fan walks vary in cost, as with the manifold check:
+	#pragma omp parallel for schedule(dynamic, MP_MESH_MANIFOLD_CHUNK_SIZE)
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		mp_mesh_vertex_edges_order_fans(mesh, vertex_edges, i);
+	}
+
+	cleanup:
+	if (cursors) { free(cursors); }
+	return return_value;
+}
+
+void mp_mesh_vertex_edges_free(mp_mesh_vertex_edges_t *vertex_edges)
+{
+	if (vertex_edges->offsets) { free(vertex_edges->offsets); }
+	if (vertex_edges->edges) { free(vertex_edges->edges); }
+	memset(vertex_edges, 0, sizeof(mp_mesh_vertex_edges_t));
+}
+
+void mp_mesh_vertex_edges_order_fans(mp_mesh_t *mesh, mp_mesh_vertex_edges_t *vertex_edges,
+										uint32_t vertex)
+{
+	uint32_t *edges = vertex_edges->edges + vertex_edges->offsets[vertex];
+	uint32_t degree = mp_mesh_vertex_edges_get_degree(vertex_edges, vertex);
+	uint32_t placed = 0;
+
+	/* Walk each fan from its start, swapping its edges to the front. The first fan is the one
+	 * holding the vertex's first edge, later ones start from their lowest remaining edge, so
+	 * the order never depends on how the edges were scattered: */
+	while (placed < degree)
+	{
+		uint32_t start = edges[placed];
+		for (uint32_t i = placed + 1; i < degree; i++)
+		{
+			if (edges[i] < start) { start = edges[i]; }
+		}
+		if ((placed == 0) && (mesh->first_edge[vertex] < mesh->num_edges) &&
+			(mp_mesh_get_edge_from(mesh, mesh->first_edge[vertex]) == vertex))
+		{
+			start = mesh->first_edge[vertex];
+		}
+
+		// Walk back to the boundary, if there is one. Degree bounds broken fans:
+		uint32_t seed = start;
+		int64_t current_edge = start;
+		for (uint32_t step = 0; step < degree; step++)
+		{
+			int64_t previous_edge = mp_mesh_get_previous_vertex_edge(mesh, vertex,
+										current_edge);
+			if (previous_edge == -1) { break; }
+			previous_edge = mp_mesh_get_previous_vertex_edge(mesh, vertex, previous_edge);
+			if (previous_edge == start) { break; }
+			current_edge = previous_edge;
+		}
+		start = current_edge;
+
+		// Then forward around the fan, stopping at an edge already placed:
+		uint32_t fan_start = placed;
+		while (placed < degree)
+		{
+			uint32_t found = placed;
+			while ((found < degree) && (edges[found] != current_edge)) { found++; }
+			if (found == degree) { break; }
+			edges[found] = edges[placed];
+			edges[placed++] = current_edge;
+
+			current_edge = mp_mesh_get_next_vertex_edge(mesh, vertex, current_edge);
+			current_edge = mp_mesh_get_next_vertex_edge(mesh, vertex, current_edge);
+			if ((current_edge == -1) || (current_edge == start)) { break; }
+		}
+
+		// A broken fan can lead straight back to placed edges. Always place the seed:
+		if (placed == fan_start)
+		{
+			uint32_t found = placed;
+			while (edges[found] != seed) { found++; }
+			edges[found] = edges[placed];
+			edges[placed++] = seed;
+		}
+	}
+}
+
+int mp_mesh_build_vertex_faces(mp_mesh_t *mesh, uint8_t lod, mp_mesh_vertex_faces_t *vertex_faces,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	// Only the position indices are read, in either layout:
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, lod, &stride);
+	if (mp_mesh_build_vertex_faces_from_indices(indices, stride, mesh->num_faces[lod],
+					mesh->num_vertices, vertex_faces))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex faces on mesh \"%s\".", mesh->name);
+		return -1;
+	}
+	return 0;
+}
+
+int mp_mesh_build_vertex_faces_from_indices(const uint32_t *indices, uint32_t stride,
+	uint32_t num_faces, uint32_t num_vertices, mp_mesh_vertex_faces_t *vertex_faces)
+{
+	int return_value = 0;
+	uint32_t *cursors = NULL;
+	memset(vertex_faces, 0, sizeof(mp_mesh_vertex_faces_t));
+	vertex_faces->num_vertices = num_vertices;
+	uint32_t num_corners = num_faces * 3;
+
+	vertex_faces->offsets = calloc((size_t)num_vertices + 1, sizeof(uint32_t));
+	vertex_faces->faces = malloc(((size_t)num_corners + 1) * sizeof(uint32_t));
+	cursors = malloc(((size_t)num_vertices + 1) * sizeof(uint32_t));
+	if (!vertex_faces->offsets || !vertex_faces->faces || !cursors)
+	{
+		mp_mesh_vertex_faces_free(vertex_faces);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Counting sort of face corners by vertex, as for vertex edges:
+	uint32_t *offsets = vertex_faces->offsets;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		__atomic_fetch_add(&(offsets[mp_mesh_edge_from(indices, stride, i)]), 1,
+									__ATOMIC_RELAXED);
+	}
+	mp_mesh_adjacency_counts_to_offsets(offsets, num_vertices);
+	memcpy(cursors, offsets, num_vertices * sizeof(uint32_t));
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		uint32_t slot = __atomic_fetch_add(&(cursors[mp_mesh_edge_from(indices, stride, i)]),
+								1, __ATOMIC_RELAXED);
+		vertex_faces->faces[slot] = i / 3;
+	}
+
+	// Lists are short, so an insertion sort makes them deterministic:
+	#pragma omp parallel for schedule(dynamic, MP_MESH_MANIFOLD_CHUNK_SIZE)
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		uint32_t *faces = vertex_faces->faces + offsets[i];
+		uint32_t degree = offsets[i + 1] - offsets[i];
+		for (uint32_t j = 1; j < degree; j++)
+		{
+			uint32_t face = faces[j];
+			uint32_t k = j;
+			while ((k > 0) && (faces[k - 1] > face))
+			{
+				faces[k] = faces[k - 1];
+				k--;
+			}
+			faces[k] = face;
+		}
+	}
+
+	cleanup:
+	if (cursors) { free(cursors); }
+	return return_value;
+}
+
+void mp_mesh_vertex_faces_free(mp_mesh_vertex_faces_t *vertex_faces)
+{
+	if (vertex_faces->offsets) { free(vertex_faces->offsets); }
+	if (vertex_faces->faces) { free(vertex_faces->faces); }
+	memset(vertex_faces, 0, sizeof(mp_mesh_vertex_faces_t));
+}
+
+int mp_mesh_build_face_neighbours(mp_mesh_t *mesh, mp_mesh_face_neighbours_t *face_neighbours,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	face_neighbours->num_faces = mesh->num_faces[0];
+	face_neighbours->neighbours = malloc(((size_t)mesh->num_edges + 1) * sizeof(int32_t));
+	if (!face_neighbours->neighbours)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for face neighbours on mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Edges are ordered by face, so the other half's face is just its index over three:
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		int64_t other_half = mp_mesh_get_edge_other_half(mesh, i);
+		if (other_half == -1) { face_neighbours->neighbours[i] = -1; }
+		else { face_neighbours->neighbours[i] = (int32_t)(other_half / 3); }
+	}
+
+	return 0;
+}
+
+void mp_mesh_face_neighbours_free(mp_mesh_face_neighbours_t *face_neighbours)
+{
+	if (face_neighbours->neighbours) { free(face_neighbours->neighbours); }
+	memset(face_neighbours, 0, sizeof(mp_mesh_face_neighbours_t));
+}
+
+uint32_t mp_mesh_adjacency_counts_to_offsets(uint32_t *offsets, uint32_t count)
+{
+	// Exclusive prefix sum in place, with the total in offsets[count]:
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t current = offsets[i];
+		offsets[i] = total;
+		total += current;
+	}
+	offsets[count] = total;
+	return total;
+}
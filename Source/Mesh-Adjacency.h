@@ -0,0 +1,95 @@
+#ifndef MP_MESH_ADJACENCY_H
+#define MP_MESH_ADJACENCY_H
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+
+/* Outgoing edges of every vertex in compressed sparse row form. The edges of vertex v are
+ * edges[offsets[v]] to edges[offsets[v + 1] - 1], in fan order. Boundary fans start at the
+ * boundary edge, so the one-ring of a boundary vertex is the "to" vertex of each edge, plus
+ * the "from" vertex of the edge before the last one in its face. Vertices with more than one
+ * fan list each fan in turn: */
+typedef struct
+{
+	uint32_t num_vertices;
+	uint32_t *offsets;	// num_vertices + 1 entries.
+	uint32_t *edges;
+} mp_mesh_vertex_edges_t;
+
+// Faces of one level around each vertex in the same form, in ascending order of face index:
+typedef struct
+{
+	uint32_t num_vertices;
+	uint32_t *offsets;	// num_vertices + 1 entries.
+	uint32_t *faces;
+} mp_mesh_vertex_faces_t;
+
+// Dual graph: the face across each edge of each face, or -1 on a boundary edge:
+typedef struct
+{
+	uint32_t num_faces;
+	int32_t *neighbours;	// Three per face, in edge order.
+} mp_mesh_face_neighbours_t;
+
+typedef struct
+{
+	const uint32_t *current;
+	const uint32_t *end;
+} mp_mesh_adjacency_iterator_t;
+
+int mp_mesh_build_vertex_edges(mp_mesh_t *mesh, mp_mesh_vertex_edges_t *vertex_edges,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_vertex_edges_free(mp_mesh_vertex_edges_t *vertex_edges);
+void mp_mesh_vertex_edges_order_fans(mp_mesh_t *mesh, mp_mesh_vertex_edges_t *vertex_edges,
+										uint32_t vertex);
+int mp_mesh_build_vertex_faces(mp_mesh_t *mesh, uint8_t lod, mp_mesh_vertex_faces_t *vertex_faces,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_build_vertex_faces_from_indices(const uint32_t *indices, uint32_t stride,
+	uint32_t num_faces, uint32_t num_vertices, mp_mesh_vertex_faces_t *vertex_faces);
+void mp_mesh_vertex_faces_free(mp_mesh_vertex_faces_t *vertex_faces);
+int mp_mesh_build_face_neighbours(mp_mesh_t *mesh, mp_mesh_face_neighbours_t *face_neighbours,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_face_neighbours_free(mp_mesh_face_neighbours_t *face_neighbours);
+uint32_t mp_mesh_adjacency_counts_to_offsets(uint32_t *offsets, uint32_t count);
+
+static inline uint32_t mp_mesh_vertex_edges_get_degree(const mp_mesh_vertex_edges_t *vertex_edges,
+										uint32_t vertex)
+{
+	return vertex_edges->offsets[vertex + 1] - vertex_edges->offsets[vertex];
+}
+
+// Usage: for (it = begin(...); mp_mesh_adjacency_iterator_next(&it, &edge);) { ... }
+static inline mp_mesh_adjacency_iterator_t mp_mesh_vertex_edges_begin(
+			const mp_mesh_vertex_edges_t *vertex_edges, uint32_t vertex)
+{
+	mp_mesh_adjacency_iterator_t iterator;
+	iterator.current = vertex_edges->edges + vertex_edges->offsets[vertex];
+	iterator.end = vertex_edges->edges + vertex_edges->offsets[vertex + 1];
+	return iterator;
+}
+
+static inline uint32_t mp_mesh_vertex_faces_get_degree(const mp_mesh_vertex_faces_t *vertex_faces,
+										uint32_t vertex)
+{
+	return vertex_faces->offsets[vertex + 1] - vertex_faces->offsets[vertex];
+}
+
+static inline mp_mesh_adjacency_iterator_t mp_mesh_vertex_faces_begin(
+			const mp_mesh_vertex_faces_t *vertex_faces, uint32_t vertex)
+{
+	mp_mesh_adjacency_iterator_t iterator;
+	iterator.current = vertex_faces->faces + vertex_faces->offsets[vertex];
+	iterator.end = vertex_faces->faces + vertex_faces->offsets[vertex + 1];
+	return iterator;
+}
+
+static inline uint8_t mp_mesh_adjacency_iterator_next(mp_mesh_adjacency_iterator_t *iterator,
+										uint32_t *index)
+{
+	if (iterator->current == iterator->end) { return 0; }
+	*index = *(iterator->current++);
+	return 1;
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "Mesh-Buffers.h"
+
+int mp_mesh_build_gpu_buffers(mp_mesh_t *mesh, uint8_t lod, mp_mesh_gpu_buffers_t *buffers,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	uint32_t num_corners = mesh->num_faces[lod] * 3;
+	uint32_t num_chunks = (num_corners + MP_MESH_BUFFER_CHUNK_SIZE - 1) / MP_MESH_BUFFER_CHUNK_SIZE;
+	buffers->num_vertices = 0;
+	buffers->num_indices = num_corners;
+	buffers->owns_vertices = 0;
+	buffers->owns_quantised_vertices = 0;
+	buffers->owns_indices = 0;
+	uint8_t is_quantised = (mesh->quantised.positions != NULL);
+
+	if (buffers->indices && (buffers->index_size != 2) && (buffers->index_size != 4))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Index size must be 2 or 4 with your own index memory for mesh \"%s\".",
+			mesh->name);
+		return -1;
+	}
+
+	// Keep the load factor at or below one half:
+	uint64_t capacity = 1;
+	while (capacity < ((uint64_t)num_corners * 2)) { capacity <<= 1; }
+	uint64_t mask = capacity - 1;
+
+	uint32_t *table = malloc(capacity * sizeof(uint32_t));
+	uint32_t *representatives = malloc(((size_t)num_corners + 1) * sizeof(uint32_t));
+	uint32_t *vertex_ids = malloc(((size_t)num_corners + 1) * sizeof(uint32_t));
+	uint32_t *chunk_offsets = malloc(((size_t)num_chunks + 1) * sizeof(uint32_t));
+	if (!table || !representatives || !vertex_ids || !chunk_offsets)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for GPU buffers of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	#pragma omp parallel for
+	for (uint64_t i = 0; i < capacity; i++) { table[i] = MP_MESH_BUFFER_SLOT_EMPTY; }
+
+	/* Insert every corner, keyed on its index tuple. Slots are claimed with compare-and-swap,
+	 * then lowered to the first corner using the tuple, so vertex numbering is deterministic: */
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		uint32_t tuple[4];
+		mp_mesh_get_corner_tuple(mesh, lod, i, tuple);
+		uint64_t slot = mp_mesh_corner_tuple_hash(tuple) & mask;
+		while (1)
+		{
+			uint32_t current = __atomic_load_n(&(table[slot]), __ATOMIC_ACQUIRE);
+			if (current == MP_MESH_BUFFER_SLOT_EMPTY)
+			{
+				if (__atomic_compare_exchange_n(&(table[slot]), &current, i, 0,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) { break; }
+				continue;
+			}
+
+			uint32_t other[4];
+			mp_mesh_get_corner_tuple(mesh, lod, current, other);
+			if (mp_mesh_corner_tuples_equal(tuple, other))
+			{
+				while ((i < current) && !__atomic_compare_exchange_n(&(table[slot]),
+						&current, i, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		representatives[i] = mp_mesh_corner_tuple_find(mesh, lod, table, mask, i);
+	}
+
+	/* Number the first corner of each tuple in corner order: count per chunk, prefix sum over
+	 * chunks, then number within each chunk: */
+	#pragma omp parallel for
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t start = chunk * MP_MESH_BUFFER_CHUNK_SIZE;
+		uint32_t end = start + MP_MESH_BUFFER_CHUNK_SIZE;
+		if (end > num_corners) { end = num_corners; }
+		uint32_t count = 0;
+		for (uint32_t i = start; i < end; i++) { count += (representatives[i] == i); }
+		chunk_offsets[chunk] = count;
+	}
+	uint32_t num_vertices = 0;
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t count = chunk_offsets[chunk];
+		chunk_offsets[chunk] = num_vertices;
+		num_vertices += count;
+	}
+	buffers->num_vertices = num_vertices;
+
+	// Output memory, now that the sizes are known:
+	if (!buffers->index_size) { buffers->index_size = (num_vertices <= (UINT16_MAX + 1)) ? 2 : 4; }
+	if ((buffers->index_size == 2) && (num_vertices > (UINT16_MAX + 1)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" needs %u vertices, too many for 16-bit indices.",
+			mesh->name, num_vertices);
+		return_value = -1;
+		goto cleanup;
+	}
+	uint8_t has_vertex_memory = is_quantised ? (buffers->quantised_vertices != NULL) :
+							(buffers->vertices != NULL);
+	if (has_vertex_memory && (buffers->max_vertices < num_vertices))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" needs %u GPU vertices, but there is only room for %u.",
+			mesh->name, num_vertices, buffers->max_vertices);
+		return_value = -1;
+		goto cleanup;
+	}
+	if (is_quantised && !buffers->quantised_vertices)
+	{
+		buffers->quantised_vertices = mp_mesh_allocate_block(mesh,
+				((size_t)num_vertices + 1) * sizeof(mp_mesh_gpu_quantised_vertex_t));
+		buffers->owns_quantised_vertices = (buffers->quantised_vertices != NULL);
+		has_vertex_memory = buffers->owns_quantised_vertices;
+	}
+	if (!is_quantised && !buffers->vertices)
+	{
+		buffers->vertices = mp_mesh_allocate_block(mesh,
+				((size_t)num_vertices + 1) * sizeof(mp_mesh_gpu_vertex_t));
+		buffers->owns_vertices = (buffers->vertices != NULL);
+		has_vertex_memory = buffers->owns_vertices;
+	}
+	if (!buffers->indices)
+	{
+		buffers->indices = mp_mesh_allocate_block(mesh,
+				((size_t)num_corners + 1) * buffers->index_size);
+		buffers->owns_indices = (buffers->indices != NULL);
+	}
+	if (!has_vertex_memory || !buffers->indices)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for GPU buffers of mesh \"%s\".", mesh->name);
+		mp_mesh_gpu_buffers_free(mesh, buffers);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Each first corner writes its own vertex:
+	#pragma omp parallel for
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t start = chunk * MP_MESH_BUFFER_CHUNK_SIZE;
+		uint32_t end = start + MP_MESH_BUFFER_CHUNK_SIZE;
+		if (end > num_corners) { end = num_corners; }
+		uint32_t vertex_id = chunk_offsets[chunk];
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			if (representatives[i] != i) { continue; }
+			vertex_ids[i] = vertex_id;
+
+			uint32_t tuple[4];
+			mp_mesh_get_corner_tuple(mesh, lod, i, tuple);
+			if (is_quantised)
+			{
+				mp_mesh_build_gpu_quantised_vertex(mesh, tuple,
+						&(buffers->quantised_vertices[vertex_id++]));
+				continue;
+			}
+
+			mp_mesh_gpu_vertex_t vertex;
+			memset(&vertex, 0, sizeof(vertex));
+			vertex.position = mp_mesh_get_position(mesh, tuple[0]);
+			if (tuple[1] < mesh->num_normals) { vertex.normal = mesh->normals[tuple[1]]; }
+			if (tuple[2] < mesh->num_colours) { vertex.colour = mesh->colours[tuple[2]]; }
+			if (tuple[3] < mesh->num_uv_coordinates)
+			{
+				vertex.uv = mesh->uv_coordinates[tuple[3]];
+			}
+			buffers->vertices[vertex_id++] = vertex;
+		}
+	}
+
+	if (buffers->index_size == 2)
+	{
+		uint16_t *indices = buffers->indices;
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_corners; i++)
+		{
+			indices[i] = (uint16_t)vertex_ids[representatives[i]];
+		}
+	}
+	else
+	{
+		uint32_t *indices = buffers->indices;
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_corners; i++)
+		{
+			indices[i] = vertex_ids[representatives[i]];
+		}
+	}
+
+	cleanup:
+	if (table) { free(table); }
+	if (representatives) { free(representatives); }
+	if (vertex_ids) { free(vertex_ids); }
+	if (chunk_offsets) { free(chunk_offsets); }
+	return return_value;
+}
+
+void mp_mesh_gpu_buffers_free(mp_mesh_t *mesh, mp_mesh_gpu_buffers_t *buffers)
+{
+	// Caller-provided memory is left alone:
+	if (buffers->owns_vertices) { mp_mesh_free_block(mesh, buffers->vertices); }
+	if (buffers->owns_quantised_vertices)
+	{
+		mp_mesh_free_block(mesh, buffers->quantised_vertices);
+	}
+	if (buffers->owns_indices) { mp_mesh_free_block(mesh, buffers->indices); }
+	if (buffers->owns_vertices) { buffers->vertices = NULL; }
+	if (buffers->owns_quantised_vertices) { buffers->quantised_vertices = NULL; }
+	if (buffers->owns_indices) { buffers->indices = NULL; }
+	buffers->owns_vertices = 0;
+	buffers->owns_quantised_vertices = 0;
+	buffers->owns_indices = 0;
+}
+
+uint32_t mp_mesh_corner_tuple_find(mp_mesh_t *mesh, uint8_t lod, const uint32_t *table,
+						uint64_t mask, uint32_t corner)
+{
+	// The table is read-only here, and every corner was inserted:
+	uint32_t tuple[4];
+	mp_mesh_get_corner_tuple(mesh, lod, corner, tuple);
+	uint64_t slot = mp_mesh_corner_tuple_hash(tuple) & mask;
+	while (table[slot] != MP_MESH_BUFFER_SLOT_EMPTY)
+	{
+		uint32_t other[4];
+		mp_mesh_get_corner_tuple(mesh, lod, table[slot], other);
+		if (mp_mesh_corner_tuples_equal(tuple, other)) { return table[slot]; }
+		slot = (slot + 1) & mask;
+	}
+	return corner;
+}
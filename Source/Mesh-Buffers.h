@@ -0,0 +1,113 @@
+#ifndef MP_MESH_BUFFERS_H
+#define MP_MESH_BUFFERS_H
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+
+#define MP_MESH_BUFFER_CHUNK_SIZE	(1 << 16)	// Face corners per work chunk.
+#define MP_MESH_BUFFER_SLOT_EMPTY	UINT32_MAX
+
+// One GPU vertex per distinct (position, normal, colour, UV) index tuple:
+typedef struct
+{
+	mp_position_t position;
+	mp_normal_t normal;
+	#ifdef MP_NORMAL_OCT8
+	uint8_t padding[2];
+	#endif
+	mp_colour_t colour;
+	mp_uv_t uv;
+} mp_mesh_gpu_vertex_t;
+
+/* The same from a quantised mesh, with its 16-bit positions and UVs copied as they are. Shaders
+ * decode them with the minimum and scale in mesh quantised, and UVs as its uv_format: */
+typedef struct
+{
+	uint16_t position[3];
+	uint16_t padding;
+	mp_normal_t normal;
+	#ifdef MP_NORMAL_OCT8
+	uint8_t normal_padding[2];
+	#endif
+	mp_colour_t colour;
+	uint16_t uv[2];
+} mp_mesh_gpu_quantised_vertex_t;
+
+/* Interleaved vertex buffer and index buffer for one level. A quantised mesh fills
+ * quantised_vertices, and any other fills vertices. Set that and indices to use your own memory,
+ * or leave them NULL to allocate through the mesh allocator. Your own index memory needs room
+ * for three indices per face of index_size bytes, and max_vertices must be set with your own
+ * vertex memory (three per face is always enough): */
+typedef struct
+{
+	uint8_t index_size;		// 2 or 4 bytes, or 0 to use 2 bytes whenever possible.
+	uint32_t max_vertices;
+
+	uint32_t num_vertices;
+	mp_mesh_gpu_vertex_t *vertices;
+	mp_mesh_gpu_quantised_vertex_t *quantised_vertices;
+
+	uint32_t num_indices;
+	void *indices;
+
+	uint8_t owns_vertices;
+	uint8_t owns_quantised_vertices;
+	uint8_t owns_indices;
+} mp_mesh_gpu_buffers_t;
+
+int mp_mesh_build_gpu_buffers(mp_mesh_t *mesh, uint8_t lod, mp_mesh_gpu_buffers_t *buffers,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_gpu_buffers_free(mp_mesh_t *mesh, mp_mesh_gpu_buffers_t *buffers);
+uint32_t mp_mesh_corner_tuple_find(mp_mesh_t *mesh, uint8_t lod, const uint32_t *table,
+						uint64_t mask, uint32_t corner);
+
+// Position, normal, colour and UV indices of a face corner, in either layout:
+static inline void mp_mesh_get_corner_tuple(mp_mesh_t *mesh, uint8_t lod, uint32_t corner,
+									uint32_t tuple[4])
+{
+	if (mp_mesh_is_soa(mesh))
+	{
+		tuple[0] = mesh->soa.p[lod][corner];
+		tuple[1] = mesh->soa.n[lod][corner];
+		tuple[2] = mesh->soa.c[lod][corner];
+		tuple[3] = mesh->soa.u[lod][corner];
+		return;
+	}
+
+	const mp_face_t *face = &(mesh->faces[lod][corner / 3]);
+	tuple[0] = face->p[corner % 3];
+	tuple[1] = face->n[corner % 3];
+	tuple[2] = face->c[corner % 3];
+	tuple[3] = face->u[corner % 3];
+}
+
+// Quantised streams of a corner tuple, copied without decoding:
+static inline void mp_mesh_build_gpu_quantised_vertex(mp_mesh_t *mesh, const uint32_t tuple[4],
+							mp_mesh_gpu_quantised_vertex_t *vertex)
+{
+	const mp_mesh_quantised_t *quantised = &(mesh->quantised);
+	memset(vertex, 0, sizeof(mp_mesh_gpu_quantised_vertex_t));
+	memcpy(vertex->position, quantised->positions + ((size_t)tuple[0] * 3),
+							sizeof(vertex->position));
+	if (tuple[1] < mesh->num_normals) { vertex->normal = mesh->normals[tuple[1]]; }
+	if (tuple[2] < mesh->num_colours) { vertex->colour = mesh->colours[tuple[2]]; }
+	if (tuple[3] < mesh->num_uv_coordinates)
+	{
+		memcpy(vertex->uv, quantised->uv_coordinates + ((size_t)tuple[3] * 2),
+								sizeof(vertex->uv));
+	}
+}
+
+static inline uint64_t mp_mesh_corner_tuple_hash(const uint32_t tuple[4])
+{
+	return mp_mesh_edge_hash(((uint64_t)tuple[0] << 32) | tuple[1]) ^
+		mp_mesh_edge_hash((((uint64_t)tuple[2] << 32) | tuple[3]) + 0x9e3779b97f4a7c15ULL);
+}
+
+static inline uint8_t mp_mesh_corner_tuples_equal(const uint32_t a[4], const uint32_t b[4])
+{
+	return (a[0] == b[0]) && (a[1] == b[1]) && (a[2] == b[2]) && (a[3] == b[3]);
+}
+
+#endif
@@ -0,0 +1,314 @@
+#include "Mesh-Cache.h"
+
+#include <sys/stat.h>
+
+int mp_mesh_cache_read(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	char cache_path[NM_MAX_PATH_LENGTH + sizeof(MP_CACHE_EXTENSION)];
+	uint64_t source_size;
+	int64_t source_mtime_seconds;
+	int64_t source_mtime_nanoseconds;
+	mp_file_t file;
+	void *arrays[MP_CACHE_NUM_ARRAYS];
+	mp_cache_header_t expected;
+
+	if (mp_mesh_cache_get_path(mesh, cache_path, sizeof(cache_path)) ||
+		mp_mesh_cache_get_source_info(mesh, &source_size, &source_mtime_seconds,
+						&source_mtime_nanoseconds))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not locate cache for mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Map privately, so the mesh can still be modified without touching the file:
+	if (mp_file_open(&file, cache_path, MP_FILE_FLAG_MAP | MP_FILE_FLAG_WRITABLE))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not open cache file \"%s\".", cache_path);
+		return -1;
+	}
+
+	mp_cache_header_t *header = (mp_cache_header_t *)file.data;
+	if ((file.length < sizeof(mp_cache_header_t)) ||
+		memcmp(header->magic, MP_CACHE_MAGIC, sizeof(MP_CACHE_MAGIC)) ||
+		(header->version != MP_CACHE_VERSION) ||
+		(header->header_size != sizeof(mp_cache_header_t)) ||
+		(header->file_size != file.length))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Cache file \"%s\" is invalid or from another version.", cache_path);
+		mp_file_close(&file);
+		return -1;
+	}
+
+	/* A cache in the other edge layout, or welded, given normals or quantised differently, is
+	 * stale and rewritten: */
+	uint8_t is_welded = !!(mesh->flags & MP_MESH_FLAG_WELD_VERTICES);
+	uint8_t is_quantised = !!(mesh->flags & MP_MESH_FLAG_QUANTISE_ATTRIBUTES);
+	uint8_t generated_normals = (mesh->flags & MP_MESH_FLAG_GENERATE_NORMALS) ?
+							(mesh->normal_weighting + 1) : 0;
+	if (strncmp(header->source_path, mesh->path, NM_MAX_PATH_LENGTH) ||
+		(header->has_compact_edges != !!(mesh->flags & MP_MESH_FLAG_COMPACT_EDGES)) ||
+		(header->is_welded != is_welded) ||
+		(is_welded && (header->weld_epsilon != mesh->weld_epsilon)) ||
+		(header->generated_normals != generated_normals) ||
+		(header->is_quantised != is_quantised) ||
+		(is_quantised && (header->quantised.uv_format != mesh->uv_format)) ||
+		(header->source_size != source_size) ||
+		(header->source_mtime_seconds != source_mtime_seconds) ||
+		(header->source_mtime_nanoseconds != source_mtime_nanoseconds))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Cache file \"%s\" is out of date.", cache_path);
+		mp_file_close(&file);
+		return -1;
+	}
+
+	// Recompute the layout from the stored counts and make sure it matches:
+	mp_mesh_t layout;
+	memset(&layout, 0, sizeof(layout));
+	if (header->has_compact_edges) { layout.flags = MP_MESH_FLAG_COMPACT_EDGES; }
+	if (header->is_quantised) { layout.flags |= MP_MESH_FLAG_QUANTISE_ATTRIBUTES; }
+	layout.is_manifold = header->is_manifold;
+	layout.num_vertices = header->num_vertices;
+	layout.num_normals = header->num_normals;
+	layout.num_colours = header->num_colours;
+	layout.num_uv_coordinates = header->num_uv_coordinates;
+	layout.num_edges = header->num_edges;
+	layout.num_faces[0] = header->num_faces;
+	mp_mesh_cache_fill_header(&layout, &expected, arrays);
+
+	if (memcmp(header->element_sizes, expected.element_sizes, sizeof(expected.element_sizes)) ||
+		memcmp(header->offsets, expected.offsets, sizeof(expected.offsets)) ||
+		memcmp(header->sizes, expected.sizes, sizeof(expected.sizes)) ||
+		(expected.file_size != file.length) || !header->num_vertices || !header->num_faces)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Cache file \"%s\" has an inconsistent layout.", cache_path);
+		mp_file_close(&file);
+		return -1;
+	}
+
+	mp_mesh_free(mesh);
+
+	mesh->is_manifold = header->is_manifold;
+	mesh->has_normals = header->has_normals;
+	mesh->num_welded_vertices = header->num_welded_vertices;
+	mesh->num_vertices = header->num_vertices;
+	mesh->num_normals = header->num_normals;
+	mesh->num_colours = header->num_colours;
+	mesh->num_uv_coordinates = header->num_uv_coordinates;
+	mesh->num_edges = header->num_edges;
+
+	mesh->vertices = (mp_position_t *)(file.data + header->offsets[MP_CACHE_ARRAY_VERTICES]);
+	mesh->normals = (mp_normal_t *)(file.data + header->offsets[MP_CACHE_ARRAY_NORMALS]);
+	mesh->colours = (mp_colour_t *)(file.data + header->offsets[MP_CACHE_ARRAY_COLOURS]);
+	mesh->uv_coordinates = (mp_uv_t *)(file.data +
+				header->offsets[MP_CACHE_ARRAY_UV_COORDINATES]);
+	if (header->has_compact_edges)
+	{
+		mesh->twins = (uint32_t *)(file.data + header->offsets[MP_CACHE_ARRAY_TWINS]);
+	}
+	else
+	{
+		mesh->edges = (mp_edge_t *)(file.data + header->offsets[MP_CACHE_ARRAY_EDGES]);
+	}
+	mesh->first_edge = (uint32_t *)(file.data + header->offsets[MP_CACHE_ARRAY_FIRST_EDGE]);
+	if (header->is_quantised)
+	{
+		mesh->quantised = header->quantised;
+		mesh->quantised.positions = (uint16_t *)(file.data +
+				header->offsets[MP_CACHE_ARRAY_QUANTISED_POSITIONS]);
+		mesh->quantised.uv_coordinates = (uint16_t *)(file.data +
+				header->offsets[MP_CACHE_ARRAY_QUANTISED_UV_COORDINATES]);
+	}
+
+	// Only the base level is stored, so alias additional LOD levels to it as on allocation:
+	mesh->num_lod_levels = 1;
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		mesh->num_faces[i] = header->num_faces;
+		mesh->faces[i] = (mp_face_t *)(file.data + header->offsets[MP_CACHE_ARRAY_FACES]);
+	}
+
+	mesh->cache_file = file;
+	return 0;
+}
+
+int mp_mesh_cache_write(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	char cache_path[NM_MAX_PATH_LENGTH + sizeof(MP_CACHE_EXTENSION)];
+	char temporary_path[NM_MAX_PATH_LENGTH + sizeof(MP_CACHE_EXTENSION) + 4];
+	void *arrays[MP_CACHE_NUM_ARRAYS];
+	mp_cache_header_t header;
+	const uint8_t padding[MP_CACHE_ALIGNMENT] = { 0 };
+
+	if (mp_mesh_is_soa(mesh))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" must be in array-of-structures layout to cache.", mesh->name);
+		return -1;
+	}
+	if ((mesh->flags & MP_MESH_FLAG_QUANTISE_ATTRIBUTES) && !mesh->quantised.positions)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" must be quantised to cache with its quantise flag set.", mesh->name);
+		return -1;
+	}
+	if (mp_mesh_cache_get_path(mesh, cache_path, sizeof(cache_path)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Cache path for mesh \"%s\" is too long.", mesh->name);
+		return -1;
+	}
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", cache_path);
+
+	mp_mesh_cache_fill_header(mesh, &header, arrays);
+	if (mp_mesh_cache_get_source_info(mesh, &(header.source_size),
+		&(header.source_mtime_seconds), &(header.source_mtime_nanoseconds)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not get source file information for mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Write to a temporary file first, so a partial cache is never picked up:
+	FILE *file = fopen(temporary_path, "wb");
+	if (!file)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not open cache file \"%s\" for writing.", temporary_path);
+		return -1;
+	}
+
+	uint64_t position = sizeof(header);
+	int failed = (fwrite(&header, sizeof(header), 1, file) != 1);
+	for (int i = 0; (i < MP_CACHE_NUM_ARRAYS) && !failed; i++)
+	{
+		if ((header.offsets[i] - position) > 0)
+		{
+			failed |= (fwrite(padding, header.offsets[i] - position, 1, file) != 1);
+		}
+		if (header.sizes[i] > 0)
+		{
+			failed |= (fwrite(arrays[i], header.sizes[i], 1, file) != 1);
+		}
+		position = header.offsets[i] + header.sizes[i];
+	}
+	failed |= (fclose(file) != 0);
+
+	if (failed || rename(temporary_path, cache_path))
+	{
+		remove(temporary_path);
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not write cache file \"%s\".", cache_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+int mp_mesh_cache_get_path(mp_mesh_t *mesh, char *cache_path, size_t cache_path_length)
+{
+	int length = snprintf(cache_path, cache_path_length, "%s%s", mesh->path, MP_CACHE_EXTENSION);
+	if ((length < 0) || ((size_t)length >= cache_path_length)) { return -1; }
+	return 0;
+}
+
+int mp_mesh_cache_get_source_info(mp_mesh_t *mesh, uint64_t *size, int64_t *mtime_seconds,
+						int64_t *mtime_nanoseconds)
+{
+	struct stat status;
+	if (stat(mesh->path, &status)) { return -1; }
+
+	*size = status.st_size;
+	#ifdef __linux__
+	*mtime_seconds = status.st_mtim.tv_sec;
+	*mtime_nanoseconds = status.st_mtim.tv_nsec;
+	#else
+	*mtime_seconds = status.st_mtime;
+	*mtime_nanoseconds = 0;
+	#endif
+
+	return 0;
+}
+
+void mp_mesh_cache_fill_header(mp_mesh_t *mesh, mp_cache_header_t *header, void *arrays[MP_CACHE_NUM_ARRAYS])
+{
+	memset(header, 0, sizeof(mp_cache_header_t));
+	memcpy(header->magic, MP_CACHE_MAGIC, sizeof(MP_CACHE_MAGIC));
+	header->version = MP_CACHE_VERSION;
+	header->header_size = sizeof(mp_cache_header_t);
+	snprintf(header->source_path, NM_MAX_PATH_LENGTH, "%s", mesh->path);
+
+	header->is_manifold = mesh->is_manifold;
+	header->has_normals = mesh->has_normals;
+	header->has_compact_edges = !!(mesh->flags & MP_MESH_FLAG_COMPACT_EDGES);
+	header->is_welded = !!(mesh->flags & MP_MESH_FLAG_WELD_VERTICES);
+	if (header->is_welded) { header->weld_epsilon = mesh->weld_epsilon; }
+	if (mesh->flags & MP_MESH_FLAG_GENERATE_NORMALS)
+	{
+		header->generated_normals = mesh->normal_weighting + 1;
+	}
+	header->num_welded_vertices = mesh->num_welded_vertices;
+	header->num_vertices = mesh->num_vertices;
+	header->num_normals = mesh->num_normals;
+	header->num_colours = mesh->num_colours;
+	header->num_uv_coordinates = mesh->num_uv_coordinates;
+	header->num_edges = mesh->num_edges;
+	header->num_faces = mesh->num_faces[0];
+	header->is_quantised = !!(mesh->flags & MP_MESH_FLAG_QUANTISE_ATTRIBUTES);
+	if (header->is_quantised)
+	{
+		header->quantised = mesh->quantised;
+		header->quantised.positions = NULL;
+		header->quantised.uv_coordinates = NULL;
+	}
+
+	header->element_sizes[MP_CACHE_ARRAY_VERTICES] = sizeof(mp_position_t);
+	header->element_sizes[MP_CACHE_ARRAY_NORMALS] = sizeof(mp_normal_t);
+	header->element_sizes[MP_CACHE_ARRAY_COLOURS] = sizeof(mp_colour_t);
+	header->element_sizes[MP_CACHE_ARRAY_UV_COORDINATES] = sizeof(mp_uv_t);
+	header->element_sizes[MP_CACHE_ARRAY_FACES] = sizeof(mp_face_t);
+	header->element_sizes[MP_CACHE_ARRAY_EDGES] = sizeof(mp_edge_t);
+	header->element_sizes[MP_CACHE_ARRAY_TWINS] = sizeof(uint32_t);
+	header->element_sizes[MP_CACHE_ARRAY_FIRST_EDGE] = sizeof(uint32_t);
+	header->element_sizes[MP_CACHE_ARRAY_QUANTISED_POSITIONS] = 3 * sizeof(uint16_t);
+	header->element_sizes[MP_CACHE_ARRAY_QUANTISED_UV_COORDINATES] = 2 * sizeof(uint16_t);
+
+	uint64_t counts[MP_CACHE_NUM_ARRAYS];
+	counts[MP_CACHE_ARRAY_VERTICES] = mesh->num_vertices;
+	counts[MP_CACHE_ARRAY_NORMALS] = mesh->num_normals;
+	counts[MP_CACHE_ARRAY_COLOURS] = mesh->num_colours;
+	counts[MP_CACHE_ARRAY_UV_COORDINATES] = mesh->num_uv_coordinates;
+	counts[MP_CACHE_ARRAY_FACES] = mesh->num_faces[0];
+	counts[MP_CACHE_ARRAY_EDGES] = header->has_compact_edges ? 0 : mesh->num_edges;
+	counts[MP_CACHE_ARRAY_TWINS] = header->has_compact_edges ? mesh->num_edges : 0;
+	counts[MP_CACHE_ARRAY_FIRST_EDGE] = mesh->num_vertices;
+	counts[MP_CACHE_ARRAY_QUANTISED_POSITIONS] = header->is_quantised ? mesh->num_vertices : 0;
+	counts[MP_CACHE_ARRAY_QUANTISED_UV_COORDINATES] = header->is_quantised ?
+							mesh->num_uv_coordinates : 0;
+
+	arrays[MP_CACHE_ARRAY_VERTICES] = mesh->vertices;
+	arrays[MP_CACHE_ARRAY_NORMALS] = mesh->normals;
+	arrays[MP_CACHE_ARRAY_COLOURS] = mesh->colours;
+	arrays[MP_CACHE_ARRAY_UV_COORDINATES] = mesh->uv_coordinates;
+	arrays[MP_CACHE_ARRAY_FACES] = mesh->faces[0];
+	arrays[MP_CACHE_ARRAY_EDGES] = mesh->edges;
+	arrays[MP_CACHE_ARRAY_TWINS] = mesh->twins;
+	arrays[MP_CACHE_ARRAY_FIRST_EDGE] = mesh->first_edge;
+	arrays[MP_CACHE_ARRAY_QUANTISED_POSITIONS] = mesh->quantised.positions;
+	arrays[MP_CACHE_ARRAY_QUANTISED_UV_COORDINATES] = mesh->quantised.uv_coordinates;
+
+	// Every array starts on its own aligned boundary, so it can be used in place:
+	uint64_t offset = sizeof(mp_cache_header_t);
+	for (int i = 0; i < MP_CACHE_NUM_ARRAYS; i++)
+	{
+		offset = (offset + MP_CACHE_ALIGNMENT - 1) & ~((uint64_t)MP_CACHE_ALIGNMENT - 1);
+		header->offsets[i] = offset;
+		header->sizes[i] = counts[i] * header->element_sizes[i];
+		offset += header->sizes[i];
+	}
+	header->file_size = offset;
+}
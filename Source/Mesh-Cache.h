@@ -0,0 +1,74 @@
+#ifndef MP_MESH_CACHE_H
+#define MP_MESH_CACHE_H
+
+#include <stdio.h>
+
+#include <NM-Config/Config.h>
+
+#include "File.h"
+#include "Mesh.h"
+
+#define MP_CACHE_MAGIC		"MPCACHE"
+#define MP_CACHE_VERSION	6
+#define MP_CACHE_EXTENSION	".mpcache"
+#define MP_CACHE_ALIGNMENT	64
+
+enum
+{
+	MP_CACHE_ARRAY_VERTICES,
+	MP_CACHE_ARRAY_NORMALS,
+	MP_CACHE_ARRAY_COLOURS,
+	MP_CACHE_ARRAY_UV_COORDINATES,
+	MP_CACHE_ARRAY_FACES,
+	MP_CACHE_ARRAY_EDGES,
+	MP_CACHE_ARRAY_TWINS,
+	MP_CACHE_ARRAY_FIRST_EDGE,
+	MP_CACHE_ARRAY_QUANTISED_POSITIONS,
+	MP_CACHE_ARRAY_QUANTISED_UV_COORDINATES,
+	MP_CACHE_NUM_ARRAYS
+};
+
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t element_sizes[MP_CACHE_NUM_ARRAYS];	// Guards against struct layout changes.
+
+	// Source file the cache was built from:
+	char source_path[NM_MAX_PATH_LENGTH];
+	uint64_t source_size;
+	int64_t source_mtime_seconds;
+	int64_t source_mtime_nanoseconds;
+
+	uint8_t is_manifold;
+	uint8_t has_compact_edges;
+	uint8_t is_welded;
+	uint8_t generated_normals;	// Normal weighting plus one, or 0 if not generated.
+	uint8_t has_normals;
+	uint8_t is_quantised;		// Quantised arrays are empty unless set.
+	uint8_t padding[2];
+	float weld_epsilon;
+	uint32_t num_welded_vertices;
+	uint32_t num_vertices;
+	uint32_t num_normals;
+	uint32_t num_colours;
+	uint32_t num_uv_coordinates;
+	uint32_t num_edges;
+	uint32_t num_faces;
+	mp_mesh_quantised_t quantised;	// Without its pointers, which are the quantised arrays.
+
+	uint64_t file_size;
+	uint64_t offsets[MP_CACHE_NUM_ARRAYS];
+	uint64_t sizes[MP_CACHE_NUM_ARRAYS];
+} mp_cache_header_t;
+
+int mp_mesh_cache_read(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_cache_write(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+
+int mp_mesh_cache_get_path(mp_mesh_t *mesh, char *cache_path, size_t cache_path_length);
+int mp_mesh_cache_get_source_info(mp_mesh_t *mesh, uint64_t *size, int64_t *mtime_seconds,
+						int64_t *mtime_nanoseconds);
+void mp_mesh_cache_fill_header(mp_mesh_t *mesh, mp_cache_header_t *header, void *arrays[MP_CACHE_NUM_ARRAYS]);
+
+#endif
@@ -0,0 +1,653 @@
+#include "Mesh-Cluster-DAG.h"
+
+int mp_mesh_build_cluster_dag(mp_mesh_t *mesh, uint32_t max_vertices, uint32_t max_triangles,
+		mp_mesh_cluster_dag_t *dag, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	memset(dag, 0, sizeof(*dag));
+	if (!max_vertices) { max_vertices = MP_MESHLET_MAX_VERTICES; }
+	if (!max_triangles) { max_triangles = MP_MESHLET_MAX_TRIANGLES; }
+	if ((max_vertices < 3) || (max_vertices > MP_MESHLET_VERTEX_LIMIT) || (max_triangles < 1) ||
+		(max_triangles > MP_MESHLET_TRIANGLE_LIMIT))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Clusters of mesh \"%s\" need 3 to %d vertices and 1 to %d triangles.",
+			mesh->name, MP_MESHLET_VERTEX_LIMIT, MP_MESHLET_TRIANGLE_LIMIT);
+		return -1;
+	}
+
+	int return_value = 0;
+	mp_mesh_cluster_dag_builder_t builder;
+	memset(&builder, 0, sizeof(builder));
+	mp_mesh_cluster_group_result_t *results = NULL;
+	uint32_t num_results = 0;
+	uint32_t *group_clusters = NULL;
+	uint32_t *group_offsets = NULL;
+	uint32_t *current = NULL;
+	uint32_t num_current = 0;
+
+	uint32_t *vertex_owners = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint32_t));
+	if (!vertex_owners)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for the cluster DAG of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/******************************
+	 * Clusters of the base level *
+	 ******************************/
+
+	mp_mesh_vertex_faces_t vertex_faces;
+	if (mp_mesh_build_vertex_faces(mesh, 0, &vertex_faces, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, 0, &stride);
+	mp_mesh_meshlet_builder_t meshlet_builder;
+	uint8_t failed = (mp_mesh_meshlet_builder_init(&meshlet_builder, indices, stride,
+				mesh->num_faces[0], &vertex_faces, max_triangles) ||
+		mp_mesh_meshlet_builder_run(&meshlet_builder, max_vertices, max_triangles));
+	if (!failed)
+	{
+		mp_mesh_meshlets_t *output = &(meshlet_builder.output);
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < output->num_meshlets; i++)
+		{
+			mp_mesh_calculate_meshlet_bounds(mesh, output, &(output->meshlets[i]));
+		}
+		failed = mp_mesh_cluster_dag_append(&builder, output, 0);
+	}
+	mp_mesh_meshlet_builder_free(&meshlet_builder);
+	mp_mesh_vertex_faces_free(&vertex_faces);
+	if (failed)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for the cluster DAG of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/**********************************
+	 * Simplifying groups of clusters *
+	 **********************************/
+
+	mp_position_t minimum, maximum;
+	mp_mesh_calculate_bounds(mesh, &minimum, &maximum);
+	double x = (double)maximum.x - minimum.x;
+	double y = (double)maximum.y - minimum.y;
+	double z = (double)maximum.z - minimum.z;
+	double diagonal = sqrt((x * x) + (y * y) + (z * z));
+	double inverse_diagonal = (diagonal > 0.0) ? (1.0 / diagonal) : 1.0;
+
+	/* Each pass groups the clusters without parents, and simplifies every group into new
+	 * clusters. Clusters of groups that couldn't be simplified wait for the next pass, in a
+	 * different group, and the ones left when no group can be simplified are the roots: */
+	num_current = builder.dag.meshlets.num_meshlets;
+	uint32_t current_capacity = 0;
+	if (mp_mesh_cluster_dag_reserve((void **)&current, &current_capacity, num_current,
+								sizeof(uint32_t)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for the cluster DAG of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+	for (uint32_t i = 0; i < num_current; i++) { current[i] = i; }
+
+	while (num_current > 1)
+	{
+		group_clusters = malloc(((size_t)num_current + 1) * sizeof(uint32_t));
+		group_offsets = malloc(((size_t)num_current + 2) * sizeof(uint32_t));
+		uint32_t num_groups = 0;
+		if (!group_clusters || !group_offsets || mp_mesh_cluster_dag_group_clusters(mesh,
+			&(builder.dag), current, num_current, group_clusters, group_offsets,
+										&num_groups))
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for grouping clusters of mesh \"%s\".",
+				mesh->name);
+			return_value = -1;
+			goto cleanup;
+		}
+
+		// A vertex belongs to the one group using it, or is shared and locked:
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_vertices; i++) { vertex_owners[i] = MP_EDGE_NONE; }
+
+		const mp_mesh_meshlets_t *meshlets = &(builder.dag.meshlets);
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (uint32_t i = 0; i < num_groups; i++)
+		{
+			for (uint32_t j = group_offsets[i]; j < group_offsets[i + 1]; j++)
+			{
+				const mp_meshlet_t *meshlet = &(meshlets->meshlets[group_clusters[j]]);
+				for (uint32_t k = 0; k < meshlet->num_vertices; k++)
+				{
+					uint32_t vertex = meshlets->vertices[meshlet->vertex_offset + k];
+					uint32_t expected = MP_EDGE_NONE;
+					if (__atomic_compare_exchange_n(&(vertex_owners[vertex]), &expected, i, 0,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED) || (expected == i)) { continue; }
+					__atomic_store_n(&(vertex_owners[vertex]),
+						MP_MESH_SIMPLIFY_SHARED_VERTEX, __ATOMIC_RELAXED);
+				}
+			}
+		}
+
+		results = calloc((size_t)num_groups + 1, sizeof(mp_mesh_cluster_group_result_t));
+		num_results = num_groups;
+		if (!results)
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for simplifying clusters of mesh \"%s\".",
+				mesh->name);
+			return_value = -1;
+			goto cleanup;
+		}
+
+		#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed)
+		for (uint32_t i = 0; i < num_groups; i++)
+		{
+			if (mp_mesh_cluster_dag_simplify_group(mesh, &(builder.dag),
+				group_clusters + group_offsets[i], group_offsets[i + 1] - group_offsets[i],
+				vertex_owners, inverse_diagonal, max_vertices, max_triangles,
+								&(results[i]))) { failed = 1; }
+		}
+		if (failed)
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for simplifying clusters of mesh \"%s\".",
+				mesh->name);
+			return_value = -1;
+			goto cleanup;
+		}
+
+		/* Parents are added in group order, so the DAG doesn't depend on thread timing. The
+		 * clusters waiting for the next pass are gathered at the front of the current list: */
+		uint32_t first_parent = builder.dag.meshlets.num_meshlets;
+		uint32_t num_waiting = 0;
+		for (uint32_t i = 0; i < num_groups; i++)
+		{
+			const uint32_t *children = group_clusters + group_offsets[i];
+			uint32_t num_children = group_offsets[i + 1] - group_offsets[i];
+			if (!results[i].is_simplified)
+			{
+				for (uint32_t j = 0; j < num_children; j++) { current[num_waiting++] = children[j]; }
+				continue;
+			}
+
+			if (mp_mesh_cluster_dag_add_group(&builder, children, num_children,
+						&(results[i].builder.output), results[i].error))
+			{
+				snprintf(error_message, NM_MAX_ERROR_LENGTH,
+					"Could not allocate memory for the cluster DAG of mesh \"%s\".",
+					mesh->name);
+				return_value = -1;
+				goto cleanup;
+			}
+		}
+
+		for (uint32_t i = 0; i < num_results; i++)
+		{
+			mp_mesh_meshlet_builder_free(&(results[i].builder));
+		}
+		free(results);
+		results = NULL;
+		free(group_clusters);
+		group_clusters = NULL;
+		free(group_offsets);
+		group_offsets = NULL;
+
+		// Stops once no group could be simplified any further:
+		uint32_t num_parents = builder.dag.meshlets.num_meshlets - first_parent;
+		if (!num_parents) { break; }
+
+		// A group can split into more parents than it had children, so the list may grow:
+		if (mp_mesh_cluster_dag_reserve((void **)&current, &current_capacity,
+						num_waiting + num_parents, sizeof(uint32_t)))
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for the cluster DAG of mesh \"%s\".", mesh->name);
+			return_value = -1;
+			goto cleanup;
+		}
+		for (uint32_t i = 0; i < num_parents; i++) { current[num_waiting + i] = first_parent + i; }
+		num_current = num_waiting + num_parents;
+	}
+
+	for (uint32_t i = 0; i < builder.dag.meshlets.num_meshlets; i++)
+	{
+		uint32_t level = builder.dag.clusters[i].level;
+		if (level >= builder.dag.num_levels) { builder.dag.num_levels = level + 1; }
+	}
+	if (mp_mesh_cluster_dag_copy(mesh, dag, &(builder.dag)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for the cluster DAG of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	cleanup:
+	if (results)
+	{
+		for (uint32_t i = 0; i < num_results; i++)
+		{
+			mp_mesh_meshlet_builder_free(&(results[i].builder));
+		}
+		free(results);
+	}
+	if (group_clusters) { free(group_clusters); }
+	if (group_offsets) { free(group_offsets); }
+	if (vertex_owners) { free(vertex_owners); }
+	if (current) { free(current); }
+	mp_mesh_cluster_dag_builder_free(&builder);
+	return return_value;
+}
+
+void mp_mesh_cluster_dag_free(mp_mesh_t *mesh, mp_mesh_cluster_dag_t *dag)
+{
+	if (dag->meshlets.meshlets) { mp_mesh_free_block(mesh, dag->meshlets.meshlets); }
+	if (dag->meshlets.vertices) { mp_mesh_free_block(mesh, dag->meshlets.vertices); }
+	if (dag->meshlets.triangles) { mp_mesh_free_block(mesh, dag->meshlets.triangles); }
+	if (dag->meshlets.faces) { mp_mesh_free_block(mesh, dag->meshlets.faces); }
+	if (dag->clusters) { mp_mesh_free_block(mesh, dag->clusters); }
+	if (dag->groups) { mp_mesh_free_block(mesh, dag->groups); }
+	if (dag->group_children) { mp_mesh_free_block(mesh, dag->group_children); }
+	memset(dag, 0, sizeof(*dag));
+}
+
+int mp_mesh_cluster_dag_group_clusters(mp_mesh_t *mesh, const mp_mesh_cluster_dag_t *dag,
+		const uint32_t *clusters, uint32_t num_clusters, uint32_t *group_clusters,
+							uint32_t *group_offsets, uint32_t *num_groups)
+{
+	const mp_mesh_meshlets_t *meshlets = &(dag->meshlets);
+	int return_value = 0;
+	uint32_t *cursors = NULL;
+	uint32_t *vertex_clusters = NULL;
+	uint32_t *groups = malloc(((size_t)num_clusters + 1) * sizeof(uint32_t));
+	uint32_t *scores = calloc((size_t)num_clusters + 1, sizeof(uint32_t));
+	uint32_t *touched = malloc(((size_t)num_clusters + 1) * sizeof(uint32_t));
+	uint32_t *offsets = calloc((size_t)mesh->num_vertices + 1, sizeof(uint32_t));
+	if (!groups || !scores || !touched || !offsets)
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Clusters using each vertex, by their place in the list:
+	uint32_t num_uses = 0;
+	for (uint32_t i = 0; i < num_clusters; i++)
+	{
+		const mp_meshlet_t *meshlet = &(meshlets->meshlets[clusters[i]]);
+		for (uint32_t j = 0; j < meshlet->num_vertices; j++)
+		{
+			offsets[meshlets->vertices[meshlet->vertex_offset + j]]++;
+		}
+		num_uses += meshlet->num_vertices;
+	}
+	mp_mesh_adjacency_counts_to_offsets(offsets, mesh->num_vertices);
+
+	cursors = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint32_t));
+	vertex_clusters = malloc(((size_t)num_uses + 1) * sizeof(uint32_t));
+	if (!cursors || !vertex_clusters)
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+	memcpy(cursors, offsets, mesh->num_vertices * sizeof(uint32_t));
+	for (uint32_t i = 0; i < num_clusters; i++)
+	{
+		const mp_meshlet_t *meshlet = &(meshlets->meshlets[clusters[i]]);
+		for (uint32_t j = 0; j < meshlet->num_vertices; j++)
+		{
+			uint32_t vertex = meshlets->vertices[meshlet->vertex_offset + j];
+			vertex_clusters[cursors[vertex]++] = i;
+		}
+	}
+
+	/* Groups grow from the first cluster left, each time taking the ungrouped cluster sharing
+	 * the most vertices with the group. Clusters come out of the meshlet builder and earlier
+	 * groups in spatial runs, so seeds in list order stay close together: */
+	for (uint32_t i = 0; i < num_clusters; i++) { groups[i] = MP_EDGE_NONE; }
+	uint32_t num_grouped = 0;
+	*num_groups = 0;
+	group_offsets[0] = 0;
+	for (uint32_t seed = 0; seed < num_clusters; seed++)
+	{
+		if (groups[seed] != MP_EDGE_NONE) { continue; }
+
+		uint32_t group = (*num_groups)++;
+		uint32_t group_start = num_grouped;
+		groups[seed] = group;
+		group_clusters[num_grouped++] = clusters[seed];
+
+		while ((num_grouped - group_start) < MP_MESH_DAG_GROUP_SIZE)
+		{
+			uint32_t num_touched = 0;
+			for (uint32_t j = group_start; j < num_grouped; j++)
+			{
+				const mp_meshlet_t *meshlet = &(meshlets->meshlets[group_clusters[j]]);
+				for (uint32_t k = 0; k < meshlet->num_vertices; k++)
+				{
+					uint32_t vertex = meshlets->vertices[meshlet->vertex_offset + k];
+					for (uint32_t l = offsets[vertex]; l < offsets[vertex + 1]; l++)
+					{
+						uint32_t other = vertex_clusters[l];
+						if (groups[other] != MP_EDGE_NONE) { continue; }
+						if (!(scores[other]++)) { touched[num_touched++] = other; }
+					}
+				}
+			}
+
+			uint32_t best = MP_EDGE_NONE;
+			uint32_t best_score = 0;
+			for (uint32_t j = 0; j < num_touched; j++)
+			{
+				uint32_t other = touched[j];
+				if ((scores[other] > best_score) ||
+					((scores[other] == best_score) && (other < best)))
+				{
+					best = other;
+					best_score = scores[other];
+				}
+				scores[other] = 0;
+			}
+			if (best == MP_EDGE_NONE) { break; }
+
+			groups[best] = group;
+			group_clusters[num_grouped++] = clusters[best];
+		}
+
+		group_offsets[*num_groups] = num_grouped;
+	}
+
+	cleanup:
+	if (groups) { free(groups); }
+	if (scores) { free(scores); }
+	if (touched) { free(touched); }
+	if (offsets) { free(offsets); }
+	if (cursors) { free(cursors); }
+	if (vertex_clusters) { free(vertex_clusters); }
+	return return_value;
+}
+
+int mp_mesh_cluster_dag_simplify_group(mp_mesh_t *mesh, const mp_mesh_cluster_dag_t *dag,
+		const uint32_t *clusters, uint32_t num_clusters, const uint32_t *vertex_owners,
+		double inverse_diagonal, uint32_t max_vertices, uint32_t max_triangles,
+					mp_mesh_cluster_group_result_t *result)
+{
+	// Runs on one thread per group:
+	const mp_mesh_meshlets_t *meshlets = &(dag->meshlets);
+	memset(result, 0, sizeof(*result));
+	uint32_t num_faces = 0;
+	for (uint32_t i = 0; i < num_clusters; i++)
+	{
+		num_faces += meshlets->meshlets[clusters[i]].num_triangles;
+	}
+
+	int return_value = 0;
+	mp_mesh_simplifier_t simplifier;
+	memset(&simplifier, 0, sizeof(simplifier));
+	mp_mesh_vertex_faces_t vertex_faces;
+	memset(&vertex_faces, 0, sizeof(vertex_faces));
+	uint32_t *indices = malloc(((size_t)num_faces + 1) * 3 * sizeof(uint32_t));
+	uint32_t *faces = malloc(((size_t)num_faces + 1) * sizeof(uint32_t));
+	if (!indices || !faces)
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	uint32_t next_face = 0;
+	for (uint32_t i = 0; i < num_clusters; i++)
+	{
+		const mp_meshlet_t *meshlet = &(meshlets->meshlets[clusters[i]]);
+		const uint32_t *vertices = meshlets->vertices + meshlet->vertex_offset;
+		for (uint32_t j = 0; j < meshlet->num_triangles; j++)
+		{
+			uint32_t triangle = meshlet->triangle_offset + j;
+			for (int k = 0; k < 3; k++)
+			{
+				indices[(next_face * 3) + k] = vertices[meshlets->triangles[(triangle * 3) + k]];
+			}
+			faces[next_face++] = meshlets->faces[triangle];
+		}
+	}
+
+	if (mp_mesh_simplifier_init_cluster(mesh, &simplifier, faces, indices, num_faces,
+						vertex_owners, inverse_diagonal))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Half the faces, which all have to come from away from the group's locked borders:
+	mp_mesh_lod_target_t target;
+	uint32_t half_faces = simplifier.num_faces / 2;
+	target.target_faces = (half_faces > simplifier.num_locked_faces) ?
+				(half_faces - simplifier.num_locked_faces) : 0;
+	target.target_error = 0.0f;
+	float error = 0.0f;
+	if (mp_mesh_simplifier_run(mesh, &simplifier, target, &error))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+	/* A group simplified away entirely would leave its children with a parent error but no
+	 * parents to draw instead, so it stays unsimplified, as does one reduced too little: */
+	if (!simplifier.num_live_faces ||
+		(simplifier.num_live_faces > (uint32_t)((1.0 - MP_MESH_DAG_MIN_REDUCTION) * num_faces)))
+	{
+		goto cleanup;
+	}
+
+	// Live faces are packed down in the cluster's own vertex numbering, keeping their base faces:
+	uint32_t num_live_faces = 0;
+	for (uint32_t i = 0; i < num_faces; i++)
+	{
+		if (!simplifier.is_live_face[i]) { continue; }
+		for (int k = 0; k < 3; k++)
+		{
+			indices[(num_live_faces * 3) + k] = mp_mesh_simplifier_find(&simplifier,
+							simplifier.cluster_indices[(i * 3) + k]);
+		}
+		faces[num_live_faces++] = faces[i];
+	}
+
+	// Then split into new clusters, moved back to mesh vertices and faces:
+	mp_mesh_meshlet_builder_t *builder = &(result->builder);
+	if (mp_mesh_build_vertex_faces_from_indices(indices, 3, num_live_faces,
+					simplifier.num_vertices, &vertex_faces) ||
+		mp_mesh_meshlet_builder_init(builder, indices, 3, num_live_faces, &vertex_faces,
+									max_triangles) ||
+		mp_mesh_meshlet_builder_run(builder, max_vertices, max_triangles))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	mp_mesh_meshlets_t *output = &(builder->output);
+	for (uint32_t i = 0; i < output->num_vertices; i++)
+	{
+		output->vertices[i] = simplifier.vertex_map[output->vertices[i]];
+	}
+	for (uint32_t i = 0; i < output->num_triangles; i++)
+	{
+		output->faces[i] = faces[output->faces[i]];
+	}
+	for (uint32_t i = 0; i < output->num_meshlets; i++)
+	{
+		mp_mesh_calculate_meshlet_bounds(mesh, output, &(output->meshlets[i]));
+	}
+
+	result->is_simplified = 1;
+	result->error = (float)(error / inverse_diagonal);
+
+	cleanup:
+	mp_mesh_simplifier_free(&simplifier);
+	mp_mesh_vertex_faces_free(&vertex_faces);
+	if (indices) { free(indices); }
+	if (faces) { free(faces); }
+	return return_value;
+}
+
+int mp_mesh_cluster_dag_append(mp_mesh_cluster_dag_builder_t *builder,
+				const mp_mesh_meshlets_t *meshlets, uint32_t level)
+{
+	mp_mesh_cluster_dag_t *dag = &(builder->dag);
+	mp_mesh_meshlets_t *output = &(dag->meshlets);
+	uint32_t num_meshlets = output->num_meshlets + meshlets->num_meshlets;
+	uint32_t num_vertices = output->num_vertices + meshlets->num_vertices;
+	uint32_t num_triangles = output->num_triangles + meshlets->num_triangles;
+	if (mp_mesh_cluster_dag_reserve((void **)&(output->meshlets), &(builder->meshlet_capacity),
+						num_meshlets, sizeof(mp_meshlet_t)) ||
+		mp_mesh_cluster_dag_reserve((void **)&(dag->clusters), &(builder->cluster_capacity),
+						num_meshlets, sizeof(mp_mesh_cluster_t)) ||
+		mp_mesh_cluster_dag_reserve((void **)&(output->vertices), &(builder->vertex_capacity),
+						num_vertices, sizeof(uint32_t)) ||
+		mp_mesh_cluster_dag_reserve((void **)&(output->triangles),
+			&(builder->triangle_capacity), num_triangles, 3 * sizeof(uint8_t)) ||
+		mp_mesh_cluster_dag_reserve((void **)&(output->faces), &(builder->face_capacity),
+						num_triangles, sizeof(uint32_t))) { return -1; }
+
+	memcpy(output->vertices + output->num_vertices, meshlets->vertices,
+					meshlets->num_vertices * sizeof(uint32_t));
+	memcpy(output->triangles + (output->num_triangles * 3), meshlets->triangles,
+					meshlets->num_triangles * 3 * sizeof(uint8_t));
+	memcpy(output->faces + output->num_triangles, meshlets->faces,
+					meshlets->num_triangles * sizeof(uint32_t));
+
+	// Clusters start with their own sphere and no error or parent:
+	for (uint32_t i = 0; i < meshlets->num_meshlets; i++)
+	{
+		mp_meshlet_t meshlet = meshlets->meshlets[i];
+		meshlet.vertex_offset += output->num_vertices;
+		meshlet.triangle_offset += output->num_triangles;
+		output->meshlets[output->num_meshlets + i] = meshlet;
+
+		mp_mesh_cluster_t *cluster = &(dag->clusters[output->num_meshlets + i]);
+		cluster->level = level;
+		cluster->group = MP_EDGE_NONE;
+		memcpy(cluster->bounds.centre, meshlet.centre, sizeof(meshlet.centre));
+		cluster->bounds.radius = meshlet.radius;
+		cluster->bounds.error = 0.0f;
+		cluster->parent_bounds = cluster->bounds;
+		cluster->parent_bounds.error = FLT_MAX;
+	}
+
+	output->num_meshlets = num_meshlets;
+	output->num_vertices = num_vertices;
+	output->num_triangles = num_triangles;
+	return 0;
+}
+
+int mp_mesh_cluster_dag_add_group(mp_mesh_cluster_dag_builder_t *builder,
+		const uint32_t *children, uint32_t num_children, const mp_mesh_meshlets_t *parents,
+								float error)
+{
+	mp_mesh_cluster_dag_t *dag = &(builder->dag);
+	if (mp_mesh_cluster_dag_reserve((void **)&(dag->groups), &(builder->group_capacity),
+					dag->num_groups + 1, sizeof(mp_mesh_cluster_group_t)) ||
+		mp_mesh_cluster_dag_reserve((void **)&(dag->group_children),
+			&(builder->group_child_capacity), dag->num_group_children + num_children,
+						sizeof(uint32_t))) { return -1; }
+
+	/* The group sphere holds every child sphere, and its error is at least every child's, so
+	 * parents never project to less error than their children: */
+	mp_mesh_lod_bounds_t bounds = dag->clusters[children[0]].bounds;
+	uint32_t level = dag->clusters[children[0]].level;
+	for (uint32_t i = 1; i < num_children; i++)
+	{
+		mp_mesh_lod_bounds_merge(&bounds, &(dag->clusters[children[i]].bounds));
+		if (dag->clusters[children[i]].level > level) { level = dag->clusters[children[i]].level; }
+	}
+	if (error > bounds.error) { bounds.error = error; }
+
+	uint32_t group_index = dag->num_groups++;
+	mp_mesh_cluster_group_t *group = &(dag->groups[group_index]);
+	group->child_offset = dag->num_group_children;
+	group->num_children = num_children;
+	group->parent_offset = dag->meshlets.num_meshlets;
+	group->num_parents = parents->num_meshlets;
+	group->bounds = bounds;
+
+	for (uint32_t i = 0; i < num_children; i++)
+	{
+		dag->group_children[dag->num_group_children++] = children[i];
+		dag->clusters[children[i]].group = group_index;
+		dag->clusters[children[i]].parent_bounds = bounds;
+	}
+
+	if (mp_mesh_cluster_dag_append(builder, parents, level + 1)) { return -1; }
+	for (uint32_t i = 0; i < parents->num_meshlets; i++)
+	{
+		dag->clusters[group->parent_offset + i].bounds = bounds;
+	}
+	return 0;
+}
+
+int mp_mesh_cluster_dag_copy(mp_mesh_t *mesh, mp_mesh_cluster_dag_t *dag,
+					const mp_mesh_cluster_dag_t *source)
+{
+	// Copied into blocks of the final size:
+	const mp_mesh_meshlets_t *meshlets = &(source->meshlets);
+	memset(dag, 0, sizeof(*dag));
+	dag->meshlets.meshlets = mp_mesh_allocate_block(mesh,
+				((size_t)meshlets->num_meshlets + 1) * sizeof(mp_meshlet_t));
+	dag->meshlets.vertices = mp_mesh_allocate_block(mesh,
+				((size_t)meshlets->num_vertices + 1) * sizeof(uint32_t));
+	dag->meshlets.triangles = mp_mesh_allocate_block(mesh,
+				((size_t)meshlets->num_triangles + 1) * 3 * sizeof(uint8_t));
+	dag->meshlets.faces = mp_mesh_allocate_block(mesh,
+				((size_t)meshlets->num_triangles + 1) * sizeof(uint32_t));
+	dag->clusters = mp_mesh_allocate_block(mesh,
+				((size_t)meshlets->num_meshlets + 1) * sizeof(mp_mesh_cluster_t));
+	dag->groups = mp_mesh_allocate_block(mesh,
+				((size_t)source->num_groups + 1) * sizeof(mp_mesh_cluster_group_t));
+	dag->group_children = mp_mesh_allocate_block(mesh,
+				((size_t)source->num_group_children + 1) * sizeof(uint32_t));
+	if (!dag->meshlets.meshlets || !dag->meshlets.vertices || !dag->meshlets.triangles ||
+		!dag->meshlets.faces || !dag->clusters || !dag->groups || !dag->group_children)
+	{
+		mp_mesh_cluster_dag_free(mesh, dag);
+		return -1;
+	}
+
+	dag->num_levels = source->num_levels;
+	dag->meshlets.num_meshlets = meshlets->num_meshlets;
+	dag->meshlets.num_vertices = meshlets->num_vertices;
+	dag->meshlets.num_triangles = meshlets->num_triangles;
+	dag->num_groups = source->num_groups;
+	dag->num_group_children = source->num_group_children;
+	memcpy(dag->meshlets.meshlets, meshlets->meshlets,
+				meshlets->num_meshlets * sizeof(mp_meshlet_t));
+	memcpy(dag->meshlets.vertices, meshlets->vertices, meshlets->num_vertices * sizeof(uint32_t));
+	memcpy(dag->meshlets.triangles, meshlets->triangles,
+				meshlets->num_triangles * 3 * sizeof(uint8_t));
+	memcpy(dag->meshlets.faces, meshlets->faces, meshlets->num_triangles * sizeof(uint32_t));
+	memcpy(dag->clusters, source->clusters, meshlets->num_meshlets * sizeof(mp_mesh_cluster_t));
+	if (source->num_groups)
+	{
+		memcpy(dag->groups, source->groups, source->num_groups * sizeof(mp_mesh_cluster_group_t));
+		memcpy(dag->group_children, source->group_children,
+				source->num_group_children * sizeof(uint32_t));
+	}
+	return 0;
+}
+
+void mp_mesh_cluster_dag_builder_free(mp_mesh_cluster_dag_builder_t *builder)
+{
+	mp_mesh_cluster_dag_t *dag = &(builder->dag);
+	if (dag->meshlets.meshlets) { free(dag->meshlets.meshlets); }
+	if (dag->meshlets.vertices) { free(dag->meshlets.vertices); }
+	if (dag->meshlets.triangles) { free(dag->meshlets.triangles); }
+	if (dag->meshlets.faces) { free(dag->meshlets.faces); }
+	if (dag->clusters) { free(dag->clusters); }
+	if (dag->groups) { free(dag->groups); }
+	if (dag->group_children) { free(dag->group_children); }
+	memset(builder, 0, sizeof(*builder));
+}
@@ -0,0 +1,163 @@
+#ifndef MP_MESH_CLUSTER_DAG_H
+#define MP_MESH_CLUSTER_DAG_H
+
+#include <NM-Config/Config.h>
+
+#include <float.h>
+#include <math.h>
+
+#include "Mesh.h"
+#include "Mesh-Adjacency.h"
+#include "Mesh-Meshlets.h"
+#include "Mesh-Simplify.h"
+
+// Neighbouring clusters simplified together, so their shared borders can change:
+#define MP_MESH_DAG_GROUP_SIZE		4
+
+// A group must lose at least this share of its triangles, or its clusters stay as roots:
+#define MP_MESH_DAG_MIN_REDUCTION	0.15
+
+/* Simplification error over a sphere. A cluster is drawn when its own bounds project to no more
+ * than the allowed error and its parent bounds project to more, which is a consistent cut
+ * through the DAG as errors and spheres only grow towards the roots: */
+typedef struct
+{
+	float centre[3];
+	float radius;
+	float error;		// World space distance, FLT_MAX for no parent.
+} mp_mesh_lod_bounds_t;
+
+typedef struct
+{
+	uint32_t level;			// 0 for clusters of the base level, then one over its highest child.
+	uint32_t group;			// Group simplified into parents, or MP_EDGE_NONE at roots.
+	mp_mesh_lod_bounds_t bounds;
+	mp_mesh_lod_bounds_t parent_bounds;
+} mp_mesh_cluster_t;
+
+/* Clusters simplified together. Children are listed in the DAG's group children, and the
+ * parents made from them are consecutive clusters: */
+typedef struct
+{
+	uint32_t child_offset;
+	uint32_t num_children;
+	uint32_t parent_offset;
+	uint32_t num_parents;
+	mp_mesh_lod_bounds_t bounds;
+} mp_mesh_cluster_group_t;
+
+/* Hierarchy of clusters from the base level up, with one meshlet per cluster. Meshlet vertices
+ * are position indices and meshlet faces are the base level face each triangle came from, for
+ * its attributes. Allocated through the mesh allocator: */
+typedef struct
+{
+	uint32_t num_levels;
+	mp_mesh_meshlets_t meshlets;
+	mp_mesh_cluster_t *clusters;	// num_meshlets entries.
+
+	uint32_t num_groups;
+	mp_mesh_cluster_group_t *groups;
+	uint32_t num_group_children;
+	uint32_t *group_children;
+} mp_mesh_cluster_dag_t;
+
+// A DAG being built, in arrays that grow as levels are added:
+typedef struct
+{
+	mp_mesh_cluster_dag_t dag;
+	uint32_t meshlet_capacity;
+	uint32_t cluster_capacity;
+	uint32_t vertex_capacity;
+	uint32_t triangle_capacity;
+	uint32_t face_capacity;
+	uint32_t group_capacity;
+	uint32_t group_child_capacity;
+} mp_mesh_cluster_dag_builder_t;
+
+// Output of simplifying one group, on its own thread:
+typedef struct
+{
+	uint8_t is_simplified;
+	float error;
+	mp_mesh_meshlet_builder_t builder;
+} mp_mesh_cluster_group_result_t;
+
+int mp_mesh_build_cluster_dag(mp_mesh_t *mesh, uint32_t max_vertices, uint32_t max_triangles,
+		mp_mesh_cluster_dag_t *dag, char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_cluster_dag_free(mp_mesh_t *mesh, mp_mesh_cluster_dag_t *dag);
+int mp_mesh_cluster_dag_group_clusters(mp_mesh_t *mesh, const mp_mesh_cluster_dag_t *dag,
+		const uint32_t *clusters, uint32_t num_clusters, uint32_t *group_clusters,
+							uint32_t *group_offsets, uint32_t *num_groups);
+int mp_mesh_cluster_dag_simplify_group(mp_mesh_t *mesh, const mp_mesh_cluster_dag_t *dag,
+		const uint32_t *clusters, uint32_t num_clusters, const uint32_t *vertex_owners,
+		double inverse_diagonal, uint32_t max_vertices, uint32_t max_triangles,
+					mp_mesh_cluster_group_result_t *result);
+int mp_mesh_cluster_dag_append(mp_mesh_cluster_dag_builder_t *builder,
+				const mp_mesh_meshlets_t *meshlets, uint32_t level);
+int mp_mesh_cluster_dag_add_group(mp_mesh_cluster_dag_builder_t *builder,
+		const uint32_t *children, uint32_t num_children, const mp_mesh_meshlets_t *parents,
+								float error);
+int mp_mesh_cluster_dag_copy(mp_mesh_t *mesh, mp_mesh_cluster_dag_t *dag,
+					const mp_mesh_cluster_dag_t *source);
+void mp_mesh_cluster_dag_builder_free(mp_mesh_cluster_dag_builder_t *builder);
+
+// Grows an array to hold at least "count" elements, doubling its capacity:
+static inline int mp_mesh_cluster_dag_reserve(void **array, uint32_t *capacity, uint32_t count,
+								size_t element_size)
+{
+	if (count <= *capacity) { return 0; }
+	uint32_t new_capacity = (*capacity > 0) ? *capacity : 64;
+	while (new_capacity < count) { new_capacity *= 2; }
+	void *new_array = realloc(*array, (size_t)new_capacity * element_size);
+	if (!new_array) { return -1; }
+	*array = new_array;
+	*capacity = new_capacity;
+	return 0;
+}
+
+// Smallest sphere around both spheres, written to the first:
+static inline void mp_mesh_lod_bounds_merge(mp_mesh_lod_bounds_t *bounds,
+						const mp_mesh_lod_bounds_t *other)
+{
+	float offset[3] = { other->centre[0] - bounds->centre[0], other->centre[1] - bounds->centre[1],
+					other->centre[2] - bounds->centre[2] };
+	float distance = sqrtf((offset[0] * offset[0]) + (offset[1] * offset[1]) +
+							(offset[2] * offset[2]));
+	if (other->error > bounds->error) { bounds->error = other->error; }
+	if ((distance + other->radius) <= bounds->radius) { return; }
+	if ((distance + bounds->radius) <= other->radius)
+	{
+		memcpy(bounds->centre, other->centre, sizeof(bounds->centre));
+		bounds->radius = other->radius;
+		return;
+	}
+
+	float radius = (distance + bounds->radius + other->radius) * 0.5f;
+	float shift = (radius - bounds->radius) / distance;
+	for (int i = 0; i < 3; i++) { bounds->centre[i] += offset[i] * shift; }
+	bounds->radius = radius;
+}
+
+/* Error in pixels as seen from the camera, with "scale" the screen height over twice the tangent
+ * of half the vertical field of view. The camera inside the sphere sees unbounded error: */
+static inline float mp_mesh_lod_bounds_project(const mp_mesh_lod_bounds_t *bounds,
+					const float camera[3], float scale)
+{
+	if (bounds->error == FLT_MAX) { return FLT_MAX; }
+	float offset[3] = { bounds->centre[0] - camera[0], bounds->centre[1] - camera[1],
+					bounds->centre[2] - camera[2] };
+	float distance = sqrtf((offset[0] * offset[0]) + (offset[1] * offset[1]) +
+					(offset[2] * offset[2])) - bounds->radius;
+	if (distance <= 0.0f) { return (bounds->error > 0.0f) ? FLT_MAX : 0.0f; }
+	return (bounds->error / distance) * scale;
+}
+
+// Whether a cluster is part of the cut for an allowed error in pixels:
+static inline uint8_t mp_mesh_cluster_is_visible(const mp_mesh_cluster_t *cluster,
+			const float camera[3], float scale, float threshold)
+{
+	return (mp_mesh_lod_bounds_project(&(cluster->bounds), camera, scale) <= threshold) &&
+		(mp_mesh_lod_bounds_project(&(cluster->parent_bounds), camera, scale) > threshold);
+}
+
+#endif
@@ -0,0 +1,722 @@
+#include "Mesh-Codec.h"
+#include "Mesh-Loader.h"
+#include "Mesh-Quantise.h"
+
+int mp_mesh_compress(mp_mesh_t *mesh, mp_mesh_compressed_t *compressed,
+				char error_message[NM_MAX_ERROR_LENGTH])
+{
+	memset(compressed, 0, sizeof(mp_mesh_compressed_t));
+	if (mp_mesh_is_soa(mesh))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" must be in array-of-structures layout to compress.", mesh->name);
+		return -1;
+	}
+
+	// Decompression rejects empty meshes, as loading does, so they aren't written either:
+	if (!mesh->num_vertices || !mesh->num_faces[0])
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" has no vertices/faces to compress.", mesh->name);
+		return -1;
+	}
+
+	mp_codec_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MP_CODEC_MAGIC, sizeof(MP_CODEC_MAGIC));
+	header.version = MP_CODEC_VERSION;
+	header.header_size = sizeof(mp_codec_header_t);
+	header.normal_size = sizeof(mp_normal_t);
+	header.has_normals = mesh->has_normals;
+	header.num_vertices = mesh->num_vertices;
+	header.num_normals = mesh->num_normals;
+	header.num_colours = mesh->num_colours;
+	header.num_uv_coordinates = mesh->num_uv_coordinates;
+	header.num_faces = mesh->num_faces[0];
+	header.is_quantised = (mesh->quantised.positions != NULL);
+	if (header.is_quantised)
+	{
+		header.quantised = mesh->quantised;
+		header.quantised.positions = NULL;
+		header.quantised.uv_coordinates = NULL;
+	}
+
+	// Attribute indices are often the position indices, which are stored as empty streams:
+	uint32_t num_faces = mesh->num_faces[0];
+	const mp_face_t *faces = mesh->faces[0];
+	uint8_t is_same[3] = { 1, 1, 1 };
+	#pragma omp parallel for reduction(&:is_same[:3])
+	for (uint32_t i = 0; i < num_faces; i++)
+	{
+		is_same[0] &= !memcmp(faces[i].n, faces[i].p, sizeof(faces[i].p));
+		is_same[1] &= !memcmp(faces[i].c, faces[i].p, sizeof(faces[i].p));
+		is_same[2] &= !memcmp(faces[i].u, faces[i].p, sizeof(faces[i].p));
+	}
+
+	const void *elements[4] = { mesh->vertices, mesh->normals, mesh->colours,
+							mesh->uv_coordinates };
+	uint32_t counts[4] = { mesh->num_vertices, mesh->num_normals, mesh->num_colours,
+							mesh->num_uv_coordinates };
+	uint32_t element_sizes[4] = { sizeof(mp_position_t), sizeof(mp_normal_t),
+						sizeof(mp_colour_t), sizeof(mp_uv_t) };
+	const uint32_t *indices[4] = { faces[0].p, faces[0].n, faces[0].c, faces[0].u };
+	if (header.is_quantised)
+	{
+		elements[0] = mesh->quantised.positions;
+		elements[3] = mesh->quantised.uv_coordinates;
+		element_sizes[0] = 3 * sizeof(uint16_t);
+		element_sizes[3] = 2 * sizeof(uint16_t);
+	}
+
+	// Sized for the worst case first, then trimmed:
+	size_t capacity = mp_mesh_align_size(sizeof(mp_codec_header_t));
+	for (int i = 0; i < 4; i++)
+	{
+		capacity += mp_mesh_align_size(mp_codec_vertex_bound(counts[i], element_sizes[i]));
+		capacity += mp_mesh_align_size(mp_codec_index_bound(num_faces));
+	}
+	uint8_t *data = malloc(capacity);
+	if (!data)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for compressing mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	size_t position = mp_mesh_align_size(sizeof(mp_codec_header_t));
+	for (int i = 0; i < MP_CODEC_NUM_STREAMS; i++)
+	{
+		header.offsets[i] = position;
+		if (i < MP_CODEC_STREAM_POSITION_INDICES)
+		{
+			header.sizes[i] = mp_codec_encode_vertices(elements[i], counts[i],
+							element_sizes[i], data + position);
+		}
+		else if ((i == MP_CODEC_STREAM_POSITION_INDICES) ||
+				!is_same[i - MP_CODEC_STREAM_NORMAL_INDICES])
+		{
+			header.sizes[i] = mp_codec_encode_indices(indices[i - MP_CODEC_STREAM_POSITION_INDICES],
+							MP_FACE_STRIDE, num_faces, data + position);
+		}
+		position += mp_mesh_align_size(header.sizes[i]);
+	}
+	memcpy(data, &header, sizeof(header));
+
+	uint8_t *trimmed = realloc(data, position);
+	compressed->data = trimmed ? trimmed : data;
+	compressed->size = position;
+	return 0;
+}
+
+void mp_mesh_compressed_free(mp_mesh_compressed_t *compressed)
+{
+	if (compressed->data) { free(compressed->data); }
+	memset(compressed, 0, sizeof(mp_mesh_compressed_t));
+}
+
+int mp_mesh_decompress(mp_mesh_t *mesh, const uint8_t *data, size_t size,
+				char error_message[NM_MAX_ERROR_LENGTH])
+{
+	mp_codec_header_t header;
+	if (size >= sizeof(header)) { memcpy(&header, data, sizeof(header)); }
+	if ((size < sizeof(header)) || memcmp(header.magic, MP_CODEC_MAGIC, sizeof(MP_CODEC_MAGIC)) ||
+		(header.version != MP_CODEC_VERSION) ||
+		(header.header_size != sizeof(mp_codec_header_t)) ||
+		(header.normal_size != sizeof(mp_normal_t)) ||
+		!header.num_vertices || !header.num_faces ||
+		((uint64_t)header.num_faces * 3 > UINT32_MAX) ||
+		(header.is_quantised && (header.quantised.uv_format > MP_UV_FORMAT_HALF)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Compressed mesh \"%s\" is invalid or from another version.", mesh->name);
+		return -1;
+	}
+	for (int i = 0; i < MP_CODEC_NUM_STREAMS; i++)
+	{
+		if ((header.offsets[i] > size) || (header.sizes[i] > (size - header.offsets[i])))
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Compressed mesh \"%s\" is truncated.", mesh->name);
+			return -1;
+		}
+	}
+
+	mesh->num_vertices = header.num_vertices;
+	mesh->num_normals = header.num_normals;
+	mesh->num_colours = header.num_colours;
+	mesh->num_uv_coordinates = header.num_uv_coordinates;
+	mesh->num_edges = header.num_faces * 3;
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++) { mesh->num_faces[i] = header.num_faces; }
+	if (mp_mesh_allocate(mesh, error_message)) { return -1; }
+	mesh->has_normals = header.has_normals;
+
+	void *elements[4] = { mesh->vertices, mesh->normals, mesh->colours, mesh->uv_coordinates };
+	uint32_t counts[4] = { mesh->num_vertices, mesh->num_normals, mesh->num_colours,
+							mesh->num_uv_coordinates };
+	uint32_t element_sizes[4] = { sizeof(mp_position_t), sizeof(mp_normal_t),
+						sizeof(mp_colour_t), sizeof(mp_uv_t) };
+	if (header.is_quantised)
+	{
+		mesh->quantised = header.quantised;
+		mesh->quantised.positions = mp_mesh_allocate_block(mesh,
+					(size_t)mesh->num_vertices * 3 * sizeof(uint16_t));
+		mesh->quantised.uv_coordinates = mp_mesh_allocate_block(mesh,
+					(size_t)mesh->num_uv_coordinates * 2 * sizeof(uint16_t));
+		if (!mesh->quantised.positions || !mesh->quantised.uv_coordinates)
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for decompressing mesh \"%s\".", mesh->name);
+			mp_mesh_free(mesh);
+			return -1;
+		}
+		elements[0] = mesh->quantised.positions;
+		elements[3] = mesh->quantised.uv_coordinates;
+		element_sizes[0] = 3 * sizeof(uint16_t);
+		element_sizes[3] = 2 * sizeof(uint16_t);
+	}
+	mp_face_t *faces = mesh->faces[0];
+	uint32_t *indices[4] = { faces[0].p, faces[0].n, faces[0].c, faces[0].u };
+
+	int failed = 0;
+	for (int i = 0; (i < MP_CODEC_NUM_STREAMS) && !failed; i++)
+	{
+		const uint8_t *stream = data + header.offsets[i];
+		if (i < MP_CODEC_STREAM_POSITION_INDICES)
+		{
+			failed = mp_codec_decode_vertices(stream, header.sizes[i], elements[i], counts[i],
+									element_sizes[i]);
+		}
+		else if ((i == MP_CODEC_STREAM_POSITION_INDICES) || header.sizes[i])
+		{
+			failed = mp_codec_decode_indices(stream, header.sizes[i],
+				indices[i - MP_CODEC_STREAM_POSITION_INDICES], MP_FACE_STRIDE,
+									header.num_faces);
+		}
+	}
+
+	// Empty attribute streams repeat the position indices, and every index must be in range:
+	if (!failed)
+	{
+		#pragma omp parallel for reduction(|:failed)
+		for (uint32_t i = 0; i < header.num_faces; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				if (!header.sizes[MP_CODEC_STREAM_NORMAL_INDICES]) { faces[i].n[j] = faces[i].p[j]; }
+				if (!header.sizes[MP_CODEC_STREAM_COLOUR_INDICES]) { faces[i].c[j] = faces[i].p[j]; }
+				if (!header.sizes[MP_CODEC_STREAM_UV_INDICES]) { faces[i].u[j] = faces[i].p[j]; }
+				failed |= (faces[i].p[j] >= counts[0]) || (faces[i].n[j] >= counts[1]) ||
+					(faces[i].c[j] >= counts[2]) || (faces[i].u[j] >= counts[3]);
+			}
+		}
+	}
+	if (failed)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Compressed mesh \"%s\" is corrupt.", mesh->name);
+		mp_mesh_free(mesh);
+		return -1;
+	}
+	if (header.is_quantised)
+	{
+		mp_mesh_dequantise(mesh, &(mesh->vertices[0].x), &(mesh->uv_coordinates[0].u));
+	}
+
+	// Edges are derived data, so they are rebuilt rather than stored:
+	if (mp_mesh_load_edges(mesh, error_message))
+	{
+		mp_mesh_free(mesh);
+		return -1;
+	}
+	return mp_mesh_load_finish(mesh, error_message);
+}
+
+size_t mp_codec_index_bound(uint32_t num_faces)
+{
+	// A code byte and three varints of up to five bytes per face:
+	size_t num_blocks = ((size_t)num_faces + MP_CODEC_INDEX_BLOCK_SIZE - 1) /
+							MP_CODEC_INDEX_BLOCK_SIZE;
+	return (2 * sizeof(uint32_t)) + (num_blocks * sizeof(mp_codec_index_block_t)) +
+								((size_t)num_faces * 16);
+}
+
+size_t mp_codec_encode_indices(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+								uint8_t *buffer)
+{
+	uint32_t num_blocks = (num_faces + MP_CODEC_INDEX_BLOCK_SIZE - 1) / MP_CODEC_INDEX_BLOCK_SIZE;
+	memcpy(buffer, &num_faces, sizeof(uint32_t));
+	memcpy(buffer + sizeof(uint32_t), &num_blocks, sizeof(uint32_t));
+	uint8_t *blocks = buffer + (2 * sizeof(uint32_t));
+	uint8_t *data = blocks + ((size_t)num_blocks * sizeof(mp_codec_index_block_t));
+
+	// The next and last vertex carry across blocks, so the encoder runs in order:
+	uint32_t next = 0;
+	uint32_t last = 0;
+	for (uint32_t b = 0; b < num_blocks; b++)
+	{
+		mp_codec_index_block_t block = { (uint64_t)(data - buffer), next, last };
+		memcpy(blocks + ((size_t)b * sizeof(block)), &block, sizeof(block));
+
+		uint32_t edge_fifo[MP_CODEC_FIFO_SIZE][2];
+		uint32_t vertex_fifo[MP_CODEC_FIFO_SIZE];
+		uint32_t edge_offset = 0;
+		uint32_t vertex_offset = 0;
+		memset(edge_fifo, 0, sizeof(edge_fifo));
+		memset(vertex_fifo, 0, sizeof(vertex_fifo));
+
+		uint32_t end = (b + 1) * MP_CODEC_INDEX_BLOCK_SIZE;
+		if (end > num_faces) { end = num_faces; }
+		for (uint32_t i = b * MP_CODEC_INDEX_BLOCK_SIZE; i < end; i++)
+		{
+			const uint32_t *face = indices + ((size_t)i * stride);
+
+			// Most recent edge first, entered by this face the other way round:
+			int slot = -1;
+			int corner = 0;
+			for (int j = 0; (j < MP_CODEC_NO_EDGE) && (slot < 0); j++)
+			{
+				const uint32_t *edge = edge_fifo[(edge_offset - 1 - j) & (MP_CODEC_FIFO_SIZE - 1)];
+				for (int k = 0; k < 3; k++)
+				{
+					if ((face[k] == edge[1]) && (face[(k + 1) % 3] == edge[0]))
+					{
+						slot = j;
+						corner = k;
+						break;
+					}
+				}
+			}
+
+			if (slot >= 0)
+			{
+				uint8_t *code = data++;
+				uint32_t third = face[(corner + 2) % 3];
+				int recent = mp_codec_find_vertex(vertex_fifo, vertex_offset, third);
+				uint8_t kind = MP_CODEC_VERTEX_EXPLICIT;
+				if (third == next)
+				{
+					kind = MP_CODEC_VERTEX_NEXT;
+					next++;
+				}
+				else if (recent >= 0)
+				{
+					kind = MP_CODEC_VERTEX_FIFO;
+					*(data++) = (uint8_t)recent;
+				}
+				else
+				{
+					data = mp_codec_write_varint(data, mp_codec_zigzag(third, last));
+					last = third;
+				}
+				*code = (uint8_t)((slot << 4) | (corner << 2) | kind);
+				if (kind != MP_CODEC_VERTEX_FIFO)
+				{
+					vertex_fifo[(vertex_offset++) & (MP_CODEC_FIFO_SIZE - 1)] = third;
+				}
+
+				// The shared edge is already known, so only the other two are added:
+				for (int k = 1; k < 3; k++)
+				{
+					uint32_t *edge = edge_fifo[(edge_offset++) & (MP_CODEC_FIFO_SIZE - 1)];
+					edge[0] = face[(corner + k) % 3];
+					edge[1] = face[(corner + k + 1) % 3];
+				}
+				continue;
+			}
+
+			*(data++) = MP_CODEC_NO_EDGE << 4;
+			for (int k = 0; k < 3; k++)
+			{
+				int recent = mp_codec_find_vertex(vertex_fifo, vertex_offset, face[k]);
+				if (face[k] == next)
+				{
+					*(data++) = 0;
+					next++;
+				}
+				else if (recent >= 0)
+				{
+					*(data++) = (uint8_t)(1 + recent);
+					continue;
+				}
+				else
+				{
+					data = mp_codec_write_varint(data, 17 + mp_codec_zigzag(face[k], last));
+					last = face[k];
+				}
+				vertex_fifo[(vertex_offset++) & (MP_CODEC_FIFO_SIZE - 1)] = face[k];
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t *edge = edge_fifo[(edge_offset++) & (MP_CODEC_FIFO_SIZE - 1)];
+				edge[0] = face[k];
+				edge[1] = face[(k + 1) % 3];
+			}
+		}
+	}
+
+	return data - buffer;
+}
+
+int mp_codec_decode_indices(const uint8_t *buffer, size_t size, uint32_t *indices,
+						uint32_t stride, uint32_t num_faces)
+{
+	uint32_t header[2];
+	if (size < sizeof(header)) { return -1; }
+	memcpy(header, buffer, sizeof(header));
+	if ((header[0] != num_faces) ||
+		(header[1] != (num_faces + MP_CODEC_INDEX_BLOCK_SIZE - 1) / MP_CODEC_INDEX_BLOCK_SIZE) ||
+		((size - sizeof(header)) / sizeof(mp_codec_index_block_t) < header[1]))
+	{
+		return -1;
+	}
+
+	uint32_t num_blocks = header[1];
+	const uint8_t *blocks = buffer + sizeof(header);
+	int failed = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed)
+	for (uint32_t b = 0; b < num_blocks; b++)
+	{
+		// Each block's codes end where the next block's start:
+		mp_codec_index_block_t block;
+		memcpy(&block, blocks + ((size_t)b * sizeof(block)), sizeof(block));
+		uint64_t end = size;
+		if (b + 1 < num_blocks)
+		{
+			mp_codec_index_block_t next_block;
+			memcpy(&next_block, blocks + (((size_t)b + 1) * sizeof(block)), sizeof(block));
+			end = next_block.offset;
+		}
+		if ((block.offset > end) || (end > size)) { failed |= 1; continue; }
+
+		uint32_t first = b * MP_CODEC_INDEX_BLOCK_SIZE;
+		uint32_t count = num_faces - first;
+		if (count > MP_CODEC_INDEX_BLOCK_SIZE) { count = MP_CODEC_INDEX_BLOCK_SIZE; }
+		failed |= mp_codec_decode_index_block(buffer + block.offset, buffer + end, &block,
+				indices + ((size_t)first * stride), stride, count) ? 1 : 0;
+	}
+	return failed ? -1 : 0;
+}
+
+int mp_codec_decode_index_block(const uint8_t *data, const uint8_t *end,
+		const mp_codec_index_block_t *block, uint32_t *indices, uint32_t stride,
+								uint32_t num_faces)
+{
+	/* The vertex FIFO has twice the slots referred to, so new vertices can be written
+	 * unconditionally just past the live ones, and only counted when they are pushed: */
+	uint32_t edge_fifo[MP_CODEC_FIFO_SIZE][2];
+	uint32_t vertex_fifo[2 * MP_CODEC_FIFO_SIZE];
+	uint32_t edge_offset = 0;
+	uint32_t vertex_offset = 0;
+	uint32_t next = block->next;
+	uint32_t last = block->last;
+	memset(edge_fifo, 0, sizeof(edge_fifo));
+	memset(vertex_fifo, 0, sizeof(vertex_fifo));
+
+	for (uint32_t i = 0; i < num_faces; i++)
+	{
+		if (data >= end) { return -1; }
+		uint8_t code = *(data++);
+		uint32_t *face = indices + ((size_t)i * stride);
+		uint32_t slot = code >> 4;
+
+		if (slot != MP_CODEC_NO_EDGE)
+		{
+			const uint32_t *edge = edge_fifo[(edge_offset - 1 - slot) & (MP_CODEC_FIFO_SIZE - 1)];
+			uint32_t corner = (code >> 2) & 3;
+			uint8_t kind = code & 3;
+			if (corner > 2) { return -1; }
+
+			uint32_t third;
+			if (kind == MP_CODEC_VERTEX_EXPLICIT)
+			{
+				uint64_t value;
+				data = mp_codec_read_varint(data, end, &value);
+				if (!data || (value > UINT32_MAX)) { return -1; }
+				third = last + mp_codec_unzigzag((uint32_t)value);
+				last = third;
+				vertex_fifo[(vertex_offset++) & ((2 * MP_CODEC_FIFO_SIZE) - 1)] = third;
+			}
+			else
+			{
+				// Next and recent vertices mix unpredictably, so they are selected without branches:
+				uint32_t is_recent = (kind == MP_CODEC_VERTEX_FIFO);
+				if (kind > MP_CODEC_VERTEX_EXPLICIT) { return -1; }
+				if (is_recent && (data >= end)) { return -1; }
+				uint32_t recent = *(data - 1 + is_recent);
+				if (is_recent && (recent >= MP_CODEC_FIFO_SIZE)) { return -1; }
+				uint32_t recent_vertex =
+					vertex_fifo[(vertex_offset - 1 - recent) & ((2 * MP_CODEC_FIFO_SIZE) - 1)];
+				third = is_recent ? recent_vertex : next;
+				next += !is_recent;
+				data += is_recent;
+				vertex_fifo[vertex_offset & ((2 * MP_CODEC_FIFO_SIZE) - 1)] = third;
+				vertex_offset += !is_recent;
+			}
+
+			// The face turns so the shared edge starts at "corner", and its new edges follow:
+			uint32_t first = edge[1];
+			uint32_t second = edge[0];
+			face[corner] = first;
+			face[mp_codec_next_corner(corner)] = second;
+			face[mp_codec_next_corner(mp_codec_next_corner(corner))] = third;
+			uint32_t *new_edge = edge_fifo[(edge_offset++) & (MP_CODEC_FIFO_SIZE - 1)];
+			new_edge[0] = second;
+			new_edge[1] = third;
+			new_edge = edge_fifo[(edge_offset++) & (MP_CODEC_FIFO_SIZE - 1)];
+			new_edge[0] = third;
+			new_edge[1] = first;
+			continue;
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			uint64_t value;
+			data = mp_codec_read_varint(data, end, &value);
+			if (!data) { return -1; }
+			if (value == 0)
+			{
+				face[k] = next++;
+			}
+			else if (value <= MP_CODEC_FIFO_SIZE)
+			{
+				face[k] = vertex_fifo[(vertex_offset - value) & ((2 * MP_CODEC_FIFO_SIZE) - 1)];
+				continue;
+			}
+			else
+			{
+				if (value - 17 > UINT32_MAX) { return -1; }
+				face[k] = last + mp_codec_unzigzag((uint32_t)(value - 17));
+				last = face[k];
+			}
+			vertex_fifo[(vertex_offset++) & ((2 * MP_CODEC_FIFO_SIZE) - 1)] = face[k];
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t *new_edge = edge_fifo[(edge_offset++) & (MP_CODEC_FIFO_SIZE - 1)];
+			new_edge[0] = face[k];
+			new_edge[1] = face[(k + 1) % 3];
+		}
+	}
+	return 0;
+}
+
+size_t mp_codec_vertex_bound(uint32_t count, uint32_t element_size)
+{
+	// Every group raw, plus its mode bits and the block and plane offsets:
+	size_t num_blocks = ((size_t)count + MP_CODEC_VERTEX_BLOCK_SIZE - 1) /
+							MP_CODEC_VERTEX_BLOCK_SIZE;
+	size_t num_groups = ((size_t)count + MP_CODEC_GROUP_SIZE - 1) / MP_CODEC_GROUP_SIZE +
+										num_blocks;
+	return sizeof(mp_codec_vertex_header_t) + (num_blocks * sizeof(uint64_t)) +
+		(num_blocks * element_size * sizeof(uint32_t)) +
+		((size_t)element_size * num_groups * (MP_CODEC_GROUP_SIZE + 1));
+}
+
+size_t mp_codec_encode_vertices(const void *elements, uint32_t count, uint32_t element_size,
+								uint8_t *buffer)
+{
+	mp_codec_vertex_header_t header = { count, element_size, 0, 0 };
+	header.num_blocks = (count + MP_CODEC_VERTEX_BLOCK_SIZE - 1) / MP_CODEC_VERTEX_BLOCK_SIZE;
+	memcpy(buffer, &header, sizeof(header));
+	uint8_t *block_offsets = buffer + sizeof(header);
+	uint8_t *data = block_offsets + ((size_t)header.num_blocks * sizeof(uint64_t));
+	const uint8_t *bytes = elements;
+
+	for (uint32_t b = 0; b < header.num_blocks; b++)
+	{
+		uint64_t offset = data - buffer;
+		memcpy(block_offsets + ((size_t)b * sizeof(uint64_t)), &offset, sizeof(offset));
+
+		uint32_t first = b * MP_CODEC_VERTEX_BLOCK_SIZE;
+		uint32_t block_count = count - first;
+		if (block_count > MP_CODEC_VERTEX_BLOCK_SIZE) { block_count = MP_CODEC_VERTEX_BLOCK_SIZE; }
+		uint32_t num_groups = (block_count + MP_CODEC_GROUP_SIZE - 1) / MP_CODEC_GROUP_SIZE;
+
+		uint8_t *block = data;
+		uint8_t *plane_offsets = block;
+		data += (size_t)element_size * sizeof(uint32_t);
+		for (uint32_t k = 0; k < element_size; k++)
+		{
+			uint32_t plane_offset = data - block;
+			memcpy(plane_offsets + (k * sizeof(uint32_t)), &plane_offset, sizeof(uint32_t));
+
+			uint8_t *modes = data;
+			memset(modes, 0, (num_groups + 3) / 4);
+			data += (num_groups + 3) / 4;
+
+			// Differences from the previous element, starting from zero in each block:
+			uint8_t previous = 0;
+			for (uint32_t g = 0; g < num_groups; g++)
+			{
+				uint8_t values[MP_CODEC_GROUP_SIZE] = { 0 };
+				uint8_t maximum = 0;
+				for (uint32_t i = 0; i < MP_CODEC_GROUP_SIZE; i++)
+				{
+					uint32_t element = (g * MP_CODEC_GROUP_SIZE) + i;
+					if (element >= block_count) { break; }
+					uint8_t byte = bytes[(((size_t)first + element) * element_size) + k];
+					values[i] = mp_codec_zigzag_byte(byte, previous);
+					previous = byte;
+					if (values[i] > maximum) { maximum = values[i]; }
+				}
+
+				uint8_t mode = MP_CODEC_GROUP_8_BITS;
+				if (maximum == 0) { mode = MP_CODEC_GROUP_ZERO; }
+				else if (maximum < 4) { mode = MP_CODEC_GROUP_2_BITS; }
+				else if (maximum < 16) { mode = MP_CODEC_GROUP_4_BITS; }
+				modes[g / 4] |= (uint8_t)(mode << ((g % 4) * 2));
+
+				uint32_t bits = 1u << mode;
+				uint32_t per_byte = 8 / bits;
+				for (uint32_t i = 0; (mode != MP_CODEC_GROUP_ZERO) &&
+							(i < MP_CODEC_GROUP_SIZE); i += per_byte)
+				{
+					uint8_t packed = 0;
+					for (uint32_t j = 0; j < per_byte; j++)
+					{
+						packed |= (uint8_t)(values[i + j] << (j * bits));
+					}
+					*(data++) = packed;
+				}
+			}
+		}
+	}
+
+	return data - buffer;
+}
+
+int mp_codec_decode_vertices(const uint8_t *buffer, size_t size, void *elements, uint32_t count,
+							uint32_t element_size)
+{
+	mp_codec_vertex_header_t header;
+	if (size < sizeof(header)) { return -1; }
+	memcpy(&header, buffer, sizeof(header));
+	if ((header.count != count) || (header.element_size != element_size) ||
+		(header.num_blocks != (count + MP_CODEC_VERTEX_BLOCK_SIZE - 1) /
+							MP_CODEC_VERTEX_BLOCK_SIZE) ||
+		((size - sizeof(header)) / sizeof(uint64_t) < header.num_blocks))
+	{
+		return -1;
+	}
+
+	const uint8_t *block_offsets = buffer + sizeof(header);
+	int failed = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed)
+	for (uint32_t b = 0; b < header.num_blocks; b++)
+	{
+		uint64_t offset;
+		uint64_t end = size;
+		memcpy(&offset, block_offsets + ((size_t)b * sizeof(uint64_t)), sizeof(offset));
+		if (b + 1 < header.num_blocks)
+		{
+			memcpy(&end, block_offsets + (((size_t)b + 1) * sizeof(uint64_t)), sizeof(end));
+		}
+		if ((offset > end) || (end > size)) { failed |= 1; continue; }
+
+		uint32_t first = b * MP_CODEC_VERTEX_BLOCK_SIZE;
+		uint32_t block_count = count - first;
+		if (block_count > MP_CODEC_VERTEX_BLOCK_SIZE) { block_count = MP_CODEC_VERTEX_BLOCK_SIZE; }
+		failed |= mp_codec_decode_vertex_block(buffer + offset, buffer + end,
+				(uint8_t *)elements + ((size_t)first * element_size), block_count,
+								element_size) ? 1 : 0;
+	}
+	return failed ? -1 : 0;
+}
+
+int mp_codec_decode_vertex_block(const uint8_t *data, const uint8_t *end, uint8_t *elements,
+					uint32_t count, uint32_t element_size)
+{
+	uint32_t num_groups = (count + MP_CODEC_GROUP_SIZE - 1) / MP_CODEC_GROUP_SIZE;
+	uint32_t modes_size = (num_groups + 3) / 4;
+	if ((size_t)(end - data) < (size_t)element_size * (sizeof(uint32_t) + modes_size)) { return -1; }
+
+	// One cursor and running byte per plane, so whole groups of elements are written together:
+	const uint8_t *modes[MP_CODEC_MAX_ELEMENT_SIZE];
+	const uint8_t *cursors[MP_CODEC_MAX_ELEMENT_SIZE];
+	#ifdef __SSE2__
+	__m128i previous[MP_CODEC_MAX_ELEMENT_SIZE];
+	#else
+	uint8_t previous[MP_CODEC_MAX_ELEMENT_SIZE];
+	#endif
+	if (element_size > MP_CODEC_MAX_ELEMENT_SIZE) { return -1; }
+	for (uint32_t k = 0; k < element_size; k++)
+	{
+		uint32_t plane_offset;
+		memcpy(&plane_offset, data + (k * sizeof(uint32_t)), sizeof(uint32_t));
+		if (plane_offset > (size_t)(end - data) - modes_size) { return -1; }
+		modes[k] = data + plane_offset;
+		cursors[k] = modes[k] + modes_size;
+		memset(&(previous[k]), 0, sizeof(previous[k]));
+
+		// Plane sizes follow from their modes, so the group loop below needs no bounds checks:
+		size_t plane_size = 0;
+		for (uint32_t g = 0; g < num_groups; g++)
+		{
+			plane_size += mp_codec_group_bytes((modes[k][g / 4] >> ((g % 4) * 2)) & 3);
+		}
+		if (plane_size > (size_t)(end - cursors[k])) { return -1; }
+	}
+
+	uint8_t tile[MP_CODEC_GROUP_SIZE * MP_CODEC_MAX_ELEMENT_SIZE];
+	for (uint32_t g = 0; g < num_groups; g++)
+	{
+		// Whole groups go straight to the output, and the last partial one through the tile:
+		uint32_t group_count = count - (g * MP_CODEC_GROUP_SIZE);
+		if (group_count > MP_CODEC_GROUP_SIZE) { group_count = MP_CODEC_GROUP_SIZE; }
+		uint8_t *group = elements + ((size_t)g * MP_CODEC_GROUP_SIZE * element_size);
+		uint8_t *destination = (group_count == MP_CODEC_GROUP_SIZE) ? group : tile;
+
+		uint32_t k = 0;
+		uint8_t values[MP_CODEC_GROUP_SIZE];
+		#ifdef __SSE2__
+		/* Four planes at a time are transposed in registers to four bytes of each element. Byte
+		 * unpacks pair the planes, then word unpacks give four elements per register: */
+		for (; k + 4 <= element_size; k += 4)
+		{
+			__m128i planes[4] = {
+				mp_codec_unpack_plane_epi8(modes, cursors, previous, k, g),
+				mp_codec_unpack_plane_epi8(modes, cursors, previous, k + 1, g),
+				mp_codec_unpack_plane_epi8(modes, cursors, previous, k + 2, g),
+				mp_codec_unpack_plane_epi8(modes, cursors, previous, k + 3, g)
+			};
+			__m128i low = _mm_unpacklo_epi8(planes[0], planes[1]);
+			__m128i high = _mm_unpackhi_epi8(planes[0], planes[1]);
+			__m128i low_next = _mm_unpacklo_epi8(planes[2], planes[3]);
+			__m128i high_next = _mm_unpackhi_epi8(planes[2], planes[3]);
+			__m128i words[4] = {
+				_mm_unpacklo_epi16(low, low_next), _mm_unpackhi_epi16(low, low_next),
+				_mm_unpacklo_epi16(high, high_next), _mm_unpackhi_epi16(high, high_next)
+			};
+			for (int j = 0; j < 4; j++)
+			{
+				uint8_t *element = destination + ((size_t)j * 4 * element_size) + k;
+				for (int i = 0; i < 4; i++)
+				{
+					int32_t word = _mm_cvtsi128_si32(words[j]);
+					memcpy(element + (i * element_size), &word, sizeof(word));
+					words[j] = _mm_srli_si128(words[j], 4);
+				}
+			}
+		}
+		#endif
+
+		for (; k < element_size; k++)
+		{
+			#ifdef __SSE2__
+			_mm_storeu_si128((__m128i *)values,
+				mp_codec_unpack_plane_epi8(modes, cursors, previous, k, g));
+			#else
+			uint8_t mode = (modes[k][g / 4] >> ((g % 4) * 2)) & 3;
+			mp_codec_unpack_group(cursors[k], mode, &(previous[k]), values);
+			cursors[k] += mp_codec_group_bytes(mode);
+			#endif
+			for (uint32_t i = 0; i < MP_CODEC_GROUP_SIZE; i++)
+			{
+				destination[(i * element_size) + k] = values[i];
+			}
+		}
+
+		if (destination == tile) { memcpy(group, tile, (size_t)group_count * element_size); }
+	}
+	return 0;
+}
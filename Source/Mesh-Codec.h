@@ -0,0 +1,279 @@
+#ifndef MP_MESH_CODEC_H
+#define MP_MESH_CODEC_H
+
+#include <NM-Config/Config.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Mesh.h"
+
+#define MP_CODEC_MAGIC			"MPMESHC"
+#define MP_CODEC_VERSION		2
+
+// Faces and vertex elements per block. Blocks are coded independently, and decoded in parallel:
+#define MP_CODEC_INDEX_BLOCK_SIZE	(1 << 14)
+#define MP_CODEC_VERTEX_BLOCK_SIZE	(1 << 14)
+
+// Recent edges and vertices the index codec refers back to. Edge slot 15 means no shared edge:
+#define MP_CODEC_FIFO_SIZE		16
+#define MP_CODEC_NO_EDGE		15
+
+// Vertex codec values per bit-packed group, and the group modes:
+#define MP_CODEC_GROUP_SIZE		16
+#define MP_CODEC_MAX_ELEMENT_SIZE	64
+
+enum
+{
+	MP_CODEC_GROUP_ZERO,
+	MP_CODEC_GROUP_2_BITS,
+	MP_CODEC_GROUP_4_BITS,
+	MP_CODEC_GROUP_8_BITS
+};
+
+// Third vertex of a face sharing an edge with a recent face:
+enum
+{
+	MP_CODEC_VERTEX_NEXT,		// One past the highest new vertex so far.
+	MP_CODEC_VERTEX_FIFO,		// A recent vertex, with its slot in the next byte.
+	MP_CODEC_VERTEX_EXPLICIT	// Varint of the zigzag difference from the last explicit one.
+};
+
+enum
+{
+	MP_CODEC_STREAM_VERTICES,
+	MP_CODEC_STREAM_NORMALS,
+	MP_CODEC_STREAM_COLOURS,
+	MP_CODEC_STREAM_UV_COORDINATES,
+	MP_CODEC_STREAM_POSITION_INDICES,
+	MP_CODEC_STREAM_NORMAL_INDICES,
+	MP_CODEC_STREAM_COLOUR_INDICES,
+	MP_CODEC_STREAM_UV_INDICES,
+	MP_CODEC_NUM_STREAMS
+};
+
+/* Index stream: face count, block count, then each block's state at its start, then the codes.
+ * Each face is a code byte, high nibble the edge slot shared with a recent face (reversed), then
+ * the corner that edge starts at and the kind of the third vertex. Faces sharing no edge have
+ * three vertex varints instead: 0 for the next vertex, 1 to 16 for a recent vertex, or 17 plus
+ * the zigzag difference from the last explicit vertex. Corner order is kept exactly: */
+typedef struct
+{
+	uint64_t offset;	// From the start of the stream.
+	uint32_t next;
+	uint32_t last;
+} mp_codec_index_block_t;
+
+/* Vertex stream: element count and size, block count, then each block's offset. A block starts
+ * with the offset of each byte plane, then each plane holds the zigzag byte differences between
+ * consecutive elements, in groups of 16 packed to 0, 2, 4 or 8 bits, with 2-bit modes up front: */
+typedef struct
+{
+	uint32_t count;
+	uint32_t element_size;
+	uint32_t num_blocks;
+	uint32_t padding;
+} mp_codec_vertex_header_t;
+
+/* Compressed base level of a mesh, with the streams one after another. A quantised mesh stores its
+ * 16-bit positions and UVs instead of the floats, which are decoded from them: */
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t normal_size;	// Guards against mixing 8 and 16-bit normal builds.
+
+	uint8_t has_normals;
+	uint8_t is_quantised;
+	uint8_t padding[2];
+	uint32_t num_vertices;
+	uint32_t num_normals;
+	uint32_t num_colours;
+	uint32_t num_uv_coordinates;
+	uint32_t num_faces;
+	mp_mesh_quantised_t quantised;	// Without its pointers, which are the vertex streams.
+
+	uint64_t offsets[MP_CODEC_NUM_STREAMS];
+	uint64_t sizes[MP_CODEC_NUM_STREAMS];	// 0 for attribute indices equal to position indices.
+} mp_codec_header_t;
+
+typedef struct
+{
+	size_t size;
+	uint8_t *data;
+} mp_mesh_compressed_t;
+
+int mp_mesh_compress(mp_mesh_t *mesh, mp_mesh_compressed_t *compressed,
+				char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_compressed_free(mp_mesh_compressed_t *compressed);
+int mp_mesh_decompress(mp_mesh_t *mesh, const uint8_t *data, size_t size,
+				char error_message[NM_MAX_ERROR_LENGTH]);
+
+size_t mp_codec_index_bound(uint32_t num_faces);
+size_t mp_codec_encode_indices(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+								uint8_t *buffer);
+int mp_codec_decode_indices(const uint8_t *buffer, size_t size, uint32_t *indices,
+						uint32_t stride, uint32_t num_faces);
+int mp_codec_decode_index_block(const uint8_t *data, const uint8_t *end,
+		const mp_codec_index_block_t *block, uint32_t *indices, uint32_t stride,
+								uint32_t num_faces);
+
+size_t mp_codec_vertex_bound(uint32_t count, uint32_t element_size);
+size_t mp_codec_encode_vertices(const void *elements, uint32_t count, uint32_t element_size,
+								uint8_t *buffer);
+int mp_codec_decode_vertices(const uint8_t *buffer, size_t size, void *elements, uint32_t count,
+							uint32_t element_size);
+int mp_codec_decode_vertex_block(const uint8_t *data, const uint8_t *end, uint8_t *elements,
+					uint32_t count, uint32_t element_size);
+
+static inline uint64_t mp_codec_zigzag(uint32_t a, uint32_t b)
+{
+	int32_t difference = (int32_t)(a - b);
+	return (uint32_t)((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+}
+
+static inline uint32_t mp_codec_unzigzag(uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+static inline uint8_t *mp_codec_write_varint(uint8_t *data, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		*(data++) = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*(data++) = (uint8_t)value;
+	return data;
+}
+
+// Returns NULL on a truncated or overlong varint:
+static inline const uint8_t *mp_codec_read_varint(const uint8_t *data, const uint8_t *end,
+									uint64_t *value)
+{
+	*value = 0;
+	for (int shift = 0; (shift < 64) && (data < end); shift += 7)
+	{
+		uint8_t byte = *(data++);
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) { return data; }
+	}
+	return NULL;
+}
+
+// Recent vertex slot, or -1. Slot 0 is the most recent:
+static inline int mp_codec_find_vertex(const uint32_t *fifo, uint32_t offset, uint32_t vertex)
+{
+	for (int i = 0; i < MP_CODEC_FIFO_SIZE; i++)
+	{
+		if (fifo[(offset - 1 - i) & (MP_CODEC_FIFO_SIZE - 1)] == vertex) { return i; }
+	}
+	return -1;
+}
+
+static inline uint32_t mp_codec_next_corner(uint32_t corner)
+{
+	return (corner == 2) ? 0 : (corner + 1);
+}
+
+static inline uint8_t mp_codec_zigzag_byte(uint8_t a, uint8_t b)
+{
+	uint8_t difference = (uint8_t)(a - b);
+	return (uint8_t)((difference << 1) ^ (uint8_t)((int8_t)difference >> 7));
+}
+
+static inline uint32_t mp_codec_group_bytes(uint8_t mode)
+{
+	return (mode == MP_CODEC_GROUP_ZERO) ? 0 : (MP_CODEC_GROUP_SIZE >> (3 - mode));
+}
+
+// One group of a byte plane back to bytes, summed onto the previous byte and updating it:
+static inline void mp_codec_unpack_group(const uint8_t *data, uint8_t mode, uint8_t *previous,
+								uint8_t values[MP_CODEC_GROUP_SIZE])
+{
+	uint32_t bits = 1u << mode;
+	uint8_t byte = *previous;
+	for (uint32_t i = 0; i < MP_CODEC_GROUP_SIZE; i++)
+	{
+		uint8_t delta = 0;
+		if (mode != MP_CODEC_GROUP_ZERO)
+		{
+			uint32_t per_byte = 8 / bits;
+			delta = (uint8_t)(data[i / per_byte] >> ((i % per_byte) * bits)) &
+								(uint8_t)((1u << bits) - 1);
+		}
+		byte += (uint8_t)((delta >> 1) ^ (uint8_t)(0u - (delta & 1)));
+		values[i] = byte;
+	}
+	*previous = byte;
+}
+
+#ifdef __SSE2__
+/* As above, with the previous byte kept in every lane, so the running sum never leaves registers
+ * between groups: */
+static inline __m128i mp_codec_unpack_group_epi8(const uint8_t *data, uint8_t mode,
+										__m128i *previous)
+{
+	__m128i deltas = _mm_setzero_si128();
+	if (mode == MP_CODEC_GROUP_8_BITS)
+	{
+		deltas = _mm_loadu_si128((const __m128i *)data);
+	}
+	else if (mode == MP_CODEC_GROUP_4_BITS)
+	{
+		// Low nibble first, so interleaving the low and high nibbles restores the order:
+		__m128i packed = _mm_loadl_epi64((const __m128i *)data);
+		__m128i mask = _mm_set1_epi8(0x0f);
+		deltas = _mm_unpacklo_epi8(_mm_and_si128(packed, mask),
+					_mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+	}
+	else if (mode == MP_CODEC_GROUP_2_BITS)
+	{
+		// Each source byte spread over four lanes, then shifted down by each lane's place in it:
+		uint32_t packed;
+		memcpy(&packed, data, sizeof(packed));
+		__m128i bytes = _mm_cvtsi32_si128((int32_t)packed);
+		bytes = _mm_unpacklo_epi8(bytes, bytes);
+		bytes = _mm_unpacklo_epi16(bytes, bytes);
+		__m128i shifted = _mm_or_si128(
+			_mm_and_si128(bytes, _mm_set1_epi32(0x000000ff)),
+			_mm_and_si128(_mm_srli_epi32(bytes, 2), _mm_set1_epi32(0x0000ff00)));
+		shifted = _mm_or_si128(shifted,
+			_mm_and_si128(_mm_srli_epi32(bytes, 4), _mm_set1_epi32(0x00ff0000)));
+		shifted = _mm_or_si128(shifted,
+			_mm_and_si128(_mm_srli_epi32(bytes, 6), _mm_set1_epi32((int32_t)0xff000000)));
+		deltas = _mm_and_si128(shifted, _mm_set1_epi8(0x03));
+	}
+
+	// Zigzag back to a signed difference, then a prefix sum in four shifts:
+	__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(deltas, _mm_set1_epi8(1)));
+	__m128i sum = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(deltas, 1), _mm_set1_epi8(0x7f)),
+										sign);
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 1));
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 2));
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+	sum = _mm_add_epi8(sum, *previous);
+
+	// The last byte broadcast for the next group:
+	__m128i last = _mm_unpackhi_epi8(sum, sum);
+	last = _mm_unpackhi_epi16(last, last);
+	*previous = _mm_shuffle_epi32(last, 0xff);
+	return sum;
+}
+
+// Group "group" of plane "plane" in a vertex block, moving that plane's cursor past it:
+static inline __m128i mp_codec_unpack_plane_epi8(const uint8_t **modes, const uint8_t **cursors,
+					__m128i *previous, uint32_t plane, uint32_t group)
+{
+	uint8_t mode = (modes[plane][group / 4] >> ((group % 4) * 2)) & 3;
+	__m128i values = mp_codec_unpack_group_epi8(cursors[plane], mode, &(previous[plane]));
+	cursors[plane] += mp_codec_group_bytes(mode);
+	return values;
+}
+#endif
+
+#endif
@@ -0,0 +1,401 @@
+#include "Mesh-Loader.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+int mp_mesh_load_obj_parallel(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	mp_file_t file;
+	uint32_t file_flags = MP_FILE_FLAG_SEQUENTIAL;
+	mp_obj_chunk_t *chunks = NULL;
+	mp_obj_chunk_t totals;
+	memset(&totals, 0, sizeof(totals));
+
+	if (!(mesh->flags & MP_MESH_FLAG_NO_FILE_MAPPING)) { file_flags |= MP_FILE_FLAG_MAP; }
+	if (mp_file_open(&file, mesh->path, file_flags) || !file.length)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not read file \"%s\".", mesh->path);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/*************************************
+	 * Split into newline-aligned chunks *
+	 *************************************/
+
+	const char *data = file.data;
+	size_t length = file.length;
+	uint32_t num_chunks = 1;
+	#ifdef _OPENMP
+	num_chunks = omp_get_max_threads() * MP_OBJ_CHUNKS_PER_THREAD;
+	#endif
+	if ((length / num_chunks) < MP_OBJ_MIN_CHUNK_SIZE)
+	{
+		num_chunks = (length / MP_OBJ_MIN_CHUNK_SIZE) + 1;
+	}
+
+	chunks = malloc(num_chunks * sizeof(mp_obj_chunk_t));
+	if (!chunks)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for parsing file \"%s\".", mesh->path);
+		return_value = -1;
+		goto cleanup;
+	}
+	memset(chunks, 0, num_chunks * sizeof(mp_obj_chunk_t));
+
+	const char *end = data + length;
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		if (i == 0) { chunks[i].start = data; }
+		else { chunks[i].start = chunks[i - 1].end; }
+
+		// Move the end of the chunk forward to the start of the next line:
+		const char *chunk_end = data + ((length * (i + 1)) / num_chunks);
+		if (chunk_end < chunks[i].start) { chunk_end = chunks[i].start; }
+		if (i == (num_chunks - 1)) { chunk_end = end; }
+		else if (chunk_end > data)
+		{
+			const char *newline = memchr(chunk_end - 1, '\n', end - (chunk_end - 1));
+			if (newline) { chunk_end = newline + 1; }
+			else { chunk_end = end; }
+		}
+		chunks[i].end = chunk_end;
+	}
+
+	/************************************************
+	 * Count elements, then offset with prefix sums *
+	 ************************************************/
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		mp_obj_count_chunk(&(chunks[i]));
+		mp_file_release_range(&file, chunks[i].start, chunks[i].end);
+	}
+
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		chunks[i].first_vertex = totals.num_vertices;
+		chunks[i].first_normal = totals.num_normals;
+		chunks[i].first_uv_coordinate = totals.num_uv_coordinates;
+		chunks[i].first_face = totals.num_faces;
+
+		totals.num_vertices += chunks[i].num_vertices;
+		totals.num_normals += chunks[i].num_normals;
+		totals.num_uv_coordinates += chunks[i].num_uv_coordinates;
+		totals.num_faces += chunks[i].num_faces;
+	}
+
+	if ((totals.num_vertices > UINT32_MAX) || (totals.num_normals > UINT32_MAX) ||
+		(totals.num_uv_coordinates > UINT32_MAX) || ((totals.num_faces * 3) > UINT32_MAX))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" is too large.", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	mesh->num_vertices = totals.num_vertices;
+	mesh->has_normals = (totals.num_normals > 0);
+	mesh->num_normals = totals.num_normals;
+	mesh->num_colours = totals.num_normals; // Match TinyOBJ path: colours come from normals.
+	mesh->num_uv_coordinates = totals.num_uv_coordinates;
+	mesh->num_edges = totals.num_faces * 3;
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		mesh->num_faces[i] = totals.num_faces;
+	}
+
+	if (!mesh->num_vertices || !mesh->num_faces[0])
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" has no vertices/faces.", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// If any array is empty, fill it with a single element:
+	if (!mesh->num_normals) { mesh->num_normals = 1; }
+	if (!mesh->num_colours) { mesh->num_colours = 1; }
+	if (!mesh->num_uv_coordinates) { mesh->num_uv_coordinates = 1; }
+
+	if (mp_mesh_allocate(mesh, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/*************************************
+	 * Parse chunks into the mesh arrays *
+	 *************************************/
+
+	uint32_t failed_chunks = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(+:failed_chunks)
+	for (uint32_t i = 0; i < num_chunks; i++)
+	{
+		if (mp_obj_parse_chunk(mesh, &(chunks[i]), &totals)) { failed_chunks++; }
+		mp_file_release_range(&file, chunks[i].start, chunks[i].end);
+	}
+
+	if (failed_chunks)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"File \"%s\" contains invalid face indices.", mesh->path);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	cleanup:
+	if (chunks) { free(chunks); }
+	mp_file_close(&file);
+	return return_value;
+}
+
+void mp_obj_count_chunk(mp_obj_chunk_t *chunk)
+{
+	const char *line = chunk->start;
+	while (line < chunk->end)
+	{
+		const char *line_end = memchr(line, '\n', chunk->end - line);
+		if (!line_end) { line_end = chunk->end; }
+
+		const char *p = mp_obj_skip_space(line, line_end);
+		if ((line_end - p) >= 2)
+		{
+			if ((p[0] == 'v') && MP_OBJ_IS_SPACE(p[1])) { chunk->num_vertices++; }
+			else if ((p[0] == 'v') && (p[1] == 'n') && ((line_end - p) >= 3) &&
+						MP_OBJ_IS_SPACE(p[2])) { chunk->num_normals++; }
+			else if ((p[0] == 'v') && (p[1] == 't') && ((line_end - p) >= 3) &&
+						MP_OBJ_IS_SPACE(p[2])) { chunk->num_uv_coordinates++; }
+			else if ((p[0] == 'f') && MP_OBJ_IS_SPACE(p[1]))
+			{
+				// Polygons are triangulated as a fan, so each corner past the second adds one:
+				uint32_t num_corners = 0;
+				p = mp_obj_skip_space(p + 1, line_end);
+				while (p < line_end)
+				{
+					num_corners++;
+					while ((p < line_end) && !MP_OBJ_IS_SPACE(*p)) { p++; }
+					p = mp_obj_skip_space(p, line_end);
+				}
+				if (num_corners > 2) { chunk->num_faces += num_corners - 2; }
+			}
+		}
+
+		line = line_end + 1;
+	}
+}
+
+int mp_obj_parse_chunk(mp_mesh_t *mesh, mp_obj_chunk_t *chunk, mp_obj_chunk_t *totals)
+{
+	uint64_t vertex = chunk->first_vertex;
+	uint64_t normal = chunk->first_normal;
+	uint64_t uv_coordinate = chunk->first_uv_coordinate;
+	uint64_t face = chunk->first_face;
+
+	const char *line = chunk->start;
+	while (line < chunk->end)
+	{
+		const char *line_end = memchr(line, '\n', chunk->end - line);
+		if (!line_end) { line_end = chunk->end; }
+
+		const char *p = mp_obj_skip_space(line, line_end);
+		if ((line_end - p) < 2) { line = line_end + 1; continue; }
+
+		if ((p[0] == 'v') && MP_OBJ_IS_SPACE(p[1]))
+		{
+			p = mp_obj_parse_float(p + 1, line_end, &(mesh->vertices[vertex].x));
+			p = mp_obj_parse_float(p, line_end, &(mesh->vertices[vertex].y));
+			p = mp_obj_parse_float(p, line_end, &(mesh->vertices[vertex].z));
+			vertex++;
+		}
+		else if ((p[0] == 'v') && (p[1] == 'n') && ((line_end - p) >= 3) && MP_OBJ_IS_SPACE(p[2]))
+		{
+			float x = 0.f, y = 0.f, z = 0.f;
+			p = mp_obj_parse_float(p + 2, line_end, &x);
+			p = mp_obj_parse_float(p, line_end, &y);
+			p = mp_obj_parse_float(p, line_end, &z);
+
+			mesh->normals[normal] = mp_mesh_encode_normal(x, y, z);
+
+			mesh->colours[normal].r = (uint8_t)(x * 255);
+			mesh->colours[normal].g = (uint8_t)(y * 255);
+			mesh->colours[normal].b = (uint8_t)(z * 255);
+			mesh->colours[normal].a = 255;
+			normal++;
+		}
+		else if ((p[0] == 'v') && (p[1] == 't') && ((line_end - p) >= 3) && MP_OBJ_IS_SPACE(p[2]))
+		{
+			p = mp_obj_parse_float(p + 2, line_end, &(mesh->uv_coordinates[uv_coordinate].u));
+			p = mp_obj_parse_float(p, line_end, &(mesh->uv_coordinates[uv_coordinate].v));
+			uv_coordinate++;
+		}
+		else if ((p[0] == 'f') && MP_OBJ_IS_SPACE(p[1]))
+		{
+			uint32_t corner[3][3]; // First, previous and current corner: p, n, u.
+			uint32_t num_corners = 0;
+			p = mp_obj_skip_space(p + 1, line_end);
+			while (p < line_end)
+			{
+				int64_t index[3] = { 0, 0, 0 };
+				int present[3] = { 0, 0, 0 };
+				p = mp_obj_parse_index(p, line_end, &(index[0]), &(present[0]));
+				if ((p < line_end) && (*p == '/'))
+				{
+					p = mp_obj_parse_index(p + 1, line_end, &(index[2]), &(present[2]));
+					if ((p < line_end) && (*p == '/'))
+					{
+						p = mp_obj_parse_index(p + 1, line_end,
+									&(index[1]), &(present[1]));
+					}
+				}
+				while ((p < line_end) && !MP_OBJ_IS_SPACE(*p)) { p++; }
+				p = mp_obj_skip_space(p, line_end);
+
+				// Resolve 1-based and relative indices against global counts:
+				uint64_t counts[3] = { vertex, normal, uv_coordinate };
+				uint64_t limits[3] = { totals->num_vertices, totals->num_normals,
+							totals->num_uv_coordinates };
+				uint32_t slot = (num_corners < 2) ? num_corners : 2;
+				for (int j = 0; j < 3; j++)
+				{
+					if (!present[j] || !limits[j])
+					{
+						if (!present[0]) { return -1; }
+						corner[slot][j] = 0;
+						continue;
+					}
+					if (index[j] > 0) { index[j]--; }
+					else { index[j] += counts[j]; }
+					if ((index[j] < 0) || ((uint64_t)index[j] >= limits[j])) { return -1; }
+					corner[slot][j] = index[j];
+				}
+				num_corners++;
+
+				if (num_corners < 3) { continue; }
+				for (int j = 0; j < 3; j++)
+				{
+					mesh->faces[0][face].p[j] = corner[j][0];
+					mesh->faces[0][face].n[j] = corner[j][1];
+					mesh->faces[0][face].c[j] = corner[j][1];
+					mesh->faces[0][face].u[j] = corner[j][2];
+				}
+				face++;
+				memcpy(corner[1], corner[2], sizeof(corner[1]));
+			}
+		}
+
+		line = line_end + 1;
+	}
+
+	return 0;
+}
+
+const char *mp_obj_skip_space(const char *p, const char *end)
+{
+	while ((p < end) && MP_OBJ_IS_SPACE(*p)) { p++; }
+	return p;
+}
+
+const char *mp_obj_parse_index(const char *p, const char *end, int64_t *value, int *present)
+{
+	int negative = 0;
+	*value = 0;
+	*present = 0;
+
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+	while ((p < end) && (*p >= '0') && (*p <= '9'))
+	{
+		*value = (*value * 10) + (*p - '0');
+		*present = 1;
+		p++;
+	}
+	if (negative) { *value = -(*value); }
+
+	return p;
+}
+
+const char *mp_obj_parse_float(const char *p, const char *end, float *value)
+{
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	p = mp_obj_skip_space(p, end);
+	const char *start = p;
+
+	int negative = 0;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int num_digits = 0;
+	while ((p < end) && (*p >= '0') && (*p <= '9'))
+	{
+		if (mantissa < (UINT64_MAX / 10) - 9) { mantissa = (mantissa * 10) + (*p - '0'); }
+		else { exponent++; }
+		num_digits++;
+		p++;
+	}
+	if ((p < end) && (*p == '.'))
+	{
+		p++;
+		while ((p < end) && (*p >= '0') && (*p <= '9'))
+		{
+			if (mantissa < (UINT64_MAX / 10) - 9)
+			{
+				mantissa = (mantissa * 10) + (*p - '0');
+				exponent--;
+			}
+			num_digits++;
+			p++;
+		}
+	}
+	if ((p < end) && num_digits && ((*p == 'e') || (*p == 'E')))
+	{
+		int64_t exponent_value;
+		int present;
+		const char *exponent_end = mp_obj_parse_index(p + 1, end, &exponent_value, &present);
+		if (present)
+		{
+			if (exponent_value > 400) { exponent_value = 400; }
+			if (exponent_value < -400) { exponent_value = -400; }
+			exponent += exponent_value;
+			p = exponent_end;
+		}
+	}
+
+	// Anything unusual (inf, nan, missing digits) goes through the C library:
+	if (!num_digits || ((p < end) && !MP_OBJ_IS_SPACE(*p)))
+	{
+		char buffer[64];
+		const char *token_end = start;
+		while ((token_end < end) && !MP_OBJ_IS_SPACE(*token_end)) { token_end++; }
+		size_t token_length = token_end - start;
+		if (token_length >= sizeof(buffer)) { token_length = sizeof(buffer) - 1; }
+		memcpy(buffer, start, token_length);
+		buffer[token_length] = '\0';
+		*value = strtof(buffer, NULL);
+		return token_end;
+	}
+
+	double result = (double)mantissa;
+	while (exponent > 22) { result *= 1e22; exponent -= 22; }
+	while (exponent < -22) { result /= 1e22; exponent += 22; }
+	if (exponent >= 0) { result *= powers[exponent]; }
+	else { result /= powers[-exponent]; }
+
+	*value = (float)(negative ? -result : result);
+	return p;
+}
@@ -2,17 +2,94 @@
 
 int mp_mesh_load(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 {
+	char cache_error_message[NM_MAX_ERROR_LENGTH];
+	uint8_t use_cache = !(mesh->flags & MP_MESH_FLAG_NO_CACHE);
+
+	// A missing or stale cache just means a cold load:
+	if (use_cache && !mp_mesh_cache_read(mesh, cache_error_message))
+	{
+		return mp_mesh_load_finish(mesh, error_message);
+	}
+
 	if (mp_mesh_load_obj(mesh, error_message))
 	{
 		mp_mesh_free(mesh);
 		return -1;
 	}
-	if (mp_mesh_calculate_edges(mesh, error_message)) { return -1; }
-	if (mp_mesh_check_manifold(mesh, error_message)) { return -1; }
+
+	// Welding goes first, so seams are connected before edges are paired:
+	if ((mesh->flags & MP_MESH_FLAG_WELD_VERTICES) &&
+		mp_mesh_weld_vertices(mesh, mesh->weld_epsilon, error_message))
+	{
+		mp_mesh_free(mesh);
+		return -1;
+	}
+
+	// Normals go after welding too, so they are smooth across welded seams:
+	if ((mesh->flags & MP_MESH_FLAG_GENERATE_NORMALS) && !mesh->has_normals &&
+		mp_mesh_generate_normals(mesh, mesh->normal_weighting, error_message))
+	{
+		mp_mesh_free(mesh);
+		return -1;
+	}
+
+	if (mp_mesh_load_edges(mesh, error_message)) { return -1; }
+
+	// Quantised before caching, so a cached load maps the quantised arrays too:
+	if ((mesh->flags & MP_MESH_FLAG_QUANTISE_ATTRIBUTES) &&
+		mp_mesh_quantise(mesh, mesh->uv_format, error_message))
+	{
+		mp_mesh_free(mesh);
+		return -1;
+	}
+
+	// Failing to write the cache doesn't affect the loaded mesh:
+	if (use_cache) { mp_mesh_cache_write(mesh, cache_error_message); }
+	return mp_mesh_load_finish(mesh, error_message);
+}
+
+int mp_mesh_load_edges(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	// Edges are sorted once, for both pairing and the manifold check:
+	mp_mesh_connectivity_t connectivity;
+	uint8_t sort_edges = !(mesh->flags & MP_MESH_FLAG_HASH_EDGE_PAIRING);
+	if (mp_mesh_build_connectivity(mesh, &connectivity, sort_edges, error_message)) { return -1; }
+	if (mp_mesh_calculate_edges_from_connectivity(mesh, &connectivity, error_message) ||
+		mp_mesh_check_manifold_from_connectivity(mesh, &connectivity, error_message))
+	{
+		mp_mesh_connectivity_free(&connectivity);
+		return -1;
+	}
+	mp_mesh_connectivity_free(&connectivity);
+	return 0;
+}
+
+int mp_mesh_load_finish(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (mesh->flags & MP_MESH_FLAG_STRUCTURE_OF_ARRAYS)
+	{
+		if (mp_mesh_convert_to_soa(mesh, error_message)) { return -1; }
+	}
+
+	// Layout conversion keeps the vertex order, so quantised arrays from before stay valid:
+	if ((mesh->flags & MP_MESH_FLAG_QUANTISE_ATTRIBUTES) && (!mesh->quantised.positions ||
+		(mesh->quantised.uv_format != mesh->uv_format)))
+	{
+		if (mp_mesh_quantise(mesh, mesh->uv_format, error_message)) { return -1; }
+	}
 	return 0;
 }
 
 int mp_mesh_load_obj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (mesh->flags & MP_MESH_FLAG_PARALLEL_OBJ_LOADER)
+	{
+		return mp_mesh_load_obj_parallel(mesh, error_message);
+	}
+	return mp_mesh_load_obj_tinyobj(mesh, error_message);
+}
+
+int mp_mesh_load_obj_tinyobj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 {
 	tinyobj_attrib_t attrib;
 	tinyobj_shape_t *shapes = NULL;
@@ -20,9 +97,20 @@ int mp_mesh_load_obj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 	tinyobj_material_t *materials = NULL;
 	size_t num_materials;
 
-	if (tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
-		mesh->path, tinyobj_file_reader_callback, NULL, TINYOBJ_FLAG_TRIANGULATE)
-		!= TINYOBJ_SUCCESS)
+	mp_tinyobj_context_t context;
+	memset(&context, 0, sizeof(context));
+	context.file_flags = MP_FILE_FLAG_SEQUENTIAL;
+	if (!(mesh->flags & MP_MESH_FLAG_NO_FILE_MAPPING)) { context.file_flags |= MP_FILE_FLAG_MAP; }
+
+	int parse_result = tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+		&num_materials, mesh->path, tinyobj_file_reader_callback, &context,
+		TINYOBJ_FLAG_TRIANGULATE);
+
+	// TinyOBJ releases files itself, except on some early errors:
+	mp_file_close(&(context.files[0]));
+	mp_file_close(&(context.files[1]));
+
+	if (parse_result != TINYOBJ_SUCCESS)
 	{
 		snprintf(error_message, NM_MAX_ERROR_LENGTH,
 			"Could not parse file \"%s\" with TinyOBJLoader-C.", mesh->path);
@@ -75,12 +163,10 @@ int mp_mesh_load_obj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 		mesh->vertices[i].z = attrib.vertices[(i * 3) + 2];
 	}
 
+	mesh->has_normals = (attrib.num_normals > 0);
+	mp_mesh_encode_normals(attrib.normals, attrib.num_normals, mesh->normals);
 	for (unsigned int i = 0; i < attrib.num_normals; i++)
 	{
-		mesh->normals[i].x = (int8_t)(attrib.normals[i * 3] * 255);
-		mesh->normals[i].y = (int8_t)(attrib.normals[(i * 3) + 1] * 255);
-		mesh->normals[i].z = (int8_t)(attrib.normals[(i * 3) + 2] * 255);
-
 		mesh->colours[i].r = (uint8_t)(attrib.normals[i * 3] * 255);
 		mesh->colours[i].g = (uint8_t)(attrib.normals[(i * 3) + 1] * 255);
 		mesh->colours[i].b = (uint8_t)(attrib.normals[(i * 3) + 2] * 255);
@@ -89,8 +175,8 @@ int mp_mesh_load_obj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 
 	for (unsigned int i = 0; i < attrib.num_texcoords; i++)
 	{
-		mesh->uv_coordinates[i].u = attrib.texcoords[i * 3];
-		mesh->uv_coordinates[i].v = attrib.texcoords[(i * 3) + 1];
+		mesh->uv_coordinates[i].u = attrib.texcoords[i * 2];
+		mesh->uv_coordinates[i].v = attrib.texcoords[(i * 2) + 1];
 	}
 
 	for (unsigned int i = 0; i < attrib.num_face_num_verts; i++)
@@ -121,7 +207,38 @@ int mp_mesh_load_obj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 void tinyobj_file_reader_callback(void *ctx, const char *filename, const int is_mtl,
 				const char *obj_filename, char **data, size_t *len)
 {
-	*data = SDL_LoadFile(filename, len);
+	mp_tinyobj_context_t *context = ctx;
+	*data = NULL;
+	*len = 0;
+
+	if (!context)
+	{
+		*data = SDL_LoadFile(filename, len);
+		return;
+	}
+
+	mp_file_t *file = &(context->files[is_mtl ? 1 : 0]);
+	mp_file_close(file);
+	if (mp_file_open(file, filename, context->file_flags)) { return; }
+	*data = file->data;
+	*len = file->length;
+}
+
+void tinyobj_file_release_callback(void *ctx, char *data, size_t len)
+{
+	mp_tinyobj_context_t *context = ctx;
+	if (context)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (context->files[i].data == data)
+			{
+				mp_file_close(&(context->files[i]));
+				return;
+			}
+		}
+	}
+	SDL_free(data);
 }
 
 void tinyobj_free(tinyobj_attrib_t *attrib, size_t num_shapes, tinyobj_shape_t *shapes,
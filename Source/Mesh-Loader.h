@@ -7,13 +7,56 @@
 #include <TinyOBJLoaderC/tinyobj_loader_c.h>
 #include <SDL2/SDL_rwops.h>
 
+#include "File.h"
 #include "Mesh.h"
+#include "Mesh-Cache.h"
+#include "Mesh-Weld.h"
+#include "Mesh-Normals.h"
+#include "Mesh-Quantise.h"
+
+#define MP_OBJ_CHUNKS_PER_THREAD	4
+#define MP_OBJ_MIN_CHUNK_SIZE		(1 << 20)
+#define MP_OBJ_IS_SPACE(c) (((c) == ' ') || ((c) == '\t') || ((c) == '\r'))
+
+typedef struct
+{
+	const char *start;
+	const char *end;
+
+	uint64_t num_vertices;
+	uint64_t num_normals;
+	uint64_t num_uv_coordinates;
+	uint64_t num_faces;
+
+	// Offsets into the mesh arrays, from prefix sums over previous chunks:
+	uint64_t first_vertex;
+	uint64_t first_normal;
+	uint64_t first_uv_coordinate;
+	uint64_t first_face;
+} mp_obj_chunk_t;
+
+typedef struct
+{
+	uint32_t file_flags;
+	mp_file_t files[2];	// Indexed by is_mtl.
+} mp_tinyobj_context_t;
 
 int mp_mesh_load(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_load_edges(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_load_finish(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
 int mp_mesh_load_obj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_load_obj_tinyobj(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_load_obj_parallel(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+
+void mp_obj_count_chunk(mp_obj_chunk_t *chunk);
+int mp_obj_parse_chunk(mp_mesh_t *mesh, mp_obj_chunk_t *chunk, mp_obj_chunk_t *totals);
+const char *mp_obj_skip_space(const char *p, const char *end);
+const char *mp_obj_parse_index(const char *p, const char *end, int64_t *value, int *present);
+const char *mp_obj_parse_float(const char *p, const char *end, float *value);
 
 void tinyobj_file_reader_callback(void *ctx, const char *filename, const int is_mtl,
 				const char *obj_filename, char **data, size_t *len);
+void tinyobj_file_release_callback(void *ctx, char *data, size_t len);
 void tinyobj_free(tinyobj_attrib_t *attrib, size_t num_shapes, tinyobj_shape_t *shapes,
 				size_t num_materials, tinyobj_material_t *materials);
 
@@ -0,0 +1,213 @@
+#include "Mesh-Manifold.h"
+
+int mp_mesh_check_manifold_report(mp_mesh_t *mesh, mp_mesh_manifold_report_t *report,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	mp_mesh_connectivity_t connectivity;
+	if (mp_mesh_build_connectivity(mesh, &connectivity, 1, error_message)) { return -1; }
+
+	int return_value = mp_mesh_check_manifold_report_from_connectivity(mesh, &connectivity,
+									report, error_message);
+	mp_mesh_connectivity_free(&connectivity);
+	return return_value;
+}
+
+int mp_mesh_check_manifold_report_from_connectivity(mp_mesh_t *mesh,
+		mp_mesh_connectivity_t *connectivity, mp_mesh_manifold_report_t *report,
+		char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	uint32_t *chunk_counts = NULL;
+	memset(report, 0, sizeof(mp_mesh_manifold_report_t));
+
+	if (!connectivity->sorted_edges)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Manifold report on mesh \"%s\" needs the sorted edge order.", mesh->name);
+		return -1;
+	}
+
+	/* Results go straight into preallocated buffers, each chunk of work writing to its own
+	 * slice. Slices are then packed together, so no thread ever waits on another: */
+	uint32_t num_edges = mesh->num_edges;
+	uint32_t num_vertices = mesh->num_vertices;
+	uint32_t num_edge_chunks = (num_edges + MP_MESH_MANIFOLD_CHUNK_SIZE - 1) /
+							MP_MESH_MANIFOLD_CHUNK_SIZE;
+	uint32_t num_vertex_chunks = (num_vertices + MP_MESH_MANIFOLD_CHUNK_SIZE - 1) /
+							MP_MESH_MANIFOLD_CHUNK_SIZE;
+
+	chunk_counts = malloc(((num_edge_chunks * 2) + num_vertex_chunks + 1) * sizeof(uint32_t));
+	report->duplicate_edges = malloc(((size_t)num_edges + 1) * sizeof(uint32_t));
+	report->non_manifold_edges = malloc(((size_t)num_edges + 1) * sizeof(uint32_t));
+	report->non_manifold_vertices = malloc(((size_t)num_vertices + 1) * sizeof(uint32_t));
+	if (!chunk_counts || !report->duplicate_edges || !report->non_manifold_edges ||
+		!report->non_manifold_vertices)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for manifold report on mesh \"%s\".", mesh->name);
+		mp_mesh_manifold_report_free(report);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/*****************************************
+	 * Duplicate and non-manifold edges test *
+	 *****************************************/
+
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, 0, &stride);
+	const uint64_t *keys = connectivity->keys;
+	const uint32_t *order = connectivity->sorted_edges;
+	uint32_t *duplicate_counts = chunk_counts;
+	uint32_t *non_manifold_counts = chunk_counts + num_edge_chunks;
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (uint32_t chunk = 0; chunk < num_edge_chunks; chunk++)
+	{
+		uint32_t start = chunk * MP_MESH_MANIFOLD_CHUNK_SIZE;
+		uint32_t end = start + MP_MESH_MANIFOLD_CHUNK_SIZE;
+		if (end > num_edges) { end = num_edges; }
+
+		uint32_t *duplicates = report->duplicate_edges + start;
+		uint32_t *non_manifold = report->non_manifold_edges + start;
+		uint32_t num_duplicates = 0;
+		uint32_t num_non_manifold = 0;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			// A repeated direction within the run of equal keys:
+			uint32_t from = mp_mesh_edge_from(indices, stride, order[i]);
+			for (uint32_t j = i; (j > 0) && (keys[j - 1] == keys[i]); j--)
+			{
+				if (mp_mesh_edge_from(indices, stride, order[j - 1]) == from)
+				{
+					duplicates[num_duplicates++] = order[i];
+					break;
+				}
+			}
+
+			// More than two faces on the edge, reported once, by the start of the run:
+			if ((i > 0) && (keys[i - 1] == keys[i])) { continue; }
+			uint32_t run_end = i + 1;
+			while ((run_end < num_edges) && (keys[run_end] == keys[i])) { run_end++; }
+			if ((run_end - i) > 2) { non_manifold[num_non_manifold++] = order[i]; }
+		}
+
+		duplicate_counts[chunk] = num_duplicates;
+		non_manifold_counts[chunk] = num_non_manifold;
+	}
+
+	/**********************
+	 * Vertex cycles test *
+	 **********************/
+
+	// Unlike the boolean check, every fan is walked:
+	const uint32_t *vertex_degrees = connectivity->vertex_degrees;
+	uint32_t *vertex_counts = chunk_counts + (num_edge_chunks * 2);
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (uint32_t chunk = 0; chunk < num_vertex_chunks; chunk++)
+	{
+		uint32_t start = chunk * MP_MESH_MANIFOLD_CHUNK_SIZE;
+		uint32_t end = start + MP_MESH_MANIFOLD_CHUNK_SIZE;
+		if (end > num_vertices) { end = num_vertices; }
+
+		uint32_t *non_manifold = report->non_manifold_vertices + start;
+		uint32_t num_non_manifold = 0;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			if ((vertex_degrees[i] == 0) ||
+				mp_mesh_triangle_fan_check(mesh, i, vertex_degrees[i]))
+			{
+				non_manifold[num_non_manifold++] = i;
+			}
+		}
+
+		vertex_counts[chunk] = num_non_manifold;
+	}
+
+	report->num_duplicate_edges = mp_mesh_manifold_report_merge(&(report->duplicate_edges),
+								duplicate_counts, num_edge_chunks);
+	report->num_non_manifold_edges = mp_mesh_manifold_report_merge(
+			&(report->non_manifold_edges), non_manifold_counts, num_edge_chunks);
+	report->num_non_manifold_vertices = mp_mesh_manifold_report_merge(
+			&(report->non_manifold_vertices), vertex_counts, num_vertex_chunks);
+
+	mesh->is_manifold = (report->num_duplicate_edges == 0) &&
+				(report->num_non_manifold_edges == 0) &&
+				(report->num_non_manifold_vertices == 0);
+
+	cleanup:
+	if (chunk_counts) { free(chunk_counts); }
+	return return_value;
+}
+
+void mp_mesh_manifold_report_free(mp_mesh_manifold_report_t *report)
+{
+	if (report->duplicate_edges) { free(report->duplicate_edges); }
+	if (report->non_manifold_edges) { free(report->non_manifold_edges); }
+	if (report->non_manifold_vertices) { free(report->non_manifold_vertices); }
+	memset(report, 0, sizeof(mp_mesh_manifold_report_t));
+}
+
+uint32_t mp_mesh_manifold_report_merge(uint32_t **results, const uint32_t *chunk_counts,
+							uint32_t num_chunks)
+{
+	/* Each chunk's slice starts at or after where its results end up, so moving them down in
+	 * chunk order never overwrites anything still to be moved: */
+	uint32_t total = 0;
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t *slice = *results + ((size_t)chunk * MP_MESH_MANIFOLD_CHUNK_SIZE);
+		if (slice != (*results + total))
+		{
+			memmove(*results + total, slice, chunk_counts[chunk] * sizeof(uint32_t));
+		}
+		total += chunk_counts[chunk];
+	}
+
+	// Give back the unused space, keeping NULL for an empty list:
+	if (total == 0)
+	{
+		free(*results);
+		*results = NULL;
+	}
+	else
+	{
+		uint32_t *shrunk = realloc(*results, total * sizeof(uint32_t));
+		if (shrunk) { *results = shrunk; }
+	}
+
+	return total;
+}
+
+#ifdef MP_DEBUG
+void mp_mesh_manifold_report_print(FILE *file, mp_mesh_t *mesh,
+					mp_mesh_manifold_report_t *report)
+{
+	fprintf(file, "Manifold report on mesh \"%s\":\n", mesh->name);
+
+	fprintf(file, "--> Duplicate edges: %u\n", report->num_duplicate_edges);
+	for (uint32_t i = 0; i < report->num_duplicate_edges; i++)
+	{
+		uint32_t edge = report->duplicate_edges[i];
+		fprintf(file, "    --> Edge %u (%u -> %u)\n", edge, mp_mesh_get_edge_from(mesh, edge),
+							mp_mesh_get_edge_to(mesh, edge));
+	}
+
+	fprintf(file, "--> Non-manifold edges: %u\n", report->num_non_manifold_edges);
+	for (uint32_t i = 0; i < report->num_non_manifold_edges; i++)
+	{
+		uint32_t edge = report->non_manifold_edges[i];
+		fprintf(file, "    --> Edge %u (%u -> %u)\n", edge, mp_mesh_get_edge_from(mesh, edge),
+							mp_mesh_get_edge_to(mesh, edge));
+	}
+
+	fprintf(file, "--> Non-manifold vertices: %u\n", report->num_non_manifold_vertices);
+	for (uint32_t i = 0; i < report->num_non_manifold_vertices; i++)
+	{
+		fprintf(file, "    --> Vertex %u\n", report->non_manifold_vertices[i]);
+	}
+}
+#endif
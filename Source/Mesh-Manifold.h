@@ -0,0 +1,38 @@
+#ifndef MP_MESH_MANIFOLD_H
+#define MP_MESH_MANIFOLD_H
+
+#include <stdio.h>
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+
+/* Every defect found by a full manifold check. Each list is in ascending order of the sorted
+ * edges or of vertex index, so reports are identical from run to run: */
+typedef struct
+{
+	uint32_t num_duplicate_edges;
+	uint32_t *duplicate_edges;		// Repeats of an earlier edge with the same direction.
+
+	uint32_t num_non_manifold_edges;
+	uint32_t *non_manifold_edges;		// One edge per undirected edge with over two faces.
+
+	uint32_t num_non_manifold_vertices;
+	uint32_t *non_manifold_vertices;	// Vertices with no triangle fan, or more than one.
+} mp_mesh_manifold_report_t;
+
+int mp_mesh_check_manifold_report(mp_mesh_t *mesh, mp_mesh_manifold_report_t *report,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_check_manifold_report_from_connectivity(mp_mesh_t *mesh,
+		mp_mesh_connectivity_t *connectivity, mp_mesh_manifold_report_t *report,
+		char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_manifold_report_free(mp_mesh_manifold_report_t *report);
+uint32_t mp_mesh_manifold_report_merge(uint32_t **results, const uint32_t *chunk_counts,
+							uint32_t num_chunks);
+
+#ifdef MP_DEBUG
+void mp_mesh_manifold_report_print(FILE *file, mp_mesh_t *mesh,
+					mp_mesh_manifold_report_t *report);
+#endif
+
+#endif
@@ -0,0 +1,419 @@
+#include "Mesh-Meshlets.h"
+
+int mp_mesh_build_meshlets(mp_mesh_t *mesh, uint8_t lod, uint32_t max_vertices,
+			uint32_t max_triangles, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (!max_vertices) { max_vertices = MP_MESHLET_MAX_VERTICES; }
+	if (!max_triangles) { max_triangles = MP_MESHLET_MAX_TRIANGLES; }
+	if ((max_vertices < 3) || (max_vertices > MP_MESHLET_VERTEX_LIMIT) || (max_triangles < 1) ||
+		(max_triangles > MP_MESHLET_TRIANGLE_LIMIT))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Meshlets of mesh \"%s\" need 3 to %d vertices and 1 to %d triangles.",
+			mesh->name, MP_MESHLET_VERTEX_LIMIT, MP_MESHLET_TRIANGLE_LIMIT);
+		return -1;
+	}
+
+	int return_value = 0;
+	mp_mesh_vertex_faces_t vertex_faces;
+	if (mp_mesh_build_vertex_faces(mesh, lod, &vertex_faces, error_message)) { return -1; }
+
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, lod, &stride);
+	mp_mesh_meshlet_builder_t builder;
+	if (mp_mesh_meshlet_builder_init(&builder, indices, stride, mesh->num_faces[lod],
+					&vertex_faces, max_triangles))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for building meshlets of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	if (mp_mesh_meshlet_builder_run(&builder, max_vertices, max_triangles))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for building meshlets of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Copied into blocks of the final size, replacing any meshlets already built:
+	mp_mesh_free_meshlets(mesh, lod);
+	mp_mesh_meshlets_t *meshlets = &(mesh->meshlets[lod]);
+	mp_mesh_meshlets_t *output = &(builder.output);
+	meshlets->meshlets = mp_mesh_allocate_block(mesh, output->num_meshlets * sizeof(mp_meshlet_t));
+	meshlets->vertices = mp_mesh_allocate_block(mesh, output->num_vertices * sizeof(uint32_t));
+	meshlets->triangles = mp_mesh_allocate_block(mesh, output->num_triangles * 3 * sizeof(uint8_t));
+	meshlets->faces = mp_mesh_allocate_block(mesh, output->num_triangles * sizeof(uint32_t));
+	if (!meshlets->meshlets || !meshlets->vertices || !meshlets->triangles || !meshlets->faces)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for meshlets of mesh \"%s\".", mesh->name);
+		mp_mesh_free_meshlets(mesh, lod);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	meshlets->num_meshlets = output->num_meshlets;
+	meshlets->num_vertices = output->num_vertices;
+	meshlets->num_triangles = output->num_triangles;
+	memcpy(meshlets->meshlets, output->meshlets, output->num_meshlets * sizeof(mp_meshlet_t));
+	memcpy(meshlets->vertices, output->vertices, output->num_vertices * sizeof(uint32_t));
+	memcpy(meshlets->triangles, output->triangles, output->num_triangles * 3 * sizeof(uint8_t));
+	memcpy(meshlets->faces, output->faces, output->num_triangles * sizeof(uint32_t));
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < meshlets->num_meshlets; i++)
+	{
+		mp_mesh_calculate_meshlet_bounds(mesh, meshlets, &(meshlets->meshlets[i]));
+	}
+
+	cleanup:
+	mp_mesh_vertex_faces_free(&vertex_faces);
+	mp_mesh_meshlet_builder_free(&builder);
+	return return_value;
+}
+
+int mp_mesh_meshlet_builder_init(mp_mesh_meshlet_builder_t *builder, const uint32_t *indices,
+		uint32_t stride, uint32_t num_faces, const mp_mesh_vertex_faces_t *vertex_faces,
+								uint32_t max_triangles)
+{
+	memset(builder, 0, sizeof(*builder));
+	builder->indices = indices;
+	builder->stride = stride;
+	builder->num_faces = num_faces;
+	builder->vertex_faces = vertex_faces;
+
+	size_t num_slots = (size_t)num_faces + 1;
+	size_t num_vertices = (size_t)vertex_faces->num_vertices + 1;
+	builder->is_used = calloc(num_slots, sizeof(uint8_t));
+	builder->is_candidate = calloc(num_slots, sizeof(uint8_t));
+	builder->candidates = malloc(num_slots * sizeof(uint32_t));
+	builder->live_faces = malloc(num_vertices * sizeof(uint32_t));
+	builder->local_vertices = malloc(num_vertices * sizeof(uint32_t));
+	builder->meshlet_capacity = (num_faces / max_triangles) + 16;
+	builder->output.meshlets = malloc(builder->meshlet_capacity * sizeof(mp_meshlet_t));
+	builder->output.vertices = malloc(num_slots * 3 * sizeof(uint32_t));
+	builder->output.triangles = malloc(num_slots * 3 * sizeof(uint8_t));
+	builder->output.faces = malloc(num_slots * sizeof(uint32_t));
+	if (!builder->is_used || !builder->is_candidate || !builder->candidates ||
+		!builder->live_faces || !builder->local_vertices || !builder->output.meshlets ||
+		!builder->output.vertices || !builder->output.triangles || !builder->output.faces)
+	{
+		mp_mesh_meshlet_builder_free(builder);
+		return -1;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < vertex_faces->num_vertices; i++)
+	{
+		builder->live_faces[i] = mp_mesh_vertex_faces_get_degree(vertex_faces, i);
+		builder->local_vertices[i] = MP_EDGE_NONE;
+	}
+	return 0;
+}
+
+void mp_mesh_meshlet_builder_free(mp_mesh_meshlet_builder_t *builder)
+{
+	if (builder->is_used) { free(builder->is_used); }
+	if (builder->is_candidate) { free(builder->is_candidate); }
+	if (builder->candidates) { free(builder->candidates); }
+	if (builder->live_faces) { free(builder->live_faces); }
+	if (builder->local_vertices) { free(builder->local_vertices); }
+	if (builder->output.meshlets) { free(builder->output.meshlets); }
+	if (builder->output.vertices) { free(builder->output.vertices); }
+	if (builder->output.triangles) { free(builder->output.triangles); }
+	if (builder->output.faces) { free(builder->output.faces); }
+	memset(builder, 0, sizeof(*builder));
+}
+
+int mp_mesh_meshlet_builder_run(mp_mesh_meshlet_builder_t *builder, uint32_t max_vertices,
+								uint32_t max_triangles)
+{
+	/* Greedy growth: each meshlet takes the neighbouring face that adds the fewest vertices,
+	 * preferring faces whose vertices have the fewest faces left, so no small islands are left
+	 * behind. When nothing fits, the meshlet is finished and the next starts next to it: */
+	mp_meshlet_t meshlet;
+	memset(&meshlet, 0, sizeof(meshlet));
+	uint32_t cursor = 0;
+	for (uint32_t num_used = 0; num_used < builder->num_faces; num_used++)
+	{
+		uint32_t face = MP_EDGE_NONE;
+		if (meshlet.num_triangles < max_triangles)
+		{
+			face = mp_mesh_meshlet_builder_pick(builder, &meshlet, max_vertices);
+		}
+
+		if ((face == MP_EDGE_NONE) && meshlet.num_triangles)
+		{
+			if (mp_mesh_meshlet_builder_finish(builder, &meshlet)) { return -1; }
+			face = mp_mesh_meshlet_builder_pick(builder, &meshlet, max_vertices);
+		}
+
+		// A new meshlet with no faces nearby starts at the first unused face:
+		if (face == MP_EDGE_NONE)
+		{
+			while (builder->is_used[cursor]) { cursor++; }
+			face = cursor;
+		}
+
+		mp_mesh_meshlet_builder_add(builder, &meshlet, face);
+	}
+
+	if (meshlet.num_triangles && mp_mesh_meshlet_builder_finish(builder, &meshlet)) { return -1; }
+	return 0;
+}
+
+uint32_t mp_mesh_meshlet_builder_pick(mp_mesh_meshlet_builder_t *builder,
+				const mp_meshlet_t *meshlet, uint32_t max_vertices)
+{
+	uint32_t best_face = MP_EDGE_NONE;
+	uint32_t best_new_vertices = UINT32_MAX;
+	uint32_t best_live_faces = UINT32_MAX;
+
+	for (uint32_t i = 0; i < builder->num_candidates;)
+	{
+		// Used faces leave the list as they're found:
+		uint32_t face = builder->candidates[i];
+		if (builder->is_used[face])
+		{
+			builder->is_candidate[face] = 0;
+			builder->candidates[i] = builder->candidates[--(builder->num_candidates)];
+			continue;
+		}
+		i++;
+
+		uint32_t new_vertices = mp_mesh_meshlet_count_new_vertices(builder, face);
+		if ((meshlet->num_vertices + new_vertices) > max_vertices) { continue; }
+
+		const uint32_t *corners = builder->indices + (face * builder->stride);
+		uint32_t live_faces = builder->live_faces[corners[0]];
+		for (int j = 1; j < 3; j++)
+		{
+			uint32_t corner_faces = builder->live_faces[corners[j]];
+			if (corner_faces < live_faces) { live_faces = corner_faces; }
+		}
+
+		if ((new_vertices < best_new_vertices) ||
+			((new_vertices == best_new_vertices) && (live_faces < best_live_faces)))
+		{
+			best_face = face;
+			best_new_vertices = new_vertices;
+			best_live_faces = live_faces;
+		}
+	}
+
+	return best_face;
+}
+
+void mp_mesh_meshlet_builder_add(mp_mesh_meshlet_builder_t *builder, mp_meshlet_t *meshlet,
+									uint32_t face)
+{
+	mp_mesh_meshlets_t *output = &(builder->output);
+	const uint32_t *corners = builder->indices + (face * builder->stride);
+	uint32_t triangle = meshlet->triangle_offset + meshlet->num_triangles;
+	builder->is_used[face] = 1;
+
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t vertex = corners[i];
+		builder->live_faces[vertex]--;
+
+		if (builder->local_vertices[vertex] == MP_EDGE_NONE)
+		{
+			builder->local_vertices[vertex] = meshlet->num_vertices;
+			output->vertices[meshlet->vertex_offset + meshlet->num_vertices] = vertex;
+			meshlet->num_vertices++;
+
+			// Faces around a new vertex become candidates:
+			uint32_t other;
+			mp_mesh_adjacency_iterator_t it = mp_mesh_vertex_faces_begin(
+							builder->vertex_faces, vertex);
+			while (mp_mesh_adjacency_iterator_next(&it, &other))
+			{
+				if (builder->is_used[other] || builder->is_candidate[other]) { continue; }
+				builder->is_candidate[other] = 1;
+				builder->candidates[builder->num_candidates++] = other;
+			}
+		}
+
+		output->triangles[(triangle * 3) + i] = (uint8_t)builder->local_vertices[vertex];
+	}
+
+	output->faces[triangle] = face;
+	meshlet->num_triangles++;
+}
+
+int mp_mesh_meshlet_builder_finish(mp_mesh_meshlet_builder_t *builder, mp_meshlet_t *meshlet)
+{
+	mp_mesh_meshlets_t *output = &(builder->output);
+	if (output->num_meshlets == builder->meshlet_capacity)
+	{
+		uint32_t capacity = builder->meshlet_capacity * 2;
+		mp_meshlet_t *meshlets = realloc(output->meshlets, capacity * sizeof(mp_meshlet_t));
+		if (!meshlets) { return -1; }
+		output->meshlets = meshlets;
+		builder->meshlet_capacity = capacity;
+	}
+	output->meshlets[output->num_meshlets++] = *meshlet;
+	output->num_vertices += meshlet->num_vertices;
+	output->num_triangles += meshlet->num_triangles;
+
+	for (uint32_t i = 0; i < meshlet->num_vertices; i++)
+	{
+		builder->local_vertices[output->vertices[meshlet->vertex_offset + i]] = MP_EDGE_NONE;
+	}
+
+	// Only the candidate with the fewest faces left is kept, to seed the next meshlet:
+	uint32_t seed = MP_EDGE_NONE;
+	uint32_t seed_live_faces = UINT32_MAX;
+	for (uint32_t i = 0; i < builder->num_candidates; i++)
+	{
+		uint32_t face = builder->candidates[i];
+		builder->is_candidate[face] = 0;
+		if (builder->is_used[face]) { continue; }
+
+		const uint32_t *corners = builder->indices + (face * builder->stride);
+		uint32_t live_faces = builder->live_faces[corners[0]] + builder->live_faces[corners[1]] +
+							builder->live_faces[corners[2]];
+		if (live_faces < seed_live_faces)
+		{
+			seed = face;
+			seed_live_faces = live_faces;
+		}
+	}
+	builder->num_candidates = 0;
+	if (seed != MP_EDGE_NONE)
+	{
+		builder->is_candidate[seed] = 1;
+		builder->candidates[builder->num_candidates++] = seed;
+	}
+
+	memset(meshlet, 0, sizeof(mp_meshlet_t));
+	meshlet->vertex_offset = output->num_vertices;
+	meshlet->triangle_offset = output->num_triangles;
+	return 0;
+}
+
+void mp_mesh_calculate_meshlet_bounds(mp_mesh_t *mesh, const mp_mesh_meshlets_t *meshlets,
+								mp_meshlet_t *meshlet)
+{
+	const uint32_t *vertices = meshlets->vertices + meshlet->vertex_offset;
+	const uint8_t *triangles = meshlets->triangles + (meshlet->triangle_offset * 3);
+
+	/*******************************************
+	 * Bounding sphere (Ritter, "An efficient *
+	 * bounding sphere", 1990)                 *
+	 *******************************************/
+
+	// Start from two far apart vertices, then grow to take in any left outside:
+	mp_position_t first = mp_mesh_get_position(mesh, vertices[0]);
+	mp_position_t a = first;
+	mp_position_t b = first;
+	float a_distance = 0.0f;
+	for (uint32_t i = 0; i < meshlet->num_vertices; i++)
+	{
+		mp_position_t p = mp_mesh_get_position(mesh, vertices[i]);
+		float x = p.x - first.x, y = p.y - first.y, z = p.z - first.z;
+		float distance = (x * x) + (y * y) + (z * z);
+		if (distance > a_distance) { a = p; a_distance = distance; }
+	}
+	float b_distance = 0.0f;
+	for (uint32_t i = 0; i < meshlet->num_vertices; i++)
+	{
+		mp_position_t p = mp_mesh_get_position(mesh, vertices[i]);
+		float x = p.x - a.x, y = p.y - a.y, z = p.z - a.z;
+		float distance = (x * x) + (y * y) + (z * z);
+		if (distance > b_distance) { b = p; b_distance = distance; }
+	}
+
+	float centre[3] = { (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f };
+	float radius = sqrtf(b_distance) * 0.5f;
+	for (uint32_t i = 0; i < meshlet->num_vertices; i++)
+	{
+		mp_position_t p = mp_mesh_get_position(mesh, vertices[i]);
+		float offset[3] = { p.x - centre[0], p.y - centre[1], p.z - centre[2] };
+		float distance = sqrtf((offset[0] * offset[0]) + (offset[1] * offset[1]) +
+							(offset[2] * offset[2]));
+		if (distance <= radius) { continue; }
+
+		float new_radius = (radius + distance) * 0.5f;
+		float shift = (new_radius - radius) / distance;
+		for (int j = 0; j < 3; j++) { centre[j] += offset[j] * shift; }
+		radius = new_radius;
+	}
+
+	memcpy(meshlet->centre, centre, sizeof(centre));
+	meshlet->radius = radius;
+
+	/***************
+	 * Normal cone *
+	 ***************/
+
+	// The axis is the mean face normal, and the cutoff comes from the widest face from it:
+	float normals[MP_MESHLET_TRIANGLE_LIMIT][3];
+	mp_position_t points[MP_MESHLET_TRIANGLE_LIMIT];
+	uint8_t is_degenerate[MP_MESHLET_TRIANGLE_LIMIT];
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t i = 0; i < meshlet->num_triangles; i++)
+	{
+		mp_position_t p[3];
+		for (int j = 0; j < 3; j++)
+		{
+			p[j] = mp_mesh_get_position(mesh, vertices[triangles[(i * 3) + j]]);
+		}
+		float u[3] = { p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z };
+		float v[3] = { p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z };
+		float n[3] = { (u[1] * v[2]) - (u[2] * v[1]), (u[2] * v[0]) - (u[0] * v[2]),
+				(u[0] * v[1]) - (u[1] * v[0]) };
+		float length = sqrtf((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+
+		is_degenerate[i] = (length == 0.0f);
+		points[i] = p[0];
+		for (int j = 0; j < 3; j++)
+		{
+			normals[i][j] = is_degenerate[i] ? 0.0f : (n[j] / length);
+			axis[j] += normals[i][j];
+		}
+	}
+
+	float axis_length = sqrtf((axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]));
+	float minimum_dot = -1.0f;
+	if (axis_length > 0.0f)
+	{
+		for (int j = 0; j < 3; j++) { axis[j] /= axis_length; }
+		minimum_dot = 1.0f;
+		for (uint32_t i = 0; i < meshlet->num_triangles; i++)
+		{
+			if (is_degenerate[i]) { continue; }
+			float dot = (axis[0] * normals[i][0]) + (axis[1] * normals[i][1]) +
+								(axis[2] * normals[i][2]);
+			if (dot < minimum_dot) { minimum_dot = dot; }
+		}
+	}
+
+	memcpy(meshlet->cone_axis, axis, sizeof(axis));
+	memcpy(meshlet->cone_apex, centre, sizeof(centre));
+	meshlet->cone_cutoff = 1.0f;
+	if (minimum_dot <= MP_MESHLET_MIN_CONE_DOT) { return; }
+
+	/* The apex moves back along the axis from the centre until it's behind every face plane,
+	 * so the cone test holds for the whole meshlet, not just its centre: */
+	float apex_distance = 0.0f;
+	for (uint32_t i = 0; i < meshlet->num_triangles; i++)
+	{
+		if (is_degenerate[i]) { continue; }
+		float to_centre[3] = { centre[0] - points[i].x, centre[1] - points[i].y,
+							centre[2] - points[i].z };
+		float centre_dot = (to_centre[0] * normals[i][0]) + (to_centre[1] * normals[i][1]) +
+							(to_centre[2] * normals[i][2]);
+		float axis_dot = (axis[0] * normals[i][0]) + (axis[1] * normals[i][1]) +
+							(axis[2] * normals[i][2]);
+		float distance = centre_dot / axis_dot;
+		if (distance > apex_distance) { apex_distance = distance; }
+	}
+
+	for (int j = 0; j < 3; j++) { meshlet->cone_apex[j] = centre[j] - (axis[j] * apex_distance); }
+	meshlet->cone_cutoff = sqrtf(1.0f - (minimum_dot * minimum_dot));
+}
@@ -0,0 +1,72 @@
+#ifndef MP_MESH_MESHLETS_H
+#define MP_MESH_MESHLETS_H
+
+#include <NM-Config/Config.h>
+
+#include <math.h>
+
+#include "Mesh.h"
+#include "Mesh-Adjacency.h"
+
+// Common mesh shader limits, used when a builder is passed 0, and the most 8-bit indices allow:
+#define MP_MESHLET_MAX_VERTICES		64
+#define MP_MESHLET_MAX_TRIANGLES	124
+#define MP_MESHLET_VERTEX_LIMIT		256
+#define MP_MESHLET_TRIANGLE_LIMIT	256
+
+// Normal cones wider than this (minimum face normal dot with the axis) are never culled:
+#define MP_MESHLET_MIN_CONE_DOT		0.1f
+
+/* Growing meshlets over a list of faces, such as one level. Candidates are unused faces next to the
+ * meshlet's vertices, each in the list at most once: */
+typedef struct
+{
+	const uint32_t *indices;
+	uint32_t stride;
+	uint32_t num_faces;
+	const mp_mesh_vertex_faces_t *vertex_faces;
+
+	uint8_t *is_used;
+	uint8_t *is_candidate;
+	uint32_t *candidates;
+	uint32_t num_candidates;
+	uint32_t *live_faces;		// Unused faces around each vertex.
+	uint32_t *local_vertices;	// Index in the current meshlet, or MP_EDGE_NONE.
+
+	mp_mesh_meshlets_t output;
+	uint32_t meshlet_capacity;
+} mp_mesh_meshlet_builder_t;
+
+int mp_mesh_build_meshlets(mp_mesh_t *mesh, uint8_t lod, uint32_t max_vertices,
+			uint32_t max_triangles, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_meshlet_builder_init(mp_mesh_meshlet_builder_t *builder, const uint32_t *indices,
+		uint32_t stride, uint32_t num_faces, const mp_mesh_vertex_faces_t *vertex_faces,
+								uint32_t max_triangles);
+void mp_mesh_meshlet_builder_free(mp_mesh_meshlet_builder_t *builder);
+int mp_mesh_meshlet_builder_run(mp_mesh_meshlet_builder_t *builder, uint32_t max_vertices,
+								uint32_t max_triangles);
+uint32_t mp_mesh_meshlet_builder_pick(mp_mesh_meshlet_builder_t *builder,
+				const mp_meshlet_t *meshlet, uint32_t max_vertices);
+void mp_mesh_meshlet_builder_add(mp_mesh_meshlet_builder_t *builder, mp_meshlet_t *meshlet,
+									uint32_t face);
+int mp_mesh_meshlet_builder_finish(mp_mesh_meshlet_builder_t *builder, mp_meshlet_t *meshlet);
+void mp_mesh_calculate_meshlet_bounds(mp_mesh_t *mesh, const mp_mesh_meshlets_t *meshlets,
+								mp_meshlet_t *meshlet);
+
+// Corners of a face not yet in the meshlet, counting repeated corners once:
+static inline uint32_t mp_mesh_meshlet_count_new_vertices(const mp_mesh_meshlet_builder_t *builder,
+										uint32_t face)
+{
+	const uint32_t *corners = builder->indices + (face * builder->stride);
+	uint32_t count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		if (builder->local_vertices[corners[i]] != MP_EDGE_NONE) { continue; }
+		if ((i > 0) && (corners[i] == corners[0])) { continue; }
+		if ((i > 1) && (corners[i] == corners[1])) { continue; }
+		count++;
+	}
+	return count;
+}
+
+#endif
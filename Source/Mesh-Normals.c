@@ -0,0 +1,327 @@
+#include "Mesh-Normals.h"
+
+int mp_mesh_generate_normals(mp_mesh_t *mesh, uint8_t weighting,
+				char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	float *face_normals = NULL;
+	mp_normal_t *normals = NULL;
+	mp_mesh_vertex_faces_t vertex_faces;
+	memset(&vertex_faces, 0, sizeof(vertex_faces));
+
+	if (weighting > MP_MESH_NORMALS_ANGLE)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Unknown normal weighting %u for mesh \"%s\".", weighting, mesh->name);
+		return -1;
+	}
+
+	uint32_t num_faces = mesh->num_faces[0];
+	face_normals = malloc((size_t)num_faces * 3 * sizeof(float));
+	normals = mp_mesh_allocate_block(mesh, (size_t)mesh->num_vertices * sizeof(mp_normal_t));
+	if (!face_normals || !normals)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for normals on mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Each vertex reads the faces around it, so no two threads write the same normal:
+	if (mp_mesh_build_vertex_faces(mesh, 0, &vertex_faces, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	float *x = face_normals;
+	float *y = face_normals + num_faces;
+	float *z = face_normals + ((size_t)num_faces * 2);
+	mp_mesh_calculate_face_normals(mesh, 0, x, y, z);
+	mp_mesh_gather_vertex_normals(mesh, 0, x, y, z, &vertex_faces, weighting, normals);
+
+	// One normal per position, so every level's normal indices are its position indices:
+	mp_mesh_free_block(mesh, mesh->normals);
+	mesh->normals = normals;
+	mesh->num_normals = mesh->num_vertices;
+	mesh->has_normals = 1;
+	normals = NULL;
+
+	for (int lod = 0; lod < NM_MAX_LOD_LEVELS; lod++)
+	{
+		if (mp_mesh_is_soa(mesh))
+		{
+			if (!mesh->soa.n[lod] || ((lod > 0) && (mesh->soa.n[lod] == mesh->soa.n[0])))
+			{
+				continue;
+			}
+			memcpy(mesh->soa.n[lod], mesh->soa.p[lod],
+				(size_t)mesh->num_faces[lod] * 3 * sizeof(uint32_t));
+			continue;
+		}
+
+		if ((lod > 0) && (mesh->faces[lod] == mesh->faces[0])) { continue; }
+		mp_face_t *faces = mesh->faces[lod];
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_faces[lod]; i++)
+		{
+			memcpy(faces[i].n, faces[i].p, sizeof(faces[i].n));
+		}
+	}
+
+	cleanup:
+	if (face_normals) { free(face_normals); }
+	if (normals) { mp_mesh_free_block(mesh, normals); }
+	mp_mesh_vertex_faces_free(&vertex_faces);
+	return return_value;
+}
+
+void mp_mesh_calculate_face_normals(mp_mesh_t *mesh, uint8_t lod, float *x, float *y, float *z)
+{
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, lod, &stride);
+	uint32_t num_faces = mesh->num_faces[lod];
+
+	// Positions as three strided component arrays, for either layout:
+	uint32_t position_stride = mp_mesh_is_soa(mesh) ? 1 : 3;
+	const float *px = mp_mesh_is_soa(mesh) ? mesh->soa.x : &(mesh->vertices[0].x);
+	const float *py = mp_mesh_is_soa(mesh) ? mesh->soa.y : &(mesh->vertices[0].y);
+	const float *pz = mp_mesh_is_soa(mesh) ? mesh->soa.z : &(mesh->vertices[0].z);
+
+	uint32_t num_blocks = 0;
+
+	#ifdef __SSE2__
+	// One face per lane, so the cross products need no shuffles:
+	num_blocks = num_faces / 4;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_blocks; i++)
+	{
+		__m128 position[3][3];
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t v[4];
+			for (int k = 0; k < 4; k++)
+			{
+				v[k] = indices[((((size_t)i * 4) + k) * stride) + j] * position_stride;
+			}
+			position[j][0] = _mm_set_ps(px[v[3]], px[v[2]], px[v[1]], px[v[0]]);
+			position[j][1] = _mm_set_ps(py[v[3]], py[v[2]], py[v[1]], py[v[0]]);
+			position[j][2] = _mm_set_ps(pz[v[3]], pz[v[2]], pz[v[1]], pz[v[0]]);
+		}
+
+		__m128 b[3];
+		__m128 c[3];
+		for (int j = 0; j < 3; j++)
+		{
+			b[j] = _mm_sub_ps(position[1][j], position[0][j]);
+			c[j] = _mm_sub_ps(position[2][j], position[0][j]);
+		}
+
+		_mm_storeu_ps(x + ((size_t)i * 4), _mm_sub_ps(_mm_mul_ps(b[1], c[2]),
+								_mm_mul_ps(b[2], c[1])));
+		_mm_storeu_ps(y + ((size_t)i * 4), _mm_sub_ps(_mm_mul_ps(b[2], c[0]),
+								_mm_mul_ps(b[0], c[2])));
+		_mm_storeu_ps(z + ((size_t)i * 4), _mm_sub_ps(_mm_mul_ps(b[0], c[1]),
+								_mm_mul_ps(b[1], c[0])));
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (uint32_t i = num_blocks * 4; i < num_faces; i++)
+	{
+		float normal[3];
+		mp_mesh_face_cross(px, py, pz, position_stride, indices + ((size_t)i * stride), normal);
+		x[i] = normal[0];
+		y[i] = normal[1];
+		z[i] = normal[2];
+	}
+}
+
+void mp_mesh_gather_vertex_normals(mp_mesh_t *mesh, uint8_t lod, const float *x, const float *y,
+		const float *z, const mp_mesh_vertex_faces_t *vertex_faces, uint8_t weighting,
+								mp_normal_t *normals)
+{
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, lod, &stride);
+
+	#pragma omp parallel for schedule(dynamic, MP_MESH_MANIFOLD_CHUNK_SIZE)
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		mp_mesh_adjacency_iterator_t iterator = mp_mesh_vertex_faces_begin(vertex_faces, i);
+		uint32_t face;
+		while (mp_mesh_adjacency_iterator_next(&iterator, &face))
+		{
+			float normal[3] = { x[face], y[face], z[face] };
+			float length = sqrtf((normal[0] * normal[0]) + (normal[1] * normal[1]) +
+								(normal[2] * normal[2]));
+			if (!(length > 0.0f)) { continue; }
+
+			// The cross product is already weighted by area:
+			float weight = 1.0f;
+			if (weighting == MP_MESH_NORMALS_ANGLE)
+			{
+				const uint32_t *corners = indices + ((size_t)face * stride);
+				int corner = (corners[0] == i) ? 0 : ((corners[1] == i) ? 1 : 2);
+				mp_position_t from = mp_mesh_get_position(mesh, i);
+				mp_position_t next = mp_mesh_get_position(mesh, corners[(corner + 1) % 3]);
+				mp_position_t previous = mp_mesh_get_position(mesh, corners[(corner + 2) % 3]);
+				float dot = ((next.x - from.x) * (previous.x - from.x)) +
+					((next.y - from.y) * (previous.y - from.y)) +
+					((next.z - from.z) * (previous.z - from.z));
+
+				// The cross product is as long from every corner, so this is the corner's angle:
+				weight = atan2f(length, dot) / length;
+			}
+
+			for (int j = 0; j < 3; j++) { sum[j] += normal[j] * weight; }
+		}
+
+		normals[i] = mp_mesh_encode_normal((float)sum[0], (float)sum[1], (float)sum[2]);
+	}
+}
+
+void mp_mesh_encode_normals(const float *normals, uint32_t count, mp_normal_t *encoded)
+{
+	uint32_t num_blocks = 0;
+
+	#ifdef __SSE2__
+	// Four normals at a time, as the scalar encoding with the fold done by masks:
+	num_blocks = count / 4;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_blocks; i++)
+	{
+		const float *n = normals + ((size_t)i * 12);
+		__m128 x = _mm_set_ps(n[9], n[6], n[3], n[0]);
+		__m128 y = _mm_set_ps(n[10], n[7], n[4], n[1]);
+		__m128 z = _mm_set_ps(n[11], n[8], n[5], n[2]);
+
+		__m128 sign_mask = _mm_set1_ps(-0.0f);
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 length = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x),
+			_mm_andnot_ps(sign_mask, y)), _mm_andnot_ps(sign_mask, z));
+		__m128 is_valid = _mm_cmpgt_ps(length, _mm_setzero_ps());
+		__m128 u = _mm_and_ps(is_valid, _mm_div_ps(x, length));
+		__m128 v = _mm_and_ps(is_valid, _mm_div_ps(y, length));
+
+		__m128 folded_u = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, v)),
+							mp_mesh_normals_sign_ps(u));
+		__m128 folded_v = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, u)),
+							mp_mesh_normals_sign_ps(v));
+		__m128 is_folded = _mm_and_ps(is_valid, _mm_cmplt_ps(z, _mm_setzero_ps()));
+		u = _mm_or_ps(_mm_and_ps(is_folded, folded_u), _mm_andnot_ps(is_folded, u));
+		v = _mm_or_ps(_mm_and_ps(is_folded, folded_v), _mm_andnot_ps(is_folded, v));
+
+		__m128 scale = _mm_set1_ps(MP_NORMAL_COMPONENT_MAX);
+		__m128i encoded_u = mp_mesh_normals_round_ps(_mm_mul_ps(u, scale));
+		__m128i encoded_v = mp_mesh_normals_round_ps(_mm_mul_ps(v, scale));
+
+		// Interleave to (u, v) pairs, then narrow to the component size:
+		__m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(encoded_u, encoded_v),
+						_mm_unpackhi_epi32(encoded_u, encoded_v));
+		#ifdef MP_NORMAL_OCT8
+		_mm_storel_epi64((__m128i *)(encoded + ((size_t)i * 4)), _mm_packs_epi16(packed, packed));
+		#else
+		_mm_storeu_si128((__m128i *)(encoded + ((size_t)i * 4)), packed);
+		#endif
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (uint32_t i = num_blocks * 4; i < count; i++)
+	{
+		const float *n = normals + ((size_t)i * 3);
+		encoded[i] = mp_mesh_encode_normal(n[0], n[1], n[2]);
+	}
+}
+
+void mp_mesh_decode_normals(const mp_normal_t *encoded, uint32_t count, float *normals)
+{
+	uint32_t num_blocks = 0;
+
+	#ifdef __SSE2__
+	num_blocks = count / 4;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_blocks; i++)
+	{
+		// Widen to one (u, v) pair of 16-bit components per 32-bit lane:
+		#ifdef MP_NORMAL_OCT8
+		__m128i bytes = _mm_loadl_epi64((const __m128i *)(encoded + ((size_t)i * 4)));
+		__m128i packed = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+		#else
+		__m128i packed = _mm_loadu_si128((const __m128i *)(encoded + ((size_t)i * 4)));
+		#endif
+
+		__m128 scale = _mm_set1_ps(MP_NORMAL_COMPONENT_MAX);
+		__m128 minimum = _mm_set1_ps(-1.0f);
+		__m128 sign_mask = _mm_set1_ps(-0.0f);
+		__m128 u = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(
+				_mm_slli_epi32(packed, 16), 16)), scale), minimum);
+		__m128 v = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(packed, 16)), scale),
+										minimum);
+		__m128 w = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_andnot_ps(sign_mask, u)),
+							_mm_andnot_ps(sign_mask, v));
+
+		__m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), w), _mm_setzero_ps());
+		u = _mm_sub_ps(u, _mm_mul_ps(t, mp_mesh_normals_sign_ps(u)));
+		v = _mm_sub_ps(v, _mm_mul_ps(t, mp_mesh_normals_sign_ps(v)));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(u, u), _mm_mul_ps(v, v)),
+								_mm_mul_ps(w, w)));
+		float components[3][4];
+		_mm_storeu_ps(components[0], _mm_div_ps(u, length));
+		_mm_storeu_ps(components[1], _mm_div_ps(v, length));
+		_mm_storeu_ps(components[2], _mm_div_ps(w, length));
+
+		float *n = normals + ((size_t)i * 12);
+		for (int j = 0; j < 4; j++)
+		{
+			n[(j * 3)] = components[0][j];
+			n[(j * 3) + 1] = components[1][j];
+			n[(j * 3) + 2] = components[2][j];
+		}
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (uint32_t i = num_blocks * 4; i < count; i++)
+	{
+		mp_mesh_decode_normal(encoded[i], normals + ((size_t)i * 3));
+	}
+}
+
+void mp_mesh_measure_normal_error(const float *normals, uint32_t count, double *maximum,
+									double *mean)
+{
+	double maximum_error = 0.0;
+	double total_error = 0.0;
+	uint32_t num_measured = 0;
+
+	// Angle between each normal and its decoded encoding, in degrees:
+	#pragma omp parallel for reduction(max:maximum_error) reduction(+:total_error, num_measured)
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const float *n = normals + ((size_t)i * 3);
+		if (!n[0] && !n[1] && !n[2]) { continue; }
+
+		// From the cross product as well as the dot, as acos() is too coarse near zero:
+		float decoded[3];
+		mp_mesh_decode_normal(mp_mesh_encode_normal(n[0], n[1], n[2]), decoded);
+		double cross[3] = {
+			((double)n[1] * decoded[2]) - ((double)n[2] * decoded[1]),
+			((double)n[2] * decoded[0]) - ((double)n[0] * decoded[2]),
+			((double)n[0] * decoded[1]) - ((double)n[1] * decoded[0])
+		};
+		double dot = ((double)n[0] * decoded[0]) + ((double)n[1] * decoded[1]) +
+							((double)n[2] * decoded[2]);
+		double error = atan2(sqrt((cross[0] * cross[0]) + (cross[1] * cross[1]) +
+				(cross[2] * cross[2])), dot) * MP_NORMAL_DEGREES_PER_RADIAN;
+
+		if (error > maximum_error) { maximum_error = error; }
+		total_error += error;
+		num_measured++;
+	}
+
+	*maximum = maximum_error;
+	*mean = num_measured ? (total_error / num_measured) : 0.0;
+}
@@ -0,0 +1,110 @@
+#ifndef MP_MESH_NORMALS_H
+#define MP_MESH_NORMALS_H
+
+#include <NM-Config/Config.h>
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Mesh.h"
+#include "Mesh-Adjacency.h"
+
+#define MP_NORMAL_DEGREES_PER_RADIAN	57.29577951308232
+
+// How the faces around a vertex are weighted in its normal, set in mesh normal_weighting:
+enum
+{
+	MP_MESH_NORMALS_AREA,
+	MP_MESH_NORMALS_ANGLE
+};
+
+int mp_mesh_generate_normals(mp_mesh_t *mesh, uint8_t weighting,
+				char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_calculate_face_normals(mp_mesh_t *mesh, uint8_t lod, float *x, float *y, float *z);
+void mp_mesh_gather_vertex_normals(mp_mesh_t *mesh, uint8_t lod, const float *x, const float *y,
+		const float *z, const mp_mesh_vertex_faces_t *vertex_faces, uint8_t weighting,
+								mp_normal_t *normals);
+
+void mp_mesh_encode_normals(const float *normals, uint32_t count, mp_normal_t *encoded);
+void mp_mesh_decode_normals(const mp_normal_t *encoded, uint32_t count, float *normals);
+void mp_mesh_measure_normal_error(const float *normals, uint32_t count, double *maximum,
+									double *mean);
+
+/* Any vector to octahedral components, rounded to nearest. The lower half of the sphere folds
+ * over the diagonals, and zero vectors encode as +z: */
+static inline mp_normal_t mp_mesh_encode_normal(float x, float y, float z)
+{
+	mp_normal_t normal = { 0, 0 };
+	float length = fabsf(x) + fabsf(y) + fabsf(z);
+	if (!(length > 0.0f)) { return normal; }
+
+	float u = x / length;
+	float v = y / length;
+	if (z < 0.0f)
+	{
+		float folded_u = (1.0f - fabsf(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+		v = (1.0f - fabsf(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
+		u = folded_u;
+	}
+	normal.x = (mp_normal_component_t)roundf(u * MP_NORMAL_COMPONENT_MAX);
+	normal.y = (mp_normal_component_t)roundf(v * MP_NORMAL_COMPONENT_MAX);
+	return normal;
+}
+
+// Octahedral components to a unit vector:
+static inline void mp_mesh_decode_normal(mp_normal_t normal, float result[3])
+{
+	float u = fmaxf((float)normal.x / MP_NORMAL_COMPONENT_MAX, -1.0f);
+	float v = fmaxf((float)normal.y / MP_NORMAL_COMPONENT_MAX, -1.0f);
+	float w = 1.0f - fabsf(u) - fabsf(v);
+
+	// Unfolding the lower half moves each component towards zero by the depth below the equator:
+	float t = fmaxf(-w, 0.0f);
+	u += (u >= 0.0f) ? -t : t;
+	v += (v >= 0.0f) ? -t : t;
+
+	float length = sqrtf((u * u) + (v * v) + (w * w));
+	result[0] = u / length;
+	result[1] = v / length;
+	result[2] = w / length;
+}
+
+#ifdef __SSE2__
+// 1 per lane, or -1 where the lane is negative, as the scalar code picks signs:
+static inline __m128 mp_mesh_normals_sign_ps(__m128 value)
+{
+	return _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(value, _mm_setzero_ps()), _mm_set1_ps(-0.0f)),
+								_mm_set1_ps(1.0f));
+}
+
+// Round half away from zero, as roundf(), so both paths give the same encoding:
+static inline __m128i mp_mesh_normals_round_ps(__m128 value)
+{
+	__m128i truncated = _mm_cvttps_epi32(value);
+	__m128 remainder = _mm_sub_ps(value, _mm_cvtepi32_ps(truncated));
+	__m128 is_half = _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), remainder),
+								_mm_set1_ps(0.5f));
+	__m128 step = _mm_and_ps(is_half, mp_mesh_normals_sign_ps(value));
+	return _mm_add_epi32(truncated, _mm_cvtps_epi32(step));
+}
+#endif
+
+/* Cross product of a face's edges from corner 0, so its length is twice the face's area. Positions
+ * are "stride" floats apart from each component's first: */
+static inline void mp_mesh_face_cross(const float *x, const float *y, const float *z,
+		uint32_t stride, const uint32_t corners[3], float normal[3])
+{
+	float a[3] = { x[corners[0] * stride], y[corners[0] * stride], z[corners[0] * stride] };
+	float b[3] = { x[corners[1] * stride] - a[0], y[corners[1] * stride] - a[1],
+						z[corners[1] * stride] - a[2] };
+	float c[3] = { x[corners[2] * stride] - a[0], y[corners[2] * stride] - a[1],
+						z[corners[2] * stride] - a[2] };
+	normal[0] = (b[1] * c[2]) - (b[2] * c[1]);
+	normal[1] = (b[2] * c[0]) - (b[0] * c[2]);
+	normal[2] = (b[0] * c[1]) - (b[1] * c[0]);
+}
+
+#endif
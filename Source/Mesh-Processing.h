@@ -3,5 +3,18 @@
 
 #include "Mesh.h"
 #include "Mesh-Loader.h"
+#include "Mesh-Cache.h"
+#include "Mesh-Manifold.h"
+#include "Mesh-Adjacency.h"
+#include "Mesh-Reorder.h"
+#include "Mesh-Vertex-Cache.h"
+#include "Mesh-Buffers.h"
+#include "Mesh-Weld.h"
+#include "Mesh-Normals.h"
+#include "Mesh-Quantise.h"
+#include "Mesh-Simplify.h"
+#include "Mesh-Meshlets.h"
+#include "Mesh-Cluster-DAG.h"
+#include "Mesh-Codec.h"
 
 #endif
@@ -0,0 +1,305 @@
+#include "Mesh-Quantise.h"
+
+int mp_mesh_quantise(mp_mesh_t *mesh, uint8_t uv_format, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (uv_format > MP_UV_FORMAT_HALF)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Unknown UV format %u for mesh \"%s\".", uv_format, mesh->name);
+		return -1;
+	}
+
+	mp_mesh_free_quantised(mesh);
+	mp_mesh_quantised_t *quantised = &(mesh->quantised);
+	quantised->uv_format = uv_format;
+	quantised->positions = mp_mesh_allocate_block(mesh,
+				(size_t)mesh->num_vertices * 3 * sizeof(uint16_t));
+	quantised->uv_coordinates = mp_mesh_allocate_block(mesh,
+				(size_t)mesh->num_uv_coordinates * 2 * sizeof(uint16_t));
+	if (!quantised->positions || !quantised->uv_coordinates)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for quantising mesh \"%s\".", mesh->name);
+		mp_mesh_free_quantised(mesh);
+		return -1;
+	}
+
+	// Positions across the mesh bounds:
+	mp_position_t minimum;
+	mp_position_t maximum;
+	mp_mesh_calculate_bounds(mesh, &minimum, &maximum);
+	float position_minimum[3] = { minimum.x, minimum.y, minimum.z };
+	float position_maximum[3] = { maximum.x, maximum.y, maximum.z };
+	float position_inverse_scale[3];
+	for (int i = 0; i < 3; i++)
+	{
+		quantised->position_minimum[i] = position_minimum[i];
+		mp_mesh_quantise_get_scale(position_minimum[i], position_maximum[i],
+			&(quantised->position_scale[i]), &(position_inverse_scale[i]));
+	}
+
+	if (mp_mesh_is_soa(mesh))
+	{
+		const float *axes[3] = { mesh->soa.x, mesh->soa.y, mesh->soa.z };
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_vertices; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				quantised->positions[((size_t)i * 3) + j] = mp_mesh_quantise_unorm16_value(
+					axes[j][i], position_minimum[j], position_inverse_scale[j]);
+			}
+		}
+	}
+	else
+	{
+		mp_mesh_quantise_unorm16(&(mesh->vertices[0].x), mesh->num_vertices, 3,
+				position_minimum, position_inverse_scale, quantised->positions);
+	}
+
+	// UVs wrap past [0, 1] when tiled, so unorm16 also uses their own bounds:
+	const float *uvs = &(mesh->uv_coordinates[0].u);
+	if (uv_format == MP_UV_FORMAT_UNORM16)
+	{
+		float min_u = INFINITY, min_v = INFINITY;
+		float max_u = -INFINITY, max_v = -INFINITY;
+		#pragma omp parallel for reduction(min:min_u, min_v) reduction(max:max_u, max_v)
+		for (uint32_t i = 0; i < mesh->num_uv_coordinates; i++)
+		{
+			mp_uv_t uv = mesh->uv_coordinates[i];
+			if (uv.u < min_u) { min_u = uv.u; }
+			if (uv.u > max_u) { max_u = uv.u; }
+			if (uv.v < min_v) { min_v = uv.v; }
+			if (uv.v > max_v) { max_v = uv.v; }
+		}
+
+		float uv_inverse_scale[2];
+		quantised->uv_minimum[0] = min_u;
+		quantised->uv_minimum[1] = min_v;
+		mp_mesh_quantise_get_scale(min_u, max_u, &(quantised->uv_scale[0]),
+								&(uv_inverse_scale[0]));
+		mp_mesh_quantise_get_scale(min_v, max_v, &(quantised->uv_scale[1]),
+								&(uv_inverse_scale[1]));
+		mp_mesh_quantise_unorm16(uvs, mesh->num_uv_coordinates, 2, quantised->uv_minimum,
+						uv_inverse_scale, quantised->uv_coordinates);
+	}
+	else
+	{
+		mp_mesh_quantise_half(uvs, (size_t)mesh->num_uv_coordinates * 2,
+							quantised->uv_coordinates);
+	}
+
+	// Error report, from the same conversions a reader would use:
+	float position_error = 0.0f;
+	#pragma omp parallel for reduction(max:position_error)
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		mp_position_t position = mp_mesh_get_position(mesh, i);
+		float components[3] = { position.x, position.y, position.z };
+		float distance = 0.0f;
+		for (int j = 0; j < 3; j++)
+		{
+			float difference = components[j] - mp_mesh_dequantise_unorm16_value(
+						quantised->positions[((size_t)i * 3) + j],
+						quantised->position_minimum[j], quantised->position_scale[j]);
+			distance += difference * difference;
+		}
+		distance = sqrtf(distance);
+		if (distance > position_error) { position_error = distance; }
+	}
+
+	float uv_error = 0.0f;
+	#pragma omp parallel for reduction(max:uv_error)
+	for (size_t i = 0; i < (size_t)mesh->num_uv_coordinates * 2; i++)
+	{
+		float value;
+		if (uv_format == MP_UV_FORMAT_UNORM16)
+		{
+			value = mp_mesh_dequantise_unorm16_value(quantised->uv_coordinates[i],
+					quantised->uv_minimum[i % 2], quantised->uv_scale[i % 2]);
+		}
+		else
+		{
+			value = mp_mesh_half_to_float(quantised->uv_coordinates[i]);
+		}
+		float difference = fabsf(uvs[i] - value);
+		if (difference > uv_error) { uv_error = difference; }
+	}
+
+	quantised->position_error = position_error;
+	quantised->uv_error = uv_error;
+	return 0;
+}
+
+void mp_mesh_dequantise(mp_mesh_t *mesh, float *positions, float *uv_coordinates)
+{
+	const mp_mesh_quantised_t *quantised = &(mesh->quantised);
+	if (positions)
+	{
+		mp_mesh_dequantise_unorm16(quantised->positions, mesh->num_vertices, 3,
+			quantised->position_minimum, quantised->position_scale, positions);
+	}
+
+	if (!uv_coordinates) { return; }
+	if (quantised->uv_format == MP_UV_FORMAT_UNORM16)
+	{
+		mp_mesh_dequantise_unorm16(quantised->uv_coordinates, mesh->num_uv_coordinates, 2,
+			quantised->uv_minimum, quantised->uv_scale, uv_coordinates);
+	}
+	else
+	{
+		mp_mesh_dequantise_half(quantised->uv_coordinates,
+				(size_t)mesh->num_uv_coordinates * 2, uv_coordinates);
+	}
+}
+
+void mp_mesh_quantise_unorm16(const float *values, uint32_t count, uint32_t num_components,
+		const float *minimum, const float *inverse_scale, uint16_t *quantised)
+{
+	size_t num_values = (size_t)count * num_components;
+	size_t num_blocks = 0;
+
+	#ifdef __SSE2__
+	/* Twelve values at a time, which is whole elements of up to four components, so the three
+	 * vectors of per-component offsets and scales repeat every block: */
+	num_blocks = num_values / 12;
+	__m128 minimums[3];
+	__m128 scales[3];
+	for (int i = 0; i < 3; i++)
+	{
+		float lane_minimums[4];
+		float lane_scales[4];
+		for (int j = 0; j < 4; j++)
+		{
+			uint32_t component = ((i * 4) + j) % num_components;
+			lane_minimums[j] = minimum[component];
+			lane_scales[j] = inverse_scale[component];
+		}
+		minimums[i] = _mm_loadu_ps(lane_minimums);
+		scales[i] = _mm_loadu_ps(lane_scales);
+	}
+
+	#pragma omp parallel for
+	for (size_t i = 0; i < num_blocks; i++)
+	{
+		// Signed saturation only, so pack around the middle of the range and flip the top bit:
+		__m128i lanes[3];
+		for (int j = 0; j < 3; j++)
+		{
+			__m128 value = _mm_loadu_ps(values + (i * 12) + (j * 4));
+			value = _mm_mul_ps(_mm_sub_ps(value, minimums[j]), scales[j]);
+			value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()),
+							_mm_set1_ps(MP_UNORM16_MAX));
+			lanes[j] = _mm_sub_epi32(_mm_cvtps_epi32(value), _mm_set1_epi32(32768));
+		}
+
+		__m128i bias = _mm_set1_epi16((int16_t)0x8000);
+		_mm_storeu_si128((__m128i *)(quantised + (i * 12)),
+				_mm_xor_si128(_mm_packs_epi32(lanes[0], lanes[1]), bias));
+		_mm_storel_epi64((__m128i *)(quantised + (i * 12) + 8),
+				_mm_xor_si128(_mm_packs_epi32(lanes[2], lanes[2]), bias));
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (size_t i = num_blocks * 12; i < num_values; i++)
+	{
+		uint32_t component = i % num_components;
+		quantised[i] = mp_mesh_quantise_unorm16_value(values[i], minimum[component],
+								inverse_scale[component]);
+	}
+}
+
+void mp_mesh_dequantise_unorm16(const uint16_t *quantised, uint32_t count, uint32_t num_components,
+			const float *minimum, const float *scale, float *values)
+{
+	size_t num_values = (size_t)count * num_components;
+	size_t num_blocks = 0;
+
+	#ifdef __SSE2__
+	num_blocks = num_values / 12;
+	__m128 minimums[3];
+	__m128 scales[3];
+	for (int i = 0; i < 3; i++)
+	{
+		float lane_minimums[4];
+		float lane_scales[4];
+		for (int j = 0; j < 4; j++)
+		{
+			uint32_t component = ((i * 4) + j) % num_components;
+			lane_minimums[j] = minimum[component];
+			lane_scales[j] = scale[component];
+		}
+		minimums[i] = _mm_loadu_ps(lane_minimums);
+		scales[i] = _mm_loadu_ps(lane_scales);
+	}
+
+	#pragma omp parallel for
+	for (size_t i = 0; i < num_blocks; i++)
+	{
+		__m128i low = _mm_loadu_si128((const __m128i *)(quantised + (i * 12)));
+		__m128i high = _mm_loadl_epi64((const __m128i *)(quantised + (i * 12) + 8));
+		__m128i lanes[3] = {
+			_mm_unpacklo_epi16(low, _mm_setzero_si128()),
+			_mm_unpackhi_epi16(low, _mm_setzero_si128()),
+			_mm_unpacklo_epi16(high, _mm_setzero_si128())
+		};
+		for (int j = 0; j < 3; j++)
+		{
+			__m128 value = _mm_add_ps(minimums[j],
+					_mm_mul_ps(_mm_cvtepi32_ps(lanes[j]), scales[j]));
+			_mm_storeu_ps(values + (i * 12) + (j * 4), value);
+		}
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (size_t i = num_blocks * 12; i < num_values; i++)
+	{
+		uint32_t component = i % num_components;
+		values[i] = mp_mesh_dequantise_unorm16_value(quantised[i], minimum[component],
+									scale[component]);
+	}
+}
+
+void mp_mesh_quantise_half(const float *values, size_t count, uint16_t *quantised)
+{
+	size_t num_blocks = 0;
+
+	#ifdef __F16C__
+	num_blocks = count / 4;
+	#pragma omp parallel for
+	for (size_t i = 0; i < num_blocks; i++)
+	{
+		_mm_storel_epi64((__m128i *)(quantised + (i * 4)),
+			_mm_cvtps_ph(_mm_loadu_ps(values + (i * 4)), _MM_FROUND_TO_NEAREST_INT));
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (size_t i = num_blocks * 4; i < count; i++)
+	{
+		quantised[i] = mp_mesh_float_to_half(values[i]);
+	}
+}
+
+void mp_mesh_dequantise_half(const uint16_t *quantised, size_t count, float *values)
+{
+	size_t num_blocks = 0;
+
+	#ifdef __F16C__
+	num_blocks = count / 4;
+	#pragma omp parallel for
+	for (size_t i = 0; i < num_blocks; i++)
+	{
+		_mm_storeu_ps(values + (i * 4),
+			_mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)(quantised + (i * 4)))));
+	}
+	#endif
+
+	#pragma omp parallel for
+	for (size_t i = num_blocks * 4; i < count; i++)
+	{
+		values[i] = mp_mesh_half_to_float(quantised[i]);
+	}
+}
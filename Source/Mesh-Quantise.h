@@ -0,0 +1,101 @@
+#ifndef MP_MESH_QUANTISE_H
+#define MP_MESH_QUANTISE_H
+
+#include <NM-Config/Config.h>
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+#include "Mesh.h"
+
+#define MP_UNORM16_MAX	65535.0f
+
+int mp_mesh_quantise(mp_mesh_t *mesh, uint8_t uv_format, char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_dequantise(mp_mesh_t *mesh, float *positions, float *uv_coordinates);
+void mp_mesh_quantise_unorm16(const float *values, uint32_t count, uint32_t num_components,
+		const float *minimum, const float *inverse_scale, uint16_t *quantised);
+void mp_mesh_dequantise_unorm16(const uint16_t *quantised, uint32_t count, uint32_t num_components,
+			const float *minimum, const float *scale, float *values);
+void mp_mesh_quantise_half(const float *values, size_t count, uint16_t *quantised);
+void mp_mesh_dequantise_half(const uint16_t *quantised, size_t count, float *values);
+
+// Offset and step across a range, with no step for an empty range:
+static inline void mp_mesh_quantise_get_scale(float minimum, float maximum, float *scale,
+								float *inverse_scale)
+{
+	float extent = maximum - minimum;
+	*scale = (extent > 0.0f) ? (extent / MP_UNORM16_MAX) : 0.0f;
+	*inverse_scale = (extent > 0.0f) ? (MP_UNORM16_MAX / extent) : 0.0f;
+}
+
+// Rounded to nearest even, as the SIMD conversion, so both paths agree:
+static inline uint16_t mp_mesh_quantise_unorm16_value(float value, float minimum,
+								float inverse_scale)
+{
+	float scaled = fminf(fmaxf((value - minimum) * inverse_scale, 0.0f), MP_UNORM16_MAX);
+	return (uint16_t)lrintf(scaled);
+}
+
+static inline float mp_mesh_dequantise_unorm16_value(uint16_t value, float minimum, float scale)
+{
+	return minimum + ((float)value * scale);
+}
+
+// IEEE half precision, rounded to nearest even. Out of range values become infinity:
+static inline uint16_t mp_mesh_float_to_half(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	if (magnitude > 0x7f800000) { return sign | 0x7e00; }
+	if (magnitude >= 0x477ff000) { return sign | 0x7c00; }
+
+	// Below the smallest normal half, the implicit bit joins the mantissa:
+	if (magnitude < 0x38800000)
+	{
+		if (magnitude < 0x33000000) { return sign; }
+		uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+		uint32_t shift = 126 - (magnitude >> 23);
+		uint32_t result = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if ((remainder > halfway) || ((remainder == halfway) && (result & 1))) { result++; }
+		return sign | (uint16_t)result;
+	}
+
+	// Rebias the exponent. Rounding up may carry into it, which is still correct:
+	uint32_t result = (magnitude - 0x38000000) >> 13;
+	uint32_t remainder = magnitude & 0x1fff;
+	if ((remainder > 0x1000) || ((remainder == 0x1000) && (result & 1))) { result++; }
+	return sign | (uint16_t)result;
+}
+
+static inline float mp_mesh_half_to_float(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	float value;
+	if (!exponent)
+	{
+		// Zero or subnormal, in units of 2^-24:
+		value = (float)mantissa * (1.0f / 16777216.0f);
+		return sign ? -value : value;
+	}
+
+	uint32_t bits = sign | (mantissa << 13);
+	bits |= (exponent == 0x1f) ? 0x7f800000 : ((exponent + 112) << 23);
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+#endif
@@ -0,0 +1,413 @@
+#include "Mesh-Reorder.h"
+#include "Sort.h"
+
+int mp_mesh_reorder_spatial(mp_mesh_t *mesh, uint8_t curve, mp_mesh_reorder_report_t *report,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	uint32_t count = mesh->num_vertices;
+	if (mesh->num_faces[0] > count) { count = mesh->num_faces[0]; }
+
+	uint64_t *keys = malloc(((size_t)count + 1) * sizeof(uint64_t));
+	uint32_t *new_to_old = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	uint32_t *old_to_new = malloc(((size_t)count + 1) * sizeof(uint32_t));
+	if (!keys || !new_to_old || !old_to_new)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for reordering mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	if (report)
+	{
+		mp_mesh_measure_index_spread(mesh, &(report->vertex_spread_before),
+							&(report->face_spread_before));
+	}
+
+	// Quantise positions to the curve grid over the mesh bounds:
+	mp_position_t minimum, maximum;
+	mp_mesh_calculate_bounds(mesh, &minimum, &maximum);
+	float extent[3] = { maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z };
+	float scale[3];
+	for (int i = 0; i < 3; i++)
+	{
+		scale[i] = (extent[i] > 0.0f) ? ((float)MP_MESH_CURVE_MAX / extent[i]) : 0.0f;
+	}
+
+	/************
+	 * Vertices *
+	 ************/
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		mp_position_t position = mp_mesh_get_position(mesh, i);
+		keys[i] = mp_mesh_curve_code(curve,
+				mp_mesh_curve_quantise(position.x, minimum.x, scale[0]),
+				mp_mesh_curve_quantise(position.y, minimum.y, scale[1]),
+				mp_mesh_curve_quantise(position.z, minimum.z, scale[2]));
+		new_to_old[i] = i;
+	}
+
+	// The sort is stable, so equal codes keep their original order:
+	if (mp_sort_radix_u64(keys, new_to_old, mesh->num_vertices))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for sorting vertices of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++) { old_to_new[new_to_old[i]] = i; }
+
+	if (mp_mesh_remap_vertices(mesh, new_to_old, old_to_new, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/*********
+	 * Faces *
+	 *********/
+
+	if (mp_mesh_sort_faces_by_curve(mesh, 0, curve, keys, new_to_old))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for sorting faces of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_faces[0]; i++) { old_to_new[new_to_old[i]] = i; }
+
+	if (mp_mesh_remap_faces(mesh, 0, new_to_old, old_to_new, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	if (report)
+	{
+		mp_mesh_measure_index_spread(mesh, &(report->vertex_spread_after),
+							&(report->face_spread_after));
+	}
+
+	cleanup:
+	if (keys) { free(keys); }
+	if (new_to_old) { free(new_to_old); }
+	if (old_to_new) { free(old_to_new); }
+	return return_value;
+}
+
+int mp_mesh_sort_faces_by_curve(mp_mesh_t *mesh, uint8_t lod, uint8_t curve, uint64_t *keys,
+									uint32_t *order)
+{
+	// Codes of face centroids, quantised over the mesh bounds as for vertices:
+	mp_position_t minimum, maximum;
+	mp_mesh_calculate_bounds(mesh, &minimum, &maximum);
+	float extent[3] = { maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z };
+	float scale[3];
+	for (int i = 0; i < 3; i++)
+	{
+		scale[i] = (extent[i] > 0.0f) ? ((float)MP_MESH_CURVE_MAX / extent[i]) : 0.0f;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_faces[lod]; i++)
+	{
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		for (int j = 0; j < 3; j++)
+		{
+			mp_position_t position = mp_mesh_get_position(mesh,
+						mp_mesh_get_face_vertex(mesh, lod, i, j));
+			centroid[0] += position.x;
+			centroid[1] += position.y;
+			centroid[2] += position.z;
+		}
+		keys[i] = mp_mesh_curve_code(curve,
+				mp_mesh_curve_quantise(centroid[0] / 3.0f, minimum.x, scale[0]),
+				mp_mesh_curve_quantise(centroid[1] / 3.0f, minimum.y, scale[1]),
+				mp_mesh_curve_quantise(centroid[2] / 3.0f, minimum.z, scale[2]));
+		order[i] = i;
+	}
+
+	return mp_sort_radix_u64(keys, order, mesh->num_faces[lod]);
+}
+
+void mp_mesh_measure_index_spread(mp_mesh_t *mesh, double *vertex_spread, double *face_spread)
+{
+	double vertex_total = 0.0;
+	#pragma omp parallel for reduction(+:vertex_total)
+	for (uint32_t i = 0; i < mesh->num_faces[0]; i++)
+	{
+		uint32_t lowest = UINT32_MAX;
+		uint32_t highest = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t vertex = mp_mesh_get_face_vertex(mesh, 0, i, j);
+			if (vertex < lowest) { lowest = vertex; }
+			if (vertex > highest) { highest = vertex; }
+		}
+		vertex_total += (double)(highest - lowest);
+	}
+
+	double face_total = 0.0;
+	uint32_t num_interior_edges = 0;
+	#pragma omp parallel for reduction(+:face_total, num_interior_edges)
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		int64_t other_half = mp_mesh_get_edge_other_half(mesh, i);
+		if (other_half == -1) { continue; }
+		uint32_t face = i / 3;
+		uint32_t other_face = (uint32_t)(other_half / 3);
+		face_total += (double)((face > other_face) ? (face - other_face) : (other_face - face));
+		num_interior_edges++;
+	}
+
+	*vertex_spread = mesh->num_faces[0] ? (vertex_total / mesh->num_faces[0]) : 0.0;
+	*face_spread = num_interior_edges ? (face_total / num_interior_edges) : 0.0;
+}
+
+uint64_t mp_mesh_curve_code(uint8_t curve, uint32_t x, uint32_t y, uint32_t z)
+{
+	if (curve == MP_MESH_CURVE_HILBERT)
+	{
+		uint32_t axes[3] = { x & MP_MESH_CURVE_MAX, y & MP_MESH_CURVE_MAX,
+								z & MP_MESH_CURVE_MAX };
+		mp_mesh_hilbert_transpose(axes);
+		x = axes[0];
+		y = axes[1];
+		z = axes[2];
+	}
+
+	// The first axis takes the highest bit of each group of three:
+	return (mp_mesh_morton_expand(x) << 2) | (mp_mesh_morton_expand(y) << 1) |
+								mp_mesh_morton_expand(z);
+}
+
+void mp_mesh_hilbert_transpose(uint32_t axes[3])
+{
+	/* Skilling's method ("Programming the Hilbert curve", 2004): converts coordinates in place
+	 * to the transposed Hilbert index, whose interleaved bits are the distance along the curve: */
+	uint32_t t;
+	for (uint32_t q = 1u << (MP_MESH_CURVE_BITS - 1); q > 1; q >>= 1)
+	{
+		uint32_t p = q - 1;
+		for (int i = 0; i < 3; i++)
+		{
+			if (axes[i] & q) { axes[0] ^= p; }
+			else
+			{
+				t = (axes[0] ^ axes[i]) & p;
+				axes[0] ^= t;
+				axes[i] ^= t;
+			}
+		}
+	}
+
+	// Gray encode:
+	axes[1] ^= axes[0];
+	axes[2] ^= axes[1];
+	t = 0;
+	for (uint32_t q = 1u << (MP_MESH_CURVE_BITS - 1); q > 1; q >>= 1)
+	{
+		if (axes[2] & q) { t ^= q - 1; }
+	}
+	for (int i = 0; i < 3; i++) { axes[i] ^= t; }
+}
+
+int mp_mesh_remap_vertices(mp_mesh_t *mesh, const uint32_t *new_to_old, const uint32_t *old_to_new,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	// One scratch buffer, allocated first, so the mesh is never left half remapped:
+	void *scratch = malloc(((size_t)mesh->num_vertices + 1) * sizeof(mp_position_t));
+	if (!scratch)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for remapping vertices of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	if (mp_mesh_is_soa(mesh))
+	{
+		mp_mesh_permute_array(mesh->soa.x, scratch, sizeof(float), mesh->num_vertices,
+										new_to_old);
+		mp_mesh_permute_array(mesh->soa.y, scratch, sizeof(float), mesh->num_vertices,
+										new_to_old);
+		mp_mesh_permute_array(mesh->soa.z, scratch, sizeof(float), mesh->num_vertices,
+										new_to_old);
+	}
+	else
+	{
+		mp_mesh_permute_array(mesh->vertices, scratch, sizeof(mp_position_t),
+						mesh->num_vertices, new_to_old);
+	}
+	mp_mesh_permute_array(mesh->first_edge, scratch, sizeof(uint32_t), mesh->num_vertices,
+										new_to_old);
+	if (mesh->quantised.positions)
+	{
+		mp_mesh_permute_array(mesh->quantised.positions, scratch, 3 * sizeof(uint16_t),
+							mesh->num_vertices, new_to_old);
+	}
+	free(scratch);
+
+	// Levels sharing the base level faces are renumbered once:
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		uint32_t stride;
+		uint32_t *indices = (uint32_t *)mp_mesh_get_position_indices(mesh, i, &stride);
+		if (!indices) { continue; }
+		if ((i > 0) && (indices == mp_mesh_get_position_indices(mesh, 0, &stride))) { continue; }
+
+		#pragma omp parallel for
+		for (uint32_t j = 0; j < mesh->num_faces[i]; j++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				indices[(j * stride) + k] = old_to_new[indices[(j * stride) + k]];
+			}
+		}
+	}
+
+	if (mesh->edges)
+	{
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_edges; i++)
+		{
+			mesh->edges[i].from = old_to_new[mesh->edges[i].from];
+			mesh->edges[i].to = old_to_new[mesh->edges[i].to];
+		}
+	}
+
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		mp_mesh_meshlets_t *meshlets = &(mesh->meshlets[i]);
+
+		#pragma omp parallel for
+		for (uint32_t j = 0; j < meshlets->num_vertices; j++)
+		{
+			meshlets->vertices[j] = old_to_new[meshlets->vertices[j]];
+		}
+	}
+
+	return 0;
+}
+
+int mp_mesh_remap_faces(mp_mesh_t *mesh, uint8_t lod, const uint32_t *new_to_old,
+		const uint32_t *old_to_new, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	// Levels sharing the base level faces are the base level here:
+	uint32_t stride;
+	uint8_t is_base_level = (lod == 0) || (mp_mesh_get_position_indices(mesh, lod, &stride) ==
+						mp_mesh_get_position_indices(mesh, 0, &stride));
+	if (is_base_level) { lod = 0; }
+	uint32_t num_faces = mesh->num_faces[lod];
+
+	size_t scratch_size = (size_t)num_faces * sizeof(mp_face_t);
+	if (is_base_level && (((size_t)mesh->num_edges * sizeof(mp_edge_t)) > scratch_size))
+	{
+		scratch_size = (size_t)mesh->num_edges * sizeof(mp_edge_t);
+	}
+	void *scratch = malloc(scratch_size + 1);
+	if (!scratch)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for remapping faces of mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Each face keeps its three corners, so SoA arrays move three indices at a time:
+	if (mp_mesh_is_soa(mesh))
+	{
+		size_t corners = 3 * sizeof(uint32_t);
+		mp_mesh_permute_array(mesh->soa.p[lod], scratch, corners, num_faces, new_to_old);
+		mp_mesh_permute_array(mesh->soa.n[lod], scratch, corners, num_faces, new_to_old);
+		mp_mesh_permute_array(mesh->soa.c[lod], scratch, corners, num_faces, new_to_old);
+		mp_mesh_permute_array(mesh->soa.u[lod], scratch, corners, num_faces, new_to_old);
+	}
+	else
+	{
+		mp_mesh_permute_array(mesh->faces[lod], scratch, sizeof(mp_face_t), num_faces,
+										new_to_old);
+	}
+
+	// Meshlets keep their faces, under the new numbering:
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if ((i != lod) && !(is_base_level && (mp_mesh_get_position_indices(mesh, i, &stride) ==
+						mp_mesh_get_position_indices(mesh, 0, &stride)))) { continue; }
+		mp_mesh_meshlets_t *meshlets = &(mesh->meshlets[i]);
+
+		#pragma omp parallel for
+		for (uint32_t j = 0; j < meshlets->num_triangles; j++)
+		{
+			meshlets->faces[j] = old_to_new[meshlets->faces[j]];
+		}
+	}
+
+	if (!is_base_level)
+	{
+		free(scratch);
+		return 0;
+	}
+
+	// Edge e of old face f becomes edge e of new face old_to_new[f]:
+	if (mesh->edges)
+	{
+		mp_edge_t *edges = scratch;
+		memcpy(edges, mesh->edges, mesh->num_edges * sizeof(mp_edge_t));
+
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_edges; i++)
+		{
+			mp_edge_t edge = edges[(new_to_old[i / 3] * 3) + (i % 3)];
+			edge.next = (i - (i % 3)) + ((i + 1) % 3);
+			if (edge.other_half != -1)
+			{
+				edge.other_half = mp_mesh_remap_edge(old_to_new, edge.other_half);
+			}
+			mesh->edges[i] = edge;
+		}
+	}
+	else
+	{
+		uint32_t *twins = scratch;
+		memcpy(twins, mesh->twins, mesh->num_edges * sizeof(uint32_t));
+
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_edges; i++)
+		{
+			uint32_t twin = twins[(new_to_old[i / 3] * 3) + (i % 3)];
+			if (twin != MP_EDGE_NONE) { twin = mp_mesh_remap_edge(old_to_new, twin); }
+			mesh->twins[i] = twin;
+		}
+	}
+	free(scratch);
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		if (mesh->first_edge[i] >= mesh->num_edges) { continue; }
+		mesh->first_edge[i] = mp_mesh_remap_edge(old_to_new, mesh->first_edge[i]);
+	}
+
+	return 0;
+}
+
+void mp_mesh_permute_array(void *array, void *scratch, size_t element_size, uint32_t count,
+							const uint32_t *new_to_old)
+{
+	uint8_t *destination = array;
+	const uint8_t *source = scratch;
+	memcpy(scratch, array, count * element_size);
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < count; i++)
+	{
+		memcpy(destination + (i * element_size), source + (new_to_old[i] * element_size),
+									element_size);
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef MP_MESH_REORDER_H
+#define MP_MESH_REORDER_H
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+
+// Bits per axis in space-filling curve codes, so three axes fit in 63 bits:
+#define MP_MESH_CURVE_BITS	21
+#define MP_MESH_CURVE_MAX	((1u << MP_MESH_CURVE_BITS) - 1)
+
+enum
+{
+	MP_MESH_CURVE_MORTON,
+	MP_MESH_CURVE_HILBERT
+};
+
+/* Mean index spread: vertex spread is the gap between the lowest and highest vertex index in
+ * a face, face spread is the gap between the two faces on either side of an interior edge: */
+typedef struct
+{
+	double vertex_spread_before;
+	double vertex_spread_after;
+	double face_spread_before;
+	double face_spread_after;
+} mp_mesh_reorder_report_t;
+
+int mp_mesh_reorder_spatial(mp_mesh_t *mesh, uint8_t curve, mp_mesh_reorder_report_t *report,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_sort_faces_by_curve(mp_mesh_t *mesh, uint8_t lod, uint8_t curve, uint64_t *keys,
+									uint32_t *order);
+void mp_mesh_measure_index_spread(mp_mesh_t *mesh, double *vertex_spread, double *face_spread);
+uint64_t mp_mesh_curve_code(uint8_t curve, uint32_t x, uint32_t y, uint32_t z);
+void mp_mesh_hilbert_transpose(uint32_t axes[3]);
+
+/* Shared remapping. Each takes a permutation as both new-to-old and old-to-new index arrays.
+ * Vertex remapping renumbers positions, face position indices in every level, edge endpoints
+ * and first_edge. Face remapping reorders one level's faces, along with the edges and twins
+ * when that level holds the base faces: */
+int mp_mesh_remap_vertices(mp_mesh_t *mesh, const uint32_t *new_to_old, const uint32_t *old_to_new,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_remap_faces(mp_mesh_t *mesh, uint8_t lod, const uint32_t *new_to_old,
+		const uint32_t *old_to_new, char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_permute_array(void *array, void *scratch, size_t element_size, uint32_t count,
+							const uint32_t *new_to_old);
+
+// Spreads the low 21 bits of value three bits apart:
+static inline uint64_t mp_mesh_morton_expand(uint32_t value)
+{
+	uint64_t x = value & MP_MESH_CURVE_MAX;
+	x = (x | (x << 32)) & 0x001f00000000ffffULL;
+	x = (x | (x << 16)) & 0x001f0000ff0000ffULL;
+	x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+	x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+	x = (x | (x << 2)) & 0x1249249249249249ULL;
+	return x;
+}
+
+static inline uint32_t mp_mesh_curve_quantise(float value, float minimum, float scale)
+{
+	float quantised = (value - minimum) * scale;
+	if (!(quantised > 0.0f)) { return 0; }
+	if (quantised >= (float)MP_MESH_CURVE_MAX) { return MP_MESH_CURVE_MAX; }
+	return (uint32_t)quantised;
+}
+
+static inline uint32_t mp_mesh_remap_edge(const uint32_t *face_old_to_new, uint32_t edge)
+{
+	return (face_old_to_new[edge / 3] * 3) + (edge % 3);
+}
+
+#endif
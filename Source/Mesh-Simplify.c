@@ -0,0 +1,962 @@
+#include "Mesh-Simplify.h"
+
+#include <float.h>
+
+int mp_mesh_generate_lods(mp_mesh_t *mesh, const mp_mesh_lod_target_t *targets, uint8_t num_levels,
+			mp_mesh_lod_report_t *report, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (mp_mesh_check_lod_arguments(mesh, num_levels, error_message)) { return -1; }
+
+	mp_mesh_simplifier_t simplifier;
+	if (mp_mesh_simplifier_init(mesh, &simplifier, error_message)) { return -1; }
+
+	int return_value = 0;
+	mp_mesh_simplifier_seed_heap(mesh, &simplifier);
+
+	if (report)
+	{
+		memset(report, 0, sizeof(*report));
+		report->num_faces[0] = mesh->num_faces[0];
+	}
+
+	// Levels are snapshots of one simplification, each continuing from the last:
+	float error = 0.0f;
+	for (uint8_t lod = 1; lod < num_levels; lod++)
+	{
+		if (mp_mesh_simplifier_run(mesh, &simplifier, targets[lod - 1], &error))
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for simplifying mesh \"%s\".", mesh->name);
+			return_value = -1;
+			goto cleanup;
+		}
+
+		if (mp_mesh_simplifier_write_level(mesh, &simplifier, lod, error_message))
+		{
+			return_value = -1;
+			goto cleanup;
+		}
+
+		if (report)
+		{
+			report->num_faces[lod] = mesh->num_faces[lod];
+			report->errors[lod] = error;
+		}
+	}
+
+	// Levels left over from an earlier call go back to sharing the base level:
+	for (uint8_t lod = num_levels; lod < NM_MAX_LOD_LEVELS; lod++) { mp_mesh_free_level(mesh, lod); }
+	mesh->num_lod_levels = num_levels;
+
+	cleanup:
+	mp_mesh_simplifier_free(&simplifier);
+	return return_value;
+}
+
+int mp_mesh_generate_lods_parallel(mp_mesh_t *mesh, const mp_mesh_lod_target_t *targets,
+	uint8_t num_levels, mp_mesh_lod_report_t *report, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (mp_mesh_check_lod_arguments(mesh, num_levels, error_message)) { return -1; }
+
+	int return_value = 0;
+	uint32_t num_faces = mesh->num_faces[0];
+	uint32_t num_clusters = (num_faces + MP_MESH_SIMPLIFY_CLUSTER_SIZE - 1) /
+							MP_MESH_SIMPLIFY_CLUSTER_SIZE;
+	mp_mesh_simplifier_t simplifier;
+	memset(&simplifier, 0, sizeof(simplifier));
+	mp_mesh_quadric_t *quadrics = NULL;
+
+	uint64_t *keys = malloc(((size_t)num_faces + 1) * sizeof(uint64_t));
+	uint32_t *order = malloc(((size_t)num_faces + 1) * sizeof(uint32_t));
+	uint32_t *vertex_owners = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint32_t));
+	mp_mesh_simplifier_t *clusters = calloc((size_t)num_clusters + 1, sizeof(mp_mesh_simplifier_t));
+	uint32_t *free_faces = malloc(((size_t)num_clusters + 1) * sizeof(uint32_t));
+	if (!keys || !order || !vertex_owners || !clusters || !free_faces ||
+		mp_mesh_sort_faces_by_curve(mesh, 0, MP_MESH_CURVE_MORTON, keys, order))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for clustering mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/* Clusters are runs of faces along the curve. A vertex belongs to the first cluster to claim
+	 * it, or is shared once a second cluster uses it: */
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++) { vertex_owners[i] = MP_EDGE_NONE; }
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (uint32_t i = 0; i < num_clusters; i++)
+	{
+		uint32_t start = i * MP_MESH_SIMPLIFY_CLUSTER_SIZE;
+		uint32_t end = start + MP_MESH_SIMPLIFY_CLUSTER_SIZE;
+		if (end > num_faces) { end = num_faces; }
+		for (uint32_t j = start; j < end; j++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t vertex = mp_mesh_get_face_vertex(mesh, 0, order[j], k);
+				uint32_t expected = MP_EDGE_NONE;
+				if (__atomic_compare_exchange_n(&(vertex_owners[vertex]), &expected, i, 0,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED) || (expected == i)) { continue; }
+				__atomic_store_n(&(vertex_owners[vertex]), MP_MESH_SIMPLIFY_SHARED_VERTEX,
+										__ATOMIC_RELAXED);
+			}
+		}
+	}
+
+	// The whole mesh simplifier stitches cluster borders, from the base quadrics each level:
+	if (mp_mesh_simplifier_init(mesh, &simplifier, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+	quadrics = malloc(((size_t)mesh->num_vertices + 1) * sizeof(mp_mesh_quadric_t));
+	if (!quadrics)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for simplifying mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+	memcpy(quadrics, simplifier.quadrics, mesh->num_vertices * sizeof(mp_mesh_quadric_t));
+
+	uint8_t failed = 0;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed)
+	for (uint32_t i = 0; i < num_clusters; i++)
+	{
+		uint32_t start = i * MP_MESH_SIMPLIFY_CLUSTER_SIZE;
+		uint32_t count = num_faces - start;
+		if (count > MP_MESH_SIMPLIFY_CLUSTER_SIZE) { count = MP_MESH_SIMPLIFY_CLUSTER_SIZE; }
+		if (mp_mesh_simplifier_init_cluster(mesh, &(clusters[i]), order + start, NULL, count,
+					vertex_owners, simplifier.inverse_diagonal)) { failed = 1; }
+		free_faces[i] = clusters[i].num_faces - clusters[i].num_locked_faces;
+	}
+	if (failed)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for simplifying clusters of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	if (report)
+	{
+		memset(report, 0, sizeof(*report));
+		report->num_faces[0] = num_faces;
+	}
+
+	float error = 0.0f;
+	for (uint8_t lod = 1; lod < num_levels; lod++)
+	{
+		/* Each cluster keeps its share of the target faces away from its borders, and continues
+		 * from the last level: */
+		mp_mesh_lod_target_t target = targets[lod - 1];
+		double ratio = (double)target.target_faces / (double)num_faces;
+		float cluster_error = 0.0f;
+		#pragma omp parallel for schedule(dynamic, 1) reduction(|:failed) reduction(max:cluster_error)
+		for (uint32_t i = 0; i < num_clusters; i++)
+		{
+			mp_mesh_lod_target_t cluster_target = target;
+			if (target.target_faces)
+			{
+				cluster_target.target_faces = (uint32_t)ceil(free_faces[i] * ratio);
+			}
+			if (mp_mesh_simplifier_run(mesh, &(clusters[i]), cluster_target, &cluster_error))
+			{
+				failed = 1;
+			}
+		}
+		if (cluster_error > error) { error = cluster_error; }
+
+		/* Stitching starts over from the clusters each level, as their borders are redone. The
+		 * heap starts with edges at shared vertices, and spreads from them as collapses go: */
+		mp_mesh_simplifier_reset(&simplifier, quadrics);
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (uint32_t i = 0; i < num_clusters; i++)
+		{
+			mp_mesh_simplifier_apply_cluster(&simplifier, &(clusters[i]));
+		}
+		simplifier.num_live_faces = 0;
+		for (uint32_t i = 0; i < num_clusters; i++)
+		{
+			simplifier.num_live_faces += clusters[i].num_live_faces;
+		}
+
+		mp_mesh_simplifier_seed_heap_shared(mesh, &simplifier, vertex_owners);
+		if (failed || mp_mesh_simplifier_run(mesh, &simplifier, target, &error))
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for simplifying mesh \"%s\".", mesh->name);
+			return_value = -1;
+			goto cleanup;
+		}
+
+		if (mp_mesh_simplifier_write_level(mesh, &simplifier, lod, error_message))
+		{
+			return_value = -1;
+			goto cleanup;
+		}
+
+		if (report)
+		{
+			report->num_faces[lod] = mesh->num_faces[lod];
+			report->errors[lod] = error;
+		}
+	}
+
+	for (uint8_t lod = num_levels; lod < NM_MAX_LOD_LEVELS; lod++) { mp_mesh_free_level(mesh, lod); }
+	mesh->num_lod_levels = num_levels;
+
+	cleanup:
+	if (clusters)
+	{
+		for (uint32_t i = 0; i < num_clusters; i++) { mp_mesh_simplifier_free(&(clusters[i])); }
+		free(clusters);
+	}
+	mp_mesh_simplifier_free(&simplifier);
+	if (keys) { free(keys); }
+	if (order) { free(order); }
+	if (vertex_owners) { free(vertex_owners); }
+	if (free_faces) { free(free_faces); }
+	if (quadrics) { free(quadrics); }
+	return return_value;
+}
+
+int mp_mesh_check_lod_arguments(mp_mesh_t *mesh, uint8_t num_levels,
+				char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if ((num_levels < 1) || (num_levels > NM_MAX_LOD_LEVELS))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Mesh \"%s\" can have 1 to %d LOD levels, not %u.", mesh->name,
+			NM_MAX_LOD_LEVELS, num_levels);
+		return -1;
+	}
+	if (!mesh->edges && !mesh->twins)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Edges of mesh \"%s\" must be calculated before generating LOD levels.",
+			mesh->name);
+		return -1;
+	}
+	return 0;
+}
+
+int mp_mesh_simplifier_init(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	memset(simplifier, 0, sizeof(*simplifier));
+	simplifier->indices = mp_mesh_get_position_indices(mesh, 0, &(simplifier->stride));
+	simplifier->num_faces = mesh->num_faces[0];
+	simplifier->num_vertices = mesh->num_vertices;
+
+	if (mp_mesh_build_vertex_faces(mesh, 0, &(simplifier->vertex_faces), error_message))
+	{
+		return -1;
+	}
+
+	if (mp_mesh_simplifier_allocate(simplifier, mesh->num_edges + 1))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for simplifying mesh \"%s\".", mesh->name);
+		mp_mesh_simplifier_free(simplifier);
+		return -1;
+	}
+
+	mp_position_t minimum, maximum;
+	mp_mesh_calculate_bounds(mesh, &minimum, &maximum);
+	double x = (double)maximum.x - minimum.x;
+	double y = (double)maximum.y - minimum.y;
+	double z = (double)maximum.z - minimum.z;
+	double diagonal = sqrt((x * x) + (y * y) + (z * z));
+	simplifier->inverse_diagonal = (diagonal > 0.0) ? (1.0 / diagonal) : 1.0;
+
+	mp_mesh_simplifier_calculate_quadrics(mesh, simplifier);
+	return 0;
+}
+
+int mp_mesh_simplifier_init_cluster(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+		const uint32_t *faces, const uint32_t *indices, uint32_t num_faces,
+		const uint32_t *vertex_owners, double inverse_diagonal)
+{
+	/* Runs on one thread per cluster, so the cluster is built serially. Faces are base level
+	 * faces, with their own position indices (three per face) when indices isn't NULL: */
+	memset(simplifier, 0, sizeof(*simplifier));
+	simplifier->stride = 3;
+	simplifier->num_faces = num_faces;
+	simplifier->face_map = faces;
+	simplifier->inverse_diagonal = inverse_diagonal;
+
+	uint32_t num_corners = num_faces * 3;
+	uint64_t capacity = 1;
+	while (capacity < ((uint64_t)num_corners * 2)) { capacity <<= 1; }
+	uint64_t mask = capacity - 1;
+
+	int return_value = 0;
+	uint64_t *table_keys = malloc(capacity * sizeof(uint64_t));
+	uint32_t *table_values = malloc(capacity * sizeof(uint32_t));
+	simplifier->cluster_indices = malloc(((size_t)num_corners + 1) * sizeof(uint32_t));
+	simplifier->vertex_map = malloc(((size_t)num_corners + 1) * sizeof(uint32_t));
+	if (!table_keys || !table_values || !simplifier->cluster_indices || !simplifier->vertex_map)
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	// Number the cluster's vertices in order of first use:
+	uint32_t num_vertices = 0;
+	for (uint64_t i = 0; i < capacity; i++) { table_keys[i] = MP_EDGE_HASH_EMPTY; }
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		uint32_t vertex = indices ? indices[i] :
+					mp_mesh_get_face_vertex(mesh, 0, faces[i / 3], i % 3);
+		uint64_t slot = mp_mesh_edge_hash(vertex) & mask;
+		while ((table_keys[slot] != MP_EDGE_HASH_EMPTY) && (table_keys[slot] != vertex))
+		{
+			slot = (slot + 1) & mask;
+		}
+		if (table_keys[slot] == MP_EDGE_HASH_EMPTY)
+		{
+			table_keys[slot] = vertex;
+			table_values[slot] = num_vertices;
+			simplifier->vertex_map[num_vertices++] = vertex;
+		}
+		simplifier->cluster_indices[i] = table_values[slot];
+	}
+	simplifier->indices = simplifier->cluster_indices;
+	simplifier->num_vertices = num_vertices;
+
+	// Triangles no longer in the mesh have no half-edges to follow:
+	if (indices)
+	{
+		uint32_t num_duplicates;
+		simplifier->twins = malloc(((size_t)num_corners + 1) * sizeof(uint32_t));
+		if (!simplifier->twins || mp_mesh_pair_edges_hash(simplifier->cluster_indices, 3,
+						num_faces, simplifier->twins, &num_duplicates))
+		{
+			return_value = -1;
+			goto cleanup;
+		}
+	}
+
+	simplifier->is_locked = malloc((size_t)num_vertices + 1);
+	if (!simplifier->is_locked || mp_mesh_build_vertex_faces_from_indices(
+			simplifier->cluster_indices, 3, num_faces, num_vertices,
+			&(simplifier->vertex_faces)) ||
+		mp_mesh_simplifier_allocate(simplifier, num_corners + 1))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		simplifier->is_locked[i] = (vertex_owners[simplifier->vertex_map[i]] ==
+							MP_MESH_SIMPLIFY_SHARED_VERTEX);
+	}
+	for (uint32_t i = 0; i < num_faces; i++)
+	{
+		const uint32_t *corners = simplifier->cluster_indices + (i * 3);
+		if (simplifier->is_locked[corners[0]] || simplifier->is_locked[corners[1]] ||
+			simplifier->is_locked[corners[2]]) { simplifier->num_locked_faces++; }
+	}
+
+	mp_mesh_simplifier_calculate_quadrics(mesh, simplifier);
+	mp_mesh_simplifier_seed_heap(mesh, simplifier);
+
+	cleanup:
+	if (table_keys) { free(table_keys); }
+	if (table_values) { free(table_values); }
+	return return_value;
+}
+
+int mp_mesh_simplifier_allocate(mp_mesh_simplifier_t *simplifier, uint32_t heap_capacity)
+{
+	size_t num_vertices = (size_t)simplifier->num_vertices + 1;
+	simplifier->heap_capacity = heap_capacity;
+	simplifier->is_live_face = malloc((size_t)simplifier->num_faces + 1);
+	simplifier->collapsed_to = malloc(num_vertices * sizeof(uint32_t));
+	simplifier->next_member = malloc(num_vertices * sizeof(uint32_t));
+	simplifier->versions = calloc(num_vertices, sizeof(uint32_t));
+	simplifier->marks = calloc(num_vertices, sizeof(uint32_t));
+	simplifier->is_boundary = malloc(num_vertices);
+	simplifier->quadrics = malloc(num_vertices * sizeof(mp_mesh_quadric_t));
+	simplifier->heap = malloc((size_t)heap_capacity * sizeof(mp_mesh_collapse_t));
+	if (!simplifier->is_live_face || !simplifier->collapsed_to || !simplifier->next_member ||
+		!simplifier->versions || !simplifier->marks || !simplifier->is_boundary ||
+		!simplifier->quadrics || !simplifier->heap) { return -1; }
+
+	simplifier->num_live_faces = simplifier->num_faces;
+	memset(simplifier->is_live_face, 1, simplifier->num_faces);
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < simplifier->num_vertices; i++)
+	{
+		simplifier->collapsed_to[i] = i;
+		simplifier->next_member[i] = i;
+	}
+	return 0;
+}
+
+void mp_mesh_simplifier_free(mp_mesh_simplifier_t *simplifier)
+{
+	mp_mesh_vertex_faces_free(&(simplifier->vertex_faces));
+	if (simplifier->is_live_face) { free(simplifier->is_live_face); }
+	if (simplifier->collapsed_to) { free(simplifier->collapsed_to); }
+	if (simplifier->next_member) { free(simplifier->next_member); }
+	if (simplifier->versions) { free(simplifier->versions); }
+	if (simplifier->marks) { free(simplifier->marks); }
+	if (simplifier->is_boundary) { free(simplifier->is_boundary); }
+	if (simplifier->quadrics) { free(simplifier->quadrics); }
+	if (simplifier->heap) { free(simplifier->heap); }
+	if (simplifier->cluster_indices) { free(simplifier->cluster_indices); }
+	if (simplifier->vertex_map) { free(simplifier->vertex_map); }
+	if (simplifier->is_locked) { free(simplifier->is_locked); }
+	if (simplifier->twins) { free(simplifier->twins); }
+	memset(simplifier, 0, sizeof(*simplifier));
+}
+
+void mp_mesh_simplifier_calculate_quadrics(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier)
+{
+	/* Each vertex gathers the area-weighted planes of its faces, and a plane through each of its
+	 * boundary edges at right angles to the face, so no two threads write the same quadric: */
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < simplifier->num_vertices; i++)
+	{
+		mp_mesh_quadric_t quadric;
+		memset(&quadric, 0, sizeof(quadric));
+		uint8_t is_boundary = 0;
+
+		uint32_t face;
+		mp_mesh_adjacency_iterator_t it = mp_mesh_vertex_faces_begin(
+						&(simplifier->vertex_faces), i);
+		while (mp_mesh_adjacency_iterator_next(&it, &face))
+		{
+			const uint32_t *corners = simplifier->indices + (face * simplifier->stride);
+			mp_position_t p[3];
+			for (int j = 0; j < 3; j++)
+			{
+				p[j] = mp_mesh_simplifier_get_position(mesh, simplifier, corners[j]);
+			}
+			double u[3] = { p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z };
+			double v[3] = { p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z };
+			double n[3] = { (u[1] * v[2]) - (u[2] * v[1]), (u[2] * v[0]) - (u[0] * v[2]),
+					(u[0] * v[1]) - (u[1] * v[0]) };
+			double length = sqrt((n[0] * n[0]) + (n[1] * n[1]) + (n[2] * n[2]));
+			if (length == 0.0) { continue; }
+			for (int j = 0; j < 3; j++) { n[j] /= length; }
+
+			double d = -((n[0] * p[0].x) + (n[1] * p[0].y) + (n[2] * p[0].z));
+			mp_mesh_quadric_add_plane(&quadric, n[0], n[1], n[2], d, length * 0.5);
+
+			for (int j = 0; j < 3; j++)
+			{
+				if (mp_mesh_simplifier_get_other_half(mesh, simplifier, (face * 3) + j) >= 0)
+				{
+					continue;
+				}
+				if ((corners[j] != i) && (corners[(j + 1) % 3] != i)) { continue; }
+				is_boundary = 1;
+
+				mp_position_t a = p[j];
+				mp_position_t b = p[(j + 1) % 3];
+				double t[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+				double m[3] = { (t[1] * n[2]) - (t[2] * n[1]), (t[2] * n[0]) - (t[0] * n[2]),
+						(t[0] * n[1]) - (t[1] * n[0]) };
+				double m_length = sqrt((m[0] * m[0]) + (m[1] * m[1]) + (m[2] * m[2]));
+				if (m_length == 0.0) { continue; }
+				for (int k = 0; k < 3; k++) { m[k] /= m_length; }
+
+				double m_d = -((m[0] * a.x) + (m[1] * a.y) + (m[2] * a.z));
+				double t_length_squared = (t[0] * t[0]) + (t[1] * t[1]) + (t[2] * t[2]);
+				mp_mesh_quadric_add_plane(&quadric, m[0], m[1], m[2], m_d,
+					t_length_squared * MP_MESH_SIMPLIFY_BOUNDARY_WEIGHT);
+			}
+		}
+
+		simplifier->quadrics[i] = quadric;
+		simplifier->is_boundary[i] = is_boundary;
+	}
+}
+
+void mp_mesh_simplifier_seed_heap(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier)
+{
+	// One collapse per undirected edge, from the half with the lower index when paired:
+	mp_mesh_collapse_t *heap = simplifier->heap;
+	uint32_t num_corners = simplifier->num_faces * 3;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		uint32_t face = i / 3;
+		uint32_t from = simplifier->indices[(face * simplifier->stride) + (i % 3)];
+		uint32_t to = simplifier->indices[(face * simplifier->stride) + ((i + 1) % 3)];
+		uint32_t edge = simplifier->twins ? i :
+			((mp_mesh_simplifier_get_mesh_face(simplifier, face) * 3) + (i % 3));
+		int64_t other_half = mp_mesh_simplifier_get_other_half(mesh, simplifier, i);
+		if (((other_half >= 0) && (other_half < edge)) || (from == to)) { heap[i].error = INFINITY; }
+		else { heap[i] = mp_mesh_simplifier_get_collapse(mesh, simplifier, from, to); }
+	}
+
+	mp_mesh_collapse_heap_build(simplifier, num_corners);
+}
+
+int mp_mesh_simplifier_run(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+				mp_mesh_lod_target_t target, float *error)
+{
+	// Faces at locked vertices can't all go, so only the rest count:
+	while (((simplifier->num_live_faces - simplifier->num_locked_faces) > target.target_faces) &&
+		simplifier->heap_count)
+	{
+		mp_mesh_collapse_t collapse = simplifier->heap[0];
+		if ((simplifier->collapsed_to[collapse.from] != collapse.from) ||
+			(simplifier->collapsed_to[collapse.to] != collapse.to) ||
+			(simplifier->versions[collapse.from] != collapse.from_version) ||
+			(simplifier->versions[collapse.to] != collapse.to_version))
+		{
+			mp_mesh_collapse_heap_pop(simplifier);
+			continue;
+		}
+
+		// Left on the heap, as the next level may allow it:
+		if ((target.target_error > 0.0f) && (collapse.error > target.target_error)) { break; }
+
+		mp_mesh_collapse_heap_pop(simplifier);
+		if (!mp_mesh_simplifier_is_collapse_valid(mesh, simplifier, collapse.from, collapse.to))
+		{
+			continue;
+		}
+
+		mp_mesh_simplifier_collapse(simplifier, collapse.from, collapse.to);
+		if (collapse.error > *error) { *error = collapse.error; }
+		if (mp_mesh_simplifier_push_neighbours(mesh, simplifier, collapse.to)) { return -1; }
+	}
+	return 0;
+}
+
+uint32_t mp_mesh_simplifier_find(mp_mesh_simplifier_t *simplifier, uint32_t vertex)
+{
+	uint32_t root = vertex;
+	while (simplifier->collapsed_to[root] != root) { root = simplifier->collapsed_to[root]; }
+
+	// Point the whole path at the root, so later lookups take one step:
+	while (simplifier->collapsed_to[vertex] != root)
+	{
+		uint32_t next = simplifier->collapsed_to[vertex];
+		simplifier->collapsed_to[vertex] = root;
+		vertex = next;
+	}
+	return root;
+}
+
+uint8_t mp_mesh_simplifier_is_collapse_valid(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+							uint32_t from, uint32_t to)
+{
+	// Boundary vertices may only move along the boundary:
+	if (simplifier->is_boundary[from] && !simplifier->is_boundary[to]) { return 0; }
+	if (simplifier->is_locked && (simplifier->is_locked[from] || simplifier->is_locked[to]))
+	{
+		return 0;
+	}
+
+	if (simplifier->mark >= (UINT32_MAX - 2))
+	{
+		memset(simplifier->marks, 0, simplifier->num_vertices * sizeof(uint32_t));
+		simplifier->mark = 0;
+	}
+	simplifier->mark += 2;
+	uint32_t neighbour_mark = simplifier->mark;
+	uint32_t shared_mark = simplifier->mark + 1;
+
+	/* Mark the neighbours of "from", count the faces it shares with "to", and check the faces
+	 * that would move for flipped or degenerate normals: */
+	mp_position_t target = mp_mesh_simplifier_get_position(mesh, simplifier, to);
+	uint32_t num_shared_faces = 0;
+	uint32_t member = from;
+	do
+	{
+		uint32_t face;
+		mp_mesh_adjacency_iterator_t it = mp_mesh_vertex_faces_begin(
+						&(simplifier->vertex_faces), member);
+		while (mp_mesh_adjacency_iterator_next(&it, &face))
+		{
+			if (!simplifier->is_live_face[face]) { continue; }
+
+			uint32_t corners[3];
+			uint8_t has_to = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				corners[i] = mp_mesh_simplifier_find(simplifier,
+						simplifier->indices[(face * simplifier->stride) + i]);
+				if (corners[i] == to) { has_to = 1; }
+				else if (corners[i] != from) { simplifier->marks[corners[i]] = neighbour_mark; }
+			}
+			if (has_to)
+			{
+				num_shared_faces++;
+				continue;
+			}
+
+			mp_position_t before[3], after[3];
+			for (int i = 0; i < 3; i++)
+			{
+				before[i] = mp_mesh_simplifier_get_position(mesh, simplifier, corners[i]);
+				after[i] = (corners[i] == from) ? target : before[i];
+			}
+			double u0[3] = { before[1].x - before[0].x, before[1].y - before[0].y,
+						before[1].z - before[0].z };
+			double v0[3] = { before[2].x - before[0].x, before[2].y - before[0].y,
+						before[2].z - before[0].z };
+			double u1[3] = { after[1].x - after[0].x, after[1].y - after[0].y,
+						after[1].z - after[0].z };
+			double v1[3] = { after[2].x - after[0].x, after[2].y - after[0].y,
+						after[2].z - after[0].z };
+			double n0[3] = { (u0[1] * v0[2]) - (u0[2] * v0[1]),
+				(u0[2] * v0[0]) - (u0[0] * v0[2]), (u0[0] * v0[1]) - (u0[1] * v0[0]) };
+			double n1[3] = { (u1[1] * v1[2]) - (u1[2] * v1[1]),
+				(u1[2] * v1[0]) - (u1[0] * v1[2]), (u1[0] * v1[1]) - (u1[1] * v1[0]) };
+			double length0 = sqrt((n0[0] * n0[0]) + (n0[1] * n0[1]) + (n0[2] * n0[2]));
+			double length1 = sqrt((n1[0] * n1[0]) + (n1[1] * n1[1]) + (n1[2] * n1[2]));
+			if (length0 == 0.0) { continue; }
+			if (length1 == 0.0) { return 0; }
+
+			double dot = (n0[0] * n1[0]) + (n0[1] * n1[1]) + (n0[2] * n1[2]);
+			if (dot < (MP_MESH_SIMPLIFY_MIN_NORMAL_DOT * length0 * length1)) { return 0; }
+		}
+		member = simplifier->next_member[member];
+	} while (member != from);
+
+	// The edge may already be gone, and boundary vertices may not cross the interior:
+	if (!num_shared_faces) { return 0; }
+	if (simplifier->is_boundary[from] && (num_shared_faces != 1)) { return 0; }
+
+	/* Link condition: the vertices next to both ends must be exactly the far corners of the
+	 * shared faces, or the collapse would pinch the surface: */
+	uint32_t num_shared_neighbours = 0;
+	member = to;
+	do
+	{
+		uint32_t face;
+		mp_mesh_adjacency_iterator_t it = mp_mesh_vertex_faces_begin(
+						&(simplifier->vertex_faces), member);
+		while (mp_mesh_adjacency_iterator_next(&it, &face))
+		{
+			if (!simplifier->is_live_face[face]) { continue; }
+			for (int i = 0; i < 3; i++)
+			{
+				uint32_t corner = mp_mesh_simplifier_find(simplifier,
+						simplifier->indices[(face * simplifier->stride) + i]);
+				if (simplifier->marks[corner] != neighbour_mark) { continue; }
+				simplifier->marks[corner] = shared_mark;
+				num_shared_neighbours++;
+			}
+		}
+		member = simplifier->next_member[member];
+	} while (member != to);
+
+	return (num_shared_neighbours == num_shared_faces);
+}
+
+void mp_mesh_simplifier_collapse(mp_mesh_simplifier_t *simplifier, uint32_t from, uint32_t to)
+{
+	// Faces holding both vertices become degenerate:
+	uint32_t member = from;
+	do
+	{
+		uint32_t face;
+		mp_mesh_adjacency_iterator_t it = mp_mesh_vertex_faces_begin(
+						&(simplifier->vertex_faces), member);
+		while (mp_mesh_adjacency_iterator_next(&it, &face))
+		{
+			if (!simplifier->is_live_face[face]) { continue; }
+
+			uint32_t corners[3];
+			uint8_t has_to = 0;
+			uint8_t is_locked = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				corners[i] = mp_mesh_simplifier_find(simplifier,
+						simplifier->indices[(face * simplifier->stride) + i]);
+				if (corners[i] == to) { has_to = 1; }
+				if (simplifier->is_locked && simplifier->is_locked[corners[i]]) { is_locked = 1; }
+			}
+			if (!has_to) { continue; }
+
+			simplifier->is_live_face[face] = 0;
+			simplifier->num_live_faces--;
+			if (is_locked) { simplifier->num_locked_faces--; }
+		}
+		member = simplifier->next_member[member];
+	} while (member != from);
+
+	// Swapping successors joins the two circular member lists:
+	simplifier->collapsed_to[from] = to;
+	uint32_t next = simplifier->next_member[from];
+	simplifier->next_member[from] = simplifier->next_member[to];
+	simplifier->next_member[to] = next;
+
+	mp_mesh_quadric_add(&(simplifier->quadrics[to]), &(simplifier->quadrics[from]));
+	simplifier->versions[to]++;
+}
+
+int mp_mesh_simplifier_push_neighbours(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+									uint32_t vertex)
+{
+	if (simplifier->mark >= (UINT32_MAX - 2))
+	{
+		memset(simplifier->marks, 0, simplifier->num_vertices * sizeof(uint32_t));
+		simplifier->mark = 0;
+	}
+	simplifier->mark += 2;
+
+	// The vertex quadric changed, so every edge around it gets a fresh collapse:
+	uint32_t member = vertex;
+	do
+	{
+		uint32_t face;
+		mp_mesh_adjacency_iterator_t it = mp_mesh_vertex_faces_begin(
+						&(simplifier->vertex_faces), member);
+		while (mp_mesh_adjacency_iterator_next(&it, &face))
+		{
+			if (!simplifier->is_live_face[face]) { continue; }
+			for (int i = 0; i < 3; i++)
+			{
+				uint32_t corner = mp_mesh_simplifier_find(simplifier,
+						simplifier->indices[(face * simplifier->stride) + i]);
+				if (corner == vertex) { continue; }
+				if (simplifier->marks[corner] == simplifier->mark) { continue; }
+				simplifier->marks[corner] = simplifier->mark;
+
+				mp_mesh_collapse_t collapse = mp_mesh_simplifier_get_collapse(mesh, simplifier,
+										vertex, corner);
+				if (collapse.error == INFINITY) { continue; }
+				if (mp_mesh_collapse_heap_push(simplifier, collapse)) { return -1; }
+			}
+		}
+		member = simplifier->next_member[member];
+	} while (member != vertex);
+
+	return 0;
+}
+
+mp_mesh_collapse_t mp_mesh_simplifier_get_collapse(mp_mesh_t *mesh,
+		mp_mesh_simplifier_t *simplifier, uint32_t a, uint32_t b)
+{
+	mp_mesh_quadric_t quadric = simplifier->quadrics[a];
+	mp_mesh_quadric_add(&quadric, &(simplifier->quadrics[b]));
+	double weight = (quadric.weight > DBL_MIN) ? quadric.weight : DBL_MIN;
+
+	// Vertices stay in place, so the cheaper direction of the two wins:
+	mp_mesh_collapse_t collapse;
+	collapse.error = INFINITY;
+	if (simplifier->is_locked && (simplifier->is_locked[a] || simplifier->is_locked[b]))
+	{
+		return collapse;
+	}
+
+	uint32_t ends[2] = { a, b };
+	for (int i = 0; i < 2; i++)
+	{
+		uint32_t from = ends[i];
+		uint32_t to = ends[1 - i];
+		if (simplifier->is_boundary[from] && !simplifier->is_boundary[to]) { continue; }
+
+		double squared = mp_mesh_quadric_evaluate(&quadric,
+				mp_mesh_simplifier_get_position(mesh, simplifier, to)) / weight;
+		float error = (float)(sqrt(squared) * simplifier->inverse_diagonal);
+		if (error >= collapse.error) { continue; }
+
+		collapse.error = error;
+		collapse.from = from;
+		collapse.to = to;
+		collapse.from_version = simplifier->versions[from];
+		collapse.to_version = simplifier->versions[to];
+	}
+	return collapse;
+}
+
+void mp_mesh_simplifier_reset(mp_mesh_simplifier_t *simplifier, const mp_mesh_quadric_t *quadrics)
+{
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < simplifier->num_vertices; i++)
+	{
+		simplifier->collapsed_to[i] = i;
+		simplifier->next_member[i] = i;
+		simplifier->versions[i] = 0;
+		simplifier->quadrics[i] = quadrics[i];
+	}
+	memset(simplifier->is_live_face, 1, simplifier->num_faces);
+	simplifier->num_live_faces = simplifier->num_faces;
+	simplifier->heap_count = 0;
+}
+
+void mp_mesh_simplifier_apply_cluster(mp_mesh_simplifier_t *simplifier,
+					mp_mesh_simplifier_t *cluster)
+{
+	/* Copies a cluster's collapses into the whole mesh simplifier. Only unlocked vertices can
+	 * collapse, and only the cluster uses them, so clusters can be applied in parallel: */
+	for (uint32_t i = 0; i < cluster->num_vertices; i++)
+	{
+		if (cluster->is_locked[i]) { continue; }
+
+		uint32_t vertex = cluster->vertex_map[i];
+		uint32_t root = mp_mesh_simplifier_find(cluster, i);
+		simplifier->collapsed_to[vertex] = cluster->vertex_map[root];
+		simplifier->next_member[vertex] = cluster->vertex_map[cluster->next_member[i]];
+		simplifier->quadrics[vertex] = cluster->quadrics[i];
+	}
+
+	for (uint32_t i = 0; i < cluster->num_faces; i++)
+	{
+		simplifier->is_live_face[cluster->face_map[i]] = cluster->is_live_face[i];
+	}
+}
+
+void mp_mesh_simplifier_seed_heap_shared(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+						const uint32_t *vertex_owners)
+{
+	/* Edges of live faces at shared vertices, which clusters left alone. Collapsed vertices
+	 * point straight at their root after applying clusters: */
+	mp_mesh_collapse_t *heap = simplifier->heap;
+	uint32_t num_corners = simplifier->num_faces * 3;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_corners; i++)
+	{
+		uint32_t face = i / 3;
+		heap[i].error = INFINITY;
+		if (!simplifier->is_live_face[face]) { continue; }
+
+		const uint32_t *corners = simplifier->indices + (face * simplifier->stride);
+		uint32_t from = simplifier->collapsed_to[corners[i % 3]];
+		uint32_t to = simplifier->collapsed_to[corners[(i + 1) % 3]];
+		if ((vertex_owners[from] != MP_MESH_SIMPLIFY_SHARED_VERTEX) &&
+			(vertex_owners[to] != MP_MESH_SIMPLIFY_SHARED_VERTEX)) { continue; }
+		heap[i] = mp_mesh_simplifier_get_collapse(mesh, simplifier, from, to);
+	}
+
+	mp_mesh_collapse_heap_build(simplifier, num_corners);
+}
+
+int mp_mesh_simplifier_write_level(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier, uint8_t lod,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	mp_mesh_free_level(mesh, lod);
+
+	// Only indices are stored per level, with every level sharing the vertex arrays:
+	uint32_t num_faces = simplifier->num_live_faces;
+	size_t size = (size_t)num_faces * 3 * sizeof(uint32_t);
+	uint8_t is_soa = mp_mesh_is_soa(mesh);
+	uint8_t failed;
+	if (is_soa)
+	{
+		mesh->soa.p[lod] = mp_mesh_allocate_block(mesh, size);
+		mesh->soa.n[lod] = mp_mesh_allocate_block(mesh, size);
+		mesh->soa.c[lod] = mp_mesh_allocate_block(mesh, size);
+		mesh->soa.u[lod] = mp_mesh_allocate_block(mesh, size);
+		failed = (!mesh->soa.p[lod] || !mesh->soa.n[lod] || !mesh->soa.c[lod] || !mesh->soa.u[lod]);
+	}
+	else
+	{
+		mesh->faces[lod] = mp_mesh_allocate_block(mesh, num_faces * sizeof(mp_face_t));
+		failed = !mesh->faces[lod];
+	}
+	if (failed)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for LOD level %u of mesh \"%s\".", lod, mesh->name);
+		mp_mesh_free_level(mesh, lod);
+		return -1;
+	}
+	mesh->num_faces[lod] = num_faces;
+
+	// Live faces keep their base level order and attribute indices:
+	uint32_t next_face = 0;
+	for (uint32_t i = 0; i < simplifier->num_faces; i++)
+	{
+		if (!simplifier->is_live_face[i]) { continue; }
+
+		mp_face_t face = mp_mesh_get_face(mesh, 0, i);
+		for (int j = 0; j < 3; j++) { face.p[j] = mp_mesh_simplifier_find(simplifier, face.p[j]); }
+
+		if (!is_soa)
+		{
+			mesh->faces[lod][next_face++] = face;
+			continue;
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			mesh->soa.p[lod][(next_face * 3) + j] = face.p[j];
+			mesh->soa.n[lod][(next_face * 3) + j] = face.n[j];
+			mesh->soa.c[lod][(next_face * 3) + j] = face.c[j];
+			mesh->soa.u[lod][(next_face * 3) + j] = face.u[j];
+		}
+		next_face++;
+	}
+
+	return 0;
+}
+
+void mp_mesh_collapse_heap_build(mp_mesh_simplifier_t *simplifier, uint32_t count)
+{
+	// Keeps the possible collapses among the first "count" entries, then heapifies them:
+	mp_mesh_collapse_t *heap = simplifier->heap;
+	uint32_t num_collapses = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (heap[i].error != INFINITY) { heap[num_collapses++] = heap[i]; }
+	}
+	simplifier->heap_count = num_collapses;
+
+	for (uint32_t i = num_collapses / 2; i > 0; i--)
+	{
+		mp_mesh_collapse_heap_sift_down(heap, num_collapses, i - 1);
+	}
+}
+
+int mp_mesh_collapse_heap_push(mp_mesh_simplifier_t *simplifier, mp_mesh_collapse_t collapse)
+{
+	if (simplifier->heap_count == simplifier->heap_capacity)
+	{
+		uint32_t capacity = simplifier->heap_capacity * 2;
+		mp_mesh_collapse_t *heap = realloc(simplifier->heap, capacity * sizeof(mp_mesh_collapse_t));
+		if (!heap) { return -1; }
+		simplifier->heap = heap;
+		simplifier->heap_capacity = capacity;
+	}
+
+	mp_mesh_collapse_t *heap = simplifier->heap;
+	uint32_t index = simplifier->heap_count++;
+	while (index > 0)
+	{
+		uint32_t parent = (index - 1) / 2;
+		if (heap[parent].error <= collapse.error) { break; }
+		heap[index] = heap[parent];
+		index = parent;
+	}
+	heap[index] = collapse;
+	return 0;
+}
+
+void mp_mesh_collapse_heap_pop(mp_mesh_simplifier_t *simplifier)
+{
+	if (!simplifier->heap_count) { return; }
+	simplifier->heap_count--;
+	simplifier->heap[0] = simplifier->heap[simplifier->heap_count];
+	mp_mesh_collapse_heap_sift_down(simplifier->heap, simplifier->heap_count, 0);
+}
+
+void mp_mesh_collapse_heap_sift_down(mp_mesh_collapse_t *heap, uint32_t count, uint32_t index)
+{
+	if (index >= count) { return; }
+
+	mp_mesh_collapse_t collapse = heap[index];
+	while (1)
+	{
+		uint32_t child = (index * 2) + 1;
+		if (child >= count) { break; }
+		if (((child + 1) < count) && (heap[child + 1].error < heap[child].error)) { child++; }
+		if (heap[child].error >= collapse.error) { break; }
+		heap[index] = heap[child];
+		index = child;
+	}
+	heap[index] = collapse;
+}
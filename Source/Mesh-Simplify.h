@@ -0,0 +1,204 @@
+#ifndef MP_MESH_SIMPLIFY_H
+#define MP_MESH_SIMPLIFY_H
+
+#include <NM-Config/Config.h>
+
+#include <math.h>
+
+#include "Mesh.h"
+#include "Mesh-Adjacency.h"
+#include "Mesh-Reorder.h"
+
+// Boundary edge planes are weighted this much more than face planes, so borders hold their shape:
+#define MP_MESH_SIMPLIFY_BOUNDARY_WEIGHT	10.0
+
+// Faces per cluster in parallel simplification, each simplified on its own thread:
+#define MP_MESH_SIMPLIFY_CLUSTER_SIZE		(1 << 16)
+
+// Owner of a vertex used by more than one cluster:
+#define MP_MESH_SIMPLIFY_SHARED_VERTEX		(UINT32_MAX - 1)
+
+// Faces whose normal would turn by more than about 85 degrees block a collapse:
+#define MP_MESH_SIMPLIFY_MIN_NORMAL_DOT		0.1
+
+/* Stopping condition for one level. Each level continues from the one before, stopping when it
+ * has at most target_faces faces, or before a collapse would exceed target_error. Error is the
+ * root mean square distance to the original planes around a vertex, relative to the bounds
+ * diagonal. Leave either at 0 for no limit: */
+typedef struct
+{
+	uint32_t target_faces;
+	float target_error;
+} mp_mesh_lod_target_t;
+
+typedef struct
+{
+	uint32_t num_faces[NM_MAX_LOD_LEVELS];
+	float errors[NM_MAX_LOD_LEVELS];	// Largest collapse error up to each level.
+} mp_mesh_lod_report_t;
+
+// Symmetric plane quadric (A, b, c) with x^T A x + 2 b.x + c, and the summed plane weight:
+typedef struct
+{
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double weight;
+} mp_mesh_quadric_t;
+
+// Heap entry for a half-edge collapse, moving "from" onto "to":
+typedef struct
+{
+	float error;
+	uint32_t from;
+	uint32_t to;
+	uint32_t from_version;
+	uint32_t to_version;
+} mp_mesh_collapse_t;
+
+/* State of a running simplification, over the base level or one cluster of it. Collapsed
+ * vertices point at the vertex that absorbed them, and the members of each surviving vertex form
+ * a circular list, so its faces are the live faces of its members. Heap entries are invalidated
+ * lazily, by comparing vertex versions when they come off the heap.
+ *
+ * A cluster numbers its own vertices and faces from 0, with maps back to the mesh. Vertices it
+ * shares with other clusters are locked, so every collapse stays inside the cluster. Clusters of
+ * triangles no longer in the mesh find their boundaries by pairing edges among themselves: */
+typedef struct
+{
+	const uint32_t *indices;
+	uint32_t stride;
+	uint32_t num_faces;
+	uint32_t num_live_faces;
+	uint8_t *is_live_face;
+
+	uint32_t num_vertices;
+	uint32_t *collapsed_to;
+	uint32_t *next_member;
+	uint32_t *versions;
+	uint32_t *marks;
+	uint32_t mark;
+	uint8_t *is_boundary;
+	mp_mesh_quadric_t *quadrics;
+	mp_mesh_vertex_faces_t vertex_faces;
+	double inverse_diagonal;
+
+	uint32_t *cluster_indices;	// Clusters only, three per face.
+	uint32_t *vertex_map;		// Clusters only, mesh vertex of each vertex.
+	const uint32_t *face_map;	// Clusters only, mesh face of each face.
+	uint8_t *is_locked;		// Clusters only, vertices that may not move or be moved onto.
+	uint32_t num_locked_faces;	// Live faces at locked vertices, left out of face targets.
+	uint32_t *twins;		// Clusters with their own triangles only, other half of each corner.
+
+	mp_mesh_collapse_t *heap;
+	uint32_t heap_count;
+	uint32_t heap_capacity;
+} mp_mesh_simplifier_t;
+
+int mp_mesh_generate_lods(mp_mesh_t *mesh, const mp_mesh_lod_target_t *targets, uint8_t num_levels,
+			mp_mesh_lod_report_t *report, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_generate_lods_parallel(mp_mesh_t *mesh, const mp_mesh_lod_target_t *targets,
+	uint8_t num_levels, mp_mesh_lod_report_t *report, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_check_lod_arguments(mp_mesh_t *mesh, uint8_t num_levels,
+				char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_simplifier_init(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_simplifier_init_cluster(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+		const uint32_t *faces, const uint32_t *indices, uint32_t num_faces,
+		const uint32_t *vertex_owners, double inverse_diagonal);
+int mp_mesh_simplifier_allocate(mp_mesh_simplifier_t *simplifier, uint32_t heap_capacity);
+void mp_mesh_simplifier_free(mp_mesh_simplifier_t *simplifier);
+void mp_mesh_simplifier_calculate_quadrics(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier);
+void mp_mesh_simplifier_seed_heap(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier);
+int mp_mesh_simplifier_run(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+				mp_mesh_lod_target_t target, float *error);
+uint32_t mp_mesh_simplifier_find(mp_mesh_simplifier_t *simplifier, uint32_t vertex);
+uint8_t mp_mesh_simplifier_is_collapse_valid(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+							uint32_t from, uint32_t to);
+void mp_mesh_simplifier_collapse(mp_mesh_simplifier_t *simplifier, uint32_t from, uint32_t to);
+int mp_mesh_simplifier_push_neighbours(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+									uint32_t vertex);
+mp_mesh_collapse_t mp_mesh_simplifier_get_collapse(mp_mesh_t *mesh,
+		mp_mesh_simplifier_t *simplifier, uint32_t a, uint32_t b);
+void mp_mesh_simplifier_reset(mp_mesh_simplifier_t *simplifier, const mp_mesh_quadric_t *quadrics);
+void mp_mesh_simplifier_apply_cluster(mp_mesh_simplifier_t *simplifier,
+					mp_mesh_simplifier_t *cluster);
+void mp_mesh_simplifier_seed_heap_shared(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier,
+						const uint32_t *vertex_owners);
+int mp_mesh_simplifier_write_level(mp_mesh_t *mesh, mp_mesh_simplifier_t *simplifier, uint8_t lod,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_collapse_heap_build(mp_mesh_simplifier_t *simplifier, uint32_t count);
+int mp_mesh_collapse_heap_push(mp_mesh_simplifier_t *simplifier, mp_mesh_collapse_t collapse);
+void mp_mesh_collapse_heap_pop(mp_mesh_simplifier_t *simplifier);
+void mp_mesh_collapse_heap_sift_down(mp_mesh_collapse_t *heap, uint32_t count, uint32_t index);
+
+static inline mp_position_t mp_mesh_simplifier_get_position(mp_mesh_t *mesh,
+					const mp_mesh_simplifier_t *simplifier, uint32_t vertex)
+{
+	if (simplifier->vertex_map) { vertex = simplifier->vertex_map[vertex]; }
+	return mp_mesh_get_position(mesh, vertex);
+}
+
+static inline uint32_t mp_mesh_simplifier_get_mesh_face(const mp_mesh_simplifier_t *simplifier,
+										uint32_t face)
+{
+	return simplifier->face_map ? simplifier->face_map[face] : face;
+}
+
+// Other half of the edge leaving a face corner, or -1 on a boundary:
+static inline int64_t mp_mesh_simplifier_get_other_half(mp_mesh_t *mesh,
+				const mp_mesh_simplifier_t *simplifier, uint32_t corner)
+{
+	if (simplifier->twins)
+	{
+		return (simplifier->twins[corner] == MP_EDGE_NONE) ? -1 : (int64_t)simplifier->twins[corner];
+	}
+	uint32_t face = mp_mesh_simplifier_get_mesh_face(simplifier, corner / 3);
+	return mp_mesh_get_edge_other_half(mesh, (face * 3) + (corner % 3));
+}
+
+static inline void mp_mesh_quadric_add_plane(mp_mesh_quadric_t *quadric, double x, double y,
+						double z, double d, double weight)
+{
+	quadric->a00 += weight * x * x;
+	quadric->a01 += weight * x * y;
+	quadric->a02 += weight * x * z;
+	quadric->a11 += weight * y * y;
+	quadric->a12 += weight * y * z;
+	quadric->a22 += weight * z * z;
+	quadric->b0 += weight * x * d;
+	quadric->b1 += weight * y * d;
+	quadric->b2 += weight * z * d;
+	quadric->c += weight * d * d;
+	quadric->weight += weight;
+}
+
+static inline void mp_mesh_quadric_add(mp_mesh_quadric_t *quadric, const mp_mesh_quadric_t *other)
+{
+	quadric->a00 += other->a00;
+	quadric->a01 += other->a01;
+	quadric->a02 += other->a02;
+	quadric->a11 += other->a11;
+	quadric->a12 += other->a12;
+	quadric->a22 += other->a22;
+	quadric->b0 += other->b0;
+	quadric->b1 += other->b1;
+	quadric->b2 += other->b2;
+	quadric->c += other->c;
+	quadric->weight += other->weight;
+}
+
+// Weighted sum of squared plane distances:
+static inline double mp_mesh_quadric_evaluate(const mp_mesh_quadric_t *quadric,
+							mp_position_t position)
+{
+	double x = position.x;
+	double y = position.y;
+	double z = position.z;
+	double result = (quadric->a00 * x * x) + (quadric->a11 * y * y) + (quadric->a22 * z * z) +
+		2.0 * ((quadric->a01 * x * y) + (quadric->a02 * x * z) + (quadric->a12 * y * z)) +
+		2.0 * ((quadric->b0 * x) + (quadric->b1 * y) + (quadric->b2 * z)) + quadric->c;
+	return (result > 0.0) ? result : 0.0;
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include "Mesh-Vertex-Cache.h"
+
+int mp_mesh_optimise_vertex_cache(mp_mesh_t *mesh, uint8_t lod, uint32_t cache_size,
+		mp_mesh_vertex_cache_report_t *report, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	uint32_t num_faces = mesh->num_faces[lod];
+	uint32_t *new_to_old = NULL;
+	uint32_t *old_to_new = NULL;
+	mp_mesh_vertex_faces_t vertex_faces;
+	memset(&vertex_faces, 0, sizeof(vertex_faces));
+
+	if (report && mp_mesh_measure_vertex_cache(mesh, lod, cache_size, &(report->acmr_before),
+								&(report->atvr_before)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex cache simulation on mesh \"%s\".",
+			mesh->name);
+		return -1;
+	}
+
+	if (mp_mesh_build_vertex_faces(mesh, lod, &vertex_faces, error_message)) { return -1; }
+
+	new_to_old = malloc(((size_t)num_faces + 1) * sizeof(uint32_t));
+	old_to_new = malloc(((size_t)num_faces + 1) * sizeof(uint32_t));
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, lod, &stride);
+	if (!new_to_old || !old_to_new ||
+		mp_mesh_tipsify(indices, stride, num_faces, &vertex_faces, cache_size, new_to_old))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex cache optimisation on mesh \"%s\".",
+			mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_faces; i++) { old_to_new[new_to_old[i]] = i; }
+
+	if (mp_mesh_remap_faces(mesh, lod, new_to_old, old_to_new, error_message))
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	if (report && mp_mesh_measure_vertex_cache(mesh, lod, cache_size, &(report->acmr_after),
+								&(report->atvr_after)))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex cache simulation on mesh \"%s\".",
+			mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	cleanup:
+	mp_mesh_vertex_faces_free(&vertex_faces);
+	if (new_to_old) { free(new_to_old); }
+	if (old_to_new) { free(old_to_new); }
+	return return_value;
+}
+
+int mp_mesh_optimise_vertex_fetch(mp_mesh_t *mesh, uint8_t lod,
+					char error_message[NM_MAX_ERROR_LENGTH])
+{
+	uint32_t *new_to_old = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint32_t));
+	uint32_t *old_to_new = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint32_t));
+	if (!new_to_old || !old_to_new)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex fetch optimisation on mesh \"%s\".",
+			mesh->name);
+		if (new_to_old) { free(new_to_old); }
+		if (old_to_new) { free(old_to_new); }
+		return -1;
+	}
+
+	/* Number vertices in order of first use by the faces. Vertices the level doesn't use keep
+	 * their relative order after the rest: */
+	uint32_t next_vertex = 0;
+	memset(old_to_new, 0xff, mesh->num_vertices * sizeof(uint32_t));
+	for (uint32_t i = 0; i < mesh->num_faces[lod]; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t vertex = mp_mesh_get_face_vertex(mesh, lod, i, j);
+			if (old_to_new[vertex] != UINT32_MAX) { continue; }
+			old_to_new[vertex] = next_vertex;
+			new_to_old[next_vertex++] = vertex;
+		}
+	}
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		if (old_to_new[i] != UINT32_MAX) { continue; }
+		old_to_new[i] = next_vertex;
+		new_to_old[next_vertex++] = i;
+	}
+
+	int return_value = mp_mesh_remap_vertices(mesh, new_to_old, old_to_new, error_message);
+	free(new_to_old);
+	free(old_to_new);
+	return return_value;
+}
+
+int mp_mesh_tipsify(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+		const mp_mesh_vertex_faces_t *vertex_faces, uint32_t cache_size, uint32_t *order)
+{
+	/* Tipsify (Sander, Nehab and Barczak, "Fast triangle reordering for vertex locality and
+	 * reduced overdraw", 2007). Emits all remaining faces around a fanning vertex, then moves
+	 * to the vertex among those just used that will stay in the cache longest. Linear time: */
+	uint32_t num_vertices = vertex_faces->num_vertices;
+	uint32_t max_degree = 0;
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		uint32_t degree = mp_mesh_vertex_faces_get_degree(vertex_faces, i);
+		if (degree > max_degree) { max_degree = degree; }
+	}
+
+	uint32_t *live_faces = malloc(((size_t)num_vertices + 1) * sizeof(uint32_t));
+	uint32_t *cache_times = calloc((size_t)num_vertices + 1, sizeof(uint32_t));
+	uint8_t *is_emitted = calloc((size_t)num_faces + 1, sizeof(uint8_t));
+	uint32_t *dead_ends = malloc(((size_t)num_faces * 3 + 1) * sizeof(uint32_t));
+	uint32_t *candidates = malloc(((size_t)max_degree * 3 + 1) * sizeof(uint32_t));
+	int return_value = 0;
+	if (!live_faces || !cache_times || !is_emitted || !dead_ends || !candidates)
+	{
+		return_value = -1;
+		goto cleanup;
+	}
+
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		live_faces[i] = mp_mesh_vertex_faces_get_degree(vertex_faces, i);
+	}
+
+	uint32_t num_emitted = 0;
+	uint32_t num_dead_ends = 0;
+	uint32_t time = cache_size + 1;
+	uint32_t cursor = 0;
+	int64_t fanning_vertex = (num_vertices > 0) ? 0 : -1;
+
+	while (fanning_vertex >= 0)
+	{
+		uint32_t num_candidates = 0;
+		mp_mesh_adjacency_iterator_t iterator = mp_mesh_vertex_faces_begin(vertex_faces,
+									(uint32_t)fanning_vertex);
+		uint32_t face;
+		while (mp_mesh_adjacency_iterator_next(&iterator, &face))
+		{
+			if (is_emitted[face]) { continue; }
+			is_emitted[face] = 1;
+			order[num_emitted++] = face;
+
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t vertex = indices[(face * stride) + j];
+				dead_ends[num_dead_ends++] = vertex;
+				candidates[num_candidates++] = vertex;
+				live_faces[vertex]--;
+				if ((time - cache_times[vertex]) > cache_size) { cache_times[vertex] = time++; }
+			}
+		}
+
+		// Prefer a candidate whose remaining faces fit before it leaves the cache:
+		fanning_vertex = -1;
+		int64_t best_priority = -1;
+		for (uint32_t i = 0; i < num_candidates; i++)
+		{
+			uint32_t vertex = candidates[i];
+			if (live_faces[vertex] == 0) { continue; }
+			int64_t priority = 0;
+			if (((time - cache_times[vertex]) + (2 * live_faces[vertex])) <= cache_size)
+			{
+				priority = time - cache_times[vertex];
+			}
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				fanning_vertex = vertex;
+			}
+		}
+
+		// Otherwise, back up to a recently used vertex, then scan on from the last pick:
+		while ((fanning_vertex < 0) && (num_dead_ends > 0))
+		{
+			uint32_t vertex = dead_ends[--num_dead_ends];
+			if (live_faces[vertex] > 0) { fanning_vertex = vertex; }
+		}
+		while ((fanning_vertex < 0) && (cursor < num_vertices))
+		{
+			if (live_faces[cursor] > 0) { fanning_vertex = cursor; }
+			cursor++;
+		}
+	}
+
+	cleanup:
+	if (live_faces) { free(live_faces); }
+	if (cache_times) { free(cache_times); }
+	if (is_emitted) { free(is_emitted); }
+	if (dead_ends) { free(dead_ends); }
+	if (candidates) { free(candidates); }
+	return return_value;
+}
+
+int mp_mesh_measure_vertex_cache(mp_mesh_t *mesh, uint8_t lod, uint32_t cache_size,
+							double *acmr, double *atvr)
+{
+	// A vertex is cached if fewer than cache_size misses happened since it was loaded:
+	uint64_t *load_times = malloc(((size_t)mesh->num_vertices + 1) * sizeof(uint64_t));
+	if (!load_times) { return -1; }
+	memset(load_times, 0, mesh->num_vertices * sizeof(uint64_t));
+
+	uint64_t misses = 0;
+	uint32_t num_used_vertices = 0;
+	for (uint32_t i = 0; i < mesh->num_faces[lod]; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t vertex = mp_mesh_get_face_vertex(mesh, lod, i, j);
+			if (load_times[vertex] == 0) { num_used_vertices++; }
+			else if ((misses - load_times[vertex]) < cache_size) { continue; }
+			misses++;
+			load_times[vertex] = misses;
+		}
+	}
+	free(load_times);
+
+	*acmr = mesh->num_faces[lod] ? ((double)misses / mesh->num_faces[lod]) : 0.0;
+	*atvr = num_used_vertices ? ((double)misses / num_used_vertices) : 0.0;
+	return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MP_MESH_VERTEX_CACHE_H
+#define MP_MESH_VERTEX_CACHE_H
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+#include "Mesh-Adjacency.h"
+#include "Mesh-Reorder.h"
+
+// A reasonable post-transform cache size when the target hardware is unknown:
+#define MP_MESH_VERTEX_CACHE_SIZE	16
+
+/* Average cache miss ratio (misses per face) and average transformed vertex ratio (misses per
+ * referenced vertex), simulated with a FIFO cache. Both are 0.5 and 1.0 at best: */
+typedef struct
+{
+	double acmr_before;
+	double acmr_after;
+	double atvr_before;
+	double atvr_after;
+} mp_mesh_vertex_cache_report_t;
+
+int mp_mesh_optimise_vertex_cache(mp_mesh_t *mesh, uint8_t lod, uint32_t cache_size,
+		mp_mesh_vertex_cache_report_t *report, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_optimise_vertex_fetch(mp_mesh_t *mesh, uint8_t lod,
+					char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_tipsify(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+		const mp_mesh_vertex_faces_t *vertex_faces, uint32_t cache_size, uint32_t *order);
+int mp_mesh_measure_vertex_cache(mp_mesh_t *mesh, uint8_t lod, uint32_t cache_size,
+							double *acmr, double *atvr);
+
+#endif
@@ -0,0 +1,338 @@
+#include "Mesh-Weld.h"
+#include "Sort.h"
+
+int mp_mesh_weld_vertices(mp_mesh_t *mesh, float epsilon, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	int return_value = 0;
+	uint32_t num_vertices = mesh->num_vertices;
+	uint32_t num_chunks = (num_vertices + MP_MESH_WELD_CHUNK_SIZE - 1) / MP_MESH_WELD_CHUNK_SIZE;
+	mesh->num_welded_vertices = 0;
+	if (epsilon < 0.0f) { epsilon = 0.0f; }
+
+	// Keep the load factor of the cell table at or below one half:
+	uint64_t capacity = 1;
+	while (capacity < ((uint64_t)num_vertices * 2)) { capacity <<= 1; }
+	uint64_t mask = capacity - 1;
+
+	uint64_t *sorted_keys = malloc(((size_t)num_vertices + 1) * sizeof(uint64_t));
+	uint32_t *sorted_vertices = malloc(((size_t)num_vertices + 1) * sizeof(uint32_t));
+	uint64_t *table_keys = malloc(capacity * sizeof(uint64_t));
+	uint32_t *table_values = malloc(capacity * sizeof(uint32_t));
+	uint32_t *representatives = malloc(((size_t)num_vertices + 1) * sizeof(uint32_t));
+	uint32_t *chunk_offsets = malloc(((size_t)num_chunks + 1) * sizeof(uint32_t));
+	if (!sorted_keys || !sorted_vertices || !table_keys || !table_values || !representatives ||
+		!chunk_offsets)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for welding vertices of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	/*********************************
+	 * Spatial hash grid of vertices *
+	 *********************************/
+
+	mp_position_t minimum, maximum;
+	mp_mesh_calculate_bounds(mesh, &minimum, &maximum);
+	double inverse_size = (epsilon > 0.0f) ? (0.5 / epsilon) : 0.0;
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		int64_t cell[3];
+		mp_mesh_weld_get_cell(mp_mesh_get_position(mesh, i), minimum, inverse_size, cell, NULL);
+		sorted_keys[i] = mp_mesh_weld_cell_hash(cell);
+		sorted_vertices[i] = i;
+	}
+
+	// Vertices of each cell become one run, found through the table by cell hash:
+	if (mp_sort_radix_u64(sorted_keys, sorted_vertices, num_vertices))
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for sorting vertices of mesh \"%s\".", mesh->name);
+		return_value = -1;
+		goto cleanup;
+	}
+
+	#pragma omp parallel for
+	for (uint64_t i = 0; i < capacity; i++)
+	{
+		table_keys[i] = MP_EDGE_HASH_EMPTY;
+		table_values[i] = MP_EDGE_NONE;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		if ((i > 0) && (sorted_keys[i] == sorted_keys[i - 1])) { continue; }
+
+		// Each run start inserts a different key, so the first free slot is kept:
+		uint64_t slot = mp_mesh_edge_hash(sorted_keys[i]) & mask;
+		while (1)
+		{
+			uint64_t expected = MP_EDGE_HASH_EMPTY;
+			if (__atomic_compare_exchange_n(&(table_keys[slot]), &expected, sorted_keys[i], 0,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			{
+				table_values[slot] = i;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	/********************
+	 * Merging vertices *
+	 ********************/
+
+	mp_mesh_weld_find_representatives(mesh, epsilon, minimum, sorted_keys, sorted_vertices,
+					table_keys, table_values, mask, representatives);
+
+	/* Every vertex now points at a lower or equal index in its set. Pointer jumping flattens the
+	 * forest, so each vertex points straight at the lowest vertex of its set: */
+	uint8_t changed = 1;
+	while (changed)
+	{
+		changed = 0;
+		#pragma omp parallel for reduction(|:changed)
+		for (uint32_t i = 0; i < num_vertices; i++)
+		{
+			uint32_t parent = __atomic_load_n(&(representatives[i]), __ATOMIC_RELAXED);
+			uint32_t grandparent = __atomic_load_n(&(representatives[parent]), __ATOMIC_RELAXED);
+			if (grandparent != parent)
+			{
+				__atomic_store_n(&(representatives[i]), grandparent, __ATOMIC_RELAXED);
+				changed = 1;
+			}
+		}
+	}
+
+	// Number the kept vertices in their original order, reusing the sort values:
+	uint32_t *new_indices = sorted_vertices;
+	#pragma omp parallel for
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t start = chunk * MP_MESH_WELD_CHUNK_SIZE;
+		uint32_t end = start + MP_MESH_WELD_CHUNK_SIZE;
+		if (end > num_vertices) { end = num_vertices; }
+		uint32_t count = 0;
+		for (uint32_t i = start; i < end; i++) { count += (representatives[i] == i); }
+		chunk_offsets[chunk] = count;
+	}
+	uint32_t num_kept = 0;
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t count = chunk_offsets[chunk];
+		chunk_offsets[chunk] = num_kept;
+		num_kept += count;
+	}
+
+	#pragma omp parallel for
+	for (uint32_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		uint32_t start = chunk * MP_MESH_WELD_CHUNK_SIZE;
+		uint32_t end = start + MP_MESH_WELD_CHUNK_SIZE;
+		if (end > num_vertices) { end = num_vertices; }
+		uint32_t new_index = chunk_offsets[chunk];
+		for (uint32_t i = start; i < end; i++)
+		{
+			if (representatives[i] == i) { new_indices[i] = new_index++; }
+		}
+	}
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_vertices; i++)
+	{
+		if (representatives[i] != i) { new_indices[i] = new_indices[representatives[i]]; }
+	}
+
+	/****************************
+	 * Compacting and remapping *
+	 ****************************/
+
+	// The cell table is no longer needed, and holds at least two positions per vertex:
+	if (mp_mesh_is_soa(mesh))
+	{
+		float *axes[3] = { mesh->soa.x, mesh->soa.y, mesh->soa.z };
+		float *scratch = (float *)table_keys;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			#pragma omp parallel for
+			for (uint32_t i = 0; i < num_vertices; i++)
+			{
+				if (representatives[i] == i) { scratch[new_indices[i]] = axes[axis][i]; }
+			}
+			memcpy(axes[axis], scratch, num_kept * sizeof(float));
+		}
+	}
+	else
+	{
+		mp_position_t *scratch = (mp_position_t *)table_keys;
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_vertices; i++)
+		{
+			if (representatives[i] == i) { scratch[new_indices[i]] = mesh->vertices[i]; }
+		}
+		memcpy(mesh->vertices, scratch, num_kept * sizeof(mp_position_t));
+	}
+
+	// Kept positions are unchanged, so their quantised values still decode within the bounds:
+	if (mesh->quantised.positions)
+	{
+		uint16_t *scratch = (uint16_t *)table_keys;
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < num_vertices; i++)
+		{
+			if (representatives[i] != i) { continue; }
+			memcpy(scratch + ((size_t)new_indices[i] * 3),
+				mesh->quantised.positions + ((size_t)i * 3), 3 * sizeof(uint16_t));
+		}
+		memcpy(mesh->quantised.positions, scratch, (size_t)num_kept * 3 * sizeof(uint16_t));
+	}
+
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		uint32_t stride;
+		uint32_t *indices = (uint32_t *)mp_mesh_get_position_indices(mesh, i, &stride);
+		if (!indices) { continue; }
+		if ((i > 0) && (indices == mp_mesh_get_position_indices(mesh, 0, &stride))) { continue; }
+
+		#pragma omp parallel for
+		for (uint32_t j = 0; j < mesh->num_faces[i]; j++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				indices[(j * stride) + k] = new_indices[indices[(j * stride) + k]];
+			}
+		}
+	}
+
+	mesh->num_welded_vertices = num_vertices - num_kept;
+	mesh->num_vertices = num_kept;
+
+	// Faces with two corners merged have no area, and would break edge pairing:
+	if (num_kept < num_vertices) { mp_mesh_weld_remove_degenerate_faces(mesh); }
+	if (!mesh->num_faces[0])
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Welding collapsed every face of mesh \"%s\".", mesh->name);
+		return_value = -1;
+	}
+
+	cleanup:
+	if (sorted_keys) { free(sorted_keys); }
+	if (sorted_vertices) { free(sorted_vertices); }
+	if (table_keys) { free(table_keys); }
+	if (table_values) { free(table_values); }
+	if (representatives) { free(representatives); }
+	if (chunk_offsets) { free(chunk_offsets); }
+	return return_value;
+}
+
+void mp_mesh_weld_find_representatives(mp_mesh_t *mesh, float epsilon, mp_position_t minimum,
+		const uint64_t *sorted_keys, const uint32_t *sorted_vertices,
+		const uint64_t *table_keys, const uint32_t *table_values, uint64_t mask,
+		uint32_t *representatives)
+{
+	double inverse_size = (epsilon > 0.0f) ? (0.5 / epsilon) : 0.0;
+	float epsilon_squared = epsilon * epsilon;
+
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++) { representatives[i] = i; }
+
+	/* Every pair within epsilon joins the same set, found in the vertex's own and up to seven
+	 * adjacent cells, so chains of close positions merge whatever their order. Each pair is
+	 * joined from its higher vertex only: */
+	#pragma omp parallel for schedule(dynamic, MP_MESH_WELD_CHUNK_SIZE)
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		mp_position_t position = mp_mesh_get_position(mesh, i);
+		int64_t cell[3];
+		int sides[3];
+		mp_mesh_weld_get_cell(position, minimum, inverse_size, cell, sides);
+
+		for (int neighbour_index = 0; neighbour_index < 8; neighbour_index++)
+		{
+			// Bit n of the index steps along axis n, skipping repeats when there are no sides:
+			if ((neighbour_index & 1) && !sides[0]) { continue; }
+			if ((neighbour_index & 2) && !sides[1]) { continue; }
+			if ((neighbour_index & 4) && !sides[2]) { continue; }
+			int64_t neighbour[3] = {
+				cell[0] + ((neighbour_index & 1) ? sides[0] : 0),
+				cell[1] + ((neighbour_index & 2) ? sides[1] : 0),
+				cell[2] + ((neighbour_index & 4) ? sides[2] : 0)
+			};
+			uint64_t key = mp_mesh_weld_cell_hash(neighbour);
+			uint32_t start = mp_mesh_edge_hash_find(table_keys, table_values, mask, key);
+			if (start == MP_EDGE_NONE) { continue; }
+
+			for (uint32_t j = start; (j < mesh->num_vertices) && (sorted_keys[j] == key); j++)
+			{
+				uint32_t other = sorted_vertices[j];
+				if (other >= i) { continue; }
+
+				// Cells sharing a hash share a run too, so distance is always checked:
+				mp_position_t other_position = mp_mesh_get_position(mesh, other);
+				float x = other_position.x - position.x;
+				float y = other_position.y - position.y;
+				float z = other_position.z - position.z;
+				if (((x * x) + (y * y) + (z * z)) <= epsilon_squared)
+				{
+					mp_mesh_weld_union(representatives, i, other);
+				}
+			}
+		}
+	}
+}
+
+uint32_t mp_mesh_weld_remove_degenerate_faces(mp_mesh_t *mesh)
+{
+	uint32_t num_removed = 0;
+	uint32_t base_stride;
+	const uint32_t *base_indices = mp_mesh_get_position_indices(mesh, 0, &base_stride);
+
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		uint32_t stride;
+		uint32_t *indices = (uint32_t *)mp_mesh_get_position_indices(mesh, i, &stride);
+		if (!indices) { continue; }
+
+		// Levels sharing the base level faces take its new count:
+		if ((i > 0) && (indices == base_indices))
+		{
+			mesh->num_faces[i] = mesh->num_faces[0];
+			continue;
+		}
+
+		// Kept faces move down in order, and never past one still to be read:
+		uint32_t num_faces = mesh->num_faces[i];
+		uint32_t num_kept = 0;
+		for (uint32_t j = 0; j < num_faces; j++)
+		{
+			const uint32_t *p = indices + ((size_t)j * stride);
+			if ((p[0] == p[1]) || (p[1] == p[2]) || (p[2] == p[0])) { continue; }
+			if (num_kept != j)
+			{
+				if (mp_mesh_is_soa(mesh))
+				{
+					uint32_t *arrays[4] = { mesh->soa.p[i], mesh->soa.n[i], mesh->soa.c[i],
+											mesh->soa.u[i] };
+					for (int k = 0; k < 4; k++)
+					{
+						memcpy(arrays[k] + ((size_t)num_kept * 3), arrays[k] + ((size_t)j * 3),
+										3 * sizeof(uint32_t));
+					}
+				}
+				else { mesh->faces[i][num_kept] = mesh->faces[i][j]; }
+			}
+			num_kept++;
+		}
+
+		if (i == 0) { num_removed = num_faces - num_kept; }
+		mesh->num_faces[i] = num_kept;
+	}
+
+	// Edges follow faces, and are recalculated after welding:
+	mesh->num_edges = mesh->num_faces[0] * 3;
+	return num_removed;
+}
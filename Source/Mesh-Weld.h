@@ -0,0 +1,97 @@
+#ifndef MP_MESH_WELD_H
+#define MP_MESH_WELD_H
+
+#include <NM-Config/Config.h>
+
+#include "Mesh.h"
+
+#define MP_MESH_WELD_CHUNK_SIZE	(1 << 16)	// Vertices per work chunk when renumbering.
+
+int mp_mesh_weld_vertices(mp_mesh_t *mesh, float epsilon, char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_weld_find_representatives(mp_mesh_t *mesh, float epsilon, mp_position_t minimum,
+		const uint64_t *sorted_keys, const uint32_t *sorted_vertices,
+		const uint64_t *table_keys, const uint32_t *table_values, uint64_t mask,
+		uint32_t *representatives);
+uint32_t mp_mesh_weld_remove_degenerate_faces(mp_mesh_t *mesh);
+
+/* Grid cell of a position. Cells are twice epsilon wide, so vertices to merge are in the same
+ * cell or, per axis, the neighbour on the side of the nearer cell border, which sides gives as
+ * -1 or 1 if not NULL. With no epsilon, the cell is the exact position, and sides are 0: */
+static inline void mp_mesh_weld_get_cell(mp_position_t position, mp_position_t minimum,
+						double inverse_size, int64_t cell[3], int sides[3])
+{
+	if (inverse_size == 0.0)
+	{
+		// Adding zero turns -0 into +0, so both fall in the same cell:
+		float components[3] = { position.x + 0.0f, position.y + 0.0f, position.z + 0.0f };
+		uint32_t bits[3];
+		memcpy(bits, components, sizeof(bits));
+		for (int i = 0; i < 3; i++)
+		{
+			cell[i] = bits[i];
+			if (sides) { sides[i] = 0; }
+		}
+		return;
+	}
+
+	double coordinates[3] = {
+		((double)position.x - minimum.x) * inverse_size,
+		((double)position.y - minimum.y) * inverse_size,
+		((double)position.z - minimum.z) * inverse_size
+	};
+	for (int i = 0; i < 3; i++)
+	{
+		cell[i] = (int64_t)coordinates[i];
+		if (sides) { sides[i] = ((coordinates[i] - (double)cell[i]) < 0.5) ? -1 : 1; }
+	}
+}
+
+/* Root of a vertex in the union-find forest, halving the path on the way. Parents always have
+ * lower indices, so the root is the lowest vertex of its set: */
+static inline uint32_t mp_mesh_weld_find_root(uint32_t *parents, uint32_t vertex)
+{
+	while (1)
+	{
+		uint32_t parent = __atomic_load_n(&(parents[vertex]), __ATOMIC_RELAXED);
+		if (parent == vertex) { return vertex; }
+		uint32_t grandparent = __atomic_load_n(&(parents[parent]), __ATOMIC_RELAXED);
+		if (grandparent != parent)
+		{
+			__atomic_compare_exchange_n(&(parents[vertex]), &parent, grandparent, 0,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		}
+		vertex = grandparent;
+	}
+}
+
+// Joins the sets of two vertices, linking the higher root under the lower, safely across threads:
+static inline void mp_mesh_weld_union(uint32_t *parents, uint32_t a, uint32_t b)
+{
+	while (1)
+	{
+		a = mp_mesh_weld_find_root(parents, a);
+		b = mp_mesh_weld_find_root(parents, b);
+		if (a == b) { return; }
+		if (a < b)
+		{
+			uint32_t swap = a;
+			a = b;
+			b = swap;
+		}
+
+		// Fails only if another thread linked root a first, so retry from the new roots:
+		uint32_t expected = a;
+		if (__atomic_compare_exchange_n(&(parents[a]), &expected, b, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) { return; }
+	}
+}
+
+// Top bit clear, so never MP_EDGE_HASH_EMPTY:
+static inline uint64_t mp_mesh_weld_cell_hash(const int64_t cell[3])
+{
+	return mp_mesh_edge_hash(((uint64_t)cell[0] * 0x9e3779b97f4a7c15ULL) ^
+				((uint64_t)cell[1] * 0xc2b2ae3d27d4eb4fULL) ^
+				((uint64_t)cell[2] * 0x165667b19e3779f9ULL)) >> 1;
+}
+
+#endif
@@ -1,32 +1,58 @@
 #include "Mesh.h"
+#include "Mesh-Normals.h"
+#include "Sort.h"
+
+#include <math.h>
 
 int mp_mesh_allocate(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 {
 	mp_mesh_free(mesh);
 	mesh->num_lod_levels = 1;
 
-	mesh->vertices = malloc(mesh->num_vertices * sizeof(mp_position_t));
-	mesh->normals = malloc(mesh->num_normals * sizeof(mp_normal_t));
-	mesh->colours = malloc(mesh->num_colours * sizeof(mp_colour_t));
-	mesh->uv_coordinates = malloc(mesh->num_uv_coordinates * sizeof(mp_uv_t));
-	mesh->edges = malloc(mesh->num_edges * sizeof(mp_edge_t));
-	mesh->first_edge = malloc(mesh->num_vertices * sizeof(uint32_t));
-	mesh->faces[0] = malloc(mesh->num_faces[0] * sizeof(mp_face_t));
-	if (!mesh->vertices || !mesh->normals || !mesh->colours ||
-			!mesh->uv_coordinates || !mesh->faces[0])
+	// Carve every array from a single arena, each on an aligned boundary:
+	uint8_t compact_edges = !!(mesh->flags & MP_MESH_FLAG_COMPACT_EDGES);
+	void **arrays[] = { (void **)&(mesh->vertices), (void **)&(mesh->normals),
+		(void **)&(mesh->colours), (void **)&(mesh->uv_coordinates),
+		compact_edges ? (void **)&(mesh->twins) : (void **)&(mesh->edges),
+		(void **)&(mesh->first_edge), (void **)&(mesh->faces[0]) };
+	size_t sizes[] = { mesh->num_vertices * sizeof(mp_position_t),
+		mesh->num_normals * sizeof(mp_normal_t),
+		mesh->num_colours * sizeof(mp_colour_t),
+		mesh->num_uv_coordinates * sizeof(mp_uv_t),
+		mesh->num_edges * (compact_edges ? sizeof(uint32_t) : sizeof(mp_edge_t)),
+		mesh->num_vertices * sizeof(uint32_t),
+		mesh->num_faces[0] * sizeof(mp_face_t) };
+	uint32_t num_arrays = sizeof(sizes) / sizeof(sizes[0]);
+
+	size_t arena_size = 0;
+	for (uint32_t i = 0; i < num_arrays; i++) { arena_size += mp_mesh_align_size(sizes[i]); }
+
+	mesh->arena = mp_mesh_allocate_block(mesh, arena_size);
+	if (!mesh->arena)
 	{
 		snprintf(error_message, NM_MAX_ERROR_LENGTH,
 			"Could not allocate memory for mesh \"%s\".", mesh->name);
 		return -1;
 	}
+	mesh->arena_size = arena_size;
+
+	uint8_t *position = mesh->arena;
+	for (uint32_t i = 0; i < num_arrays; i++)
+	{
+		*(arrays[i]) = position;
+		position += mp_mesh_align_size(sizes[i]);
+	}
 
-	memset(mesh->vertices, 0, mesh->num_vertices * sizeof(mp_position_t));
-	memset(mesh->normals, 0, mesh->num_normals * sizeof(mp_normal_t));
-	memset(mesh->colours, 0, mesh->num_colours * sizeof(mp_colour_t));
-	memset(mesh->uv_coordinates, 0, mesh->num_uv_coordinates * sizeof(mp_uv_t));
-	memset(mesh->edges, 0, mesh->num_edges * sizeof(mp_edge_t));
-	memset(mesh->first_edge, 0, mesh->num_vertices * sizeof(uint32_t));
-	memset(mesh->faces[0], 0, mesh->num_faces[0] * sizeof(mp_face_t));
+	// Zero in parallel, which also spreads first-touch page placement across threads:
+	size_t num_blocks = (arena_size + MP_MESH_ZERO_BLOCK_SIZE - 1) / MP_MESH_ZERO_BLOCK_SIZE;
+	#pragma omp parallel for
+	for (size_t i = 0; i < num_blocks; i++)
+	{
+		size_t start = i * MP_MESH_ZERO_BLOCK_SIZE;
+		size_t size = MP_MESH_ZERO_BLOCK_SIZE;
+		if ((start + size) > arena_size) { size = arena_size - start; }
+		memset((uint8_t *)mesh->arena + start, 0, size);
+	}
 
 	// Temporarily assign additional LOD levels to pointer for first:
 	for (int i = 1; i < NM_MAX_LOD_LEVELS; i++) { mesh->faces[i] = mesh->faces[0]; }
@@ -36,131 +62,717 @@ int mp_mesh_allocate(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 
 void mp_mesh_free(mp_mesh_t *mesh)
 {
-	if (mesh->vertices)
+	mp_mesh_soa_free(mesh, &(mesh->soa));
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++) { mp_mesh_free_meshlets(mesh, i); }
+	mp_mesh_free_quantised(mesh);
+
+	// Arrays inside the arena or cache file are skipped here, and released with them below:
+	mp_mesh_free_block(mesh, mesh->vertices);
+	mp_mesh_free_block(mesh, mesh->normals);
+	mp_mesh_free_block(mesh, mesh->colours);
+	mp_mesh_free_block(mesh, mesh->uv_coordinates);
+	mp_mesh_free_block(mesh, mesh->edges);
+	mp_mesh_free_block(mesh, mesh->twins);
+	mp_mesh_free_block(mesh, mesh->first_edge);
+
+	// Additional LOD levels may alias the first:
+	for (int i = 1; i < NM_MAX_LOD_LEVELS; i++)
 	{
-		free(mesh->vertices);
-		mesh->vertices = NULL;
+		if (mesh->faces[i] != mesh->faces[0]) { mp_mesh_free_block(mesh, mesh->faces[i]); }
+		mesh->faces[i] = NULL;
 	}
+	mp_mesh_free_block(mesh, mesh->faces[0]);
+	mesh->faces[0] = NULL;
 
-	if (mesh->normals)
+	mesh->vertices = NULL;
+	mesh->normals = NULL;
+	mesh->colours = NULL;
+	mesh->uv_coordinates = NULL;
+	mesh->edges = NULL;
+	mesh->twins = NULL;
+	mesh->first_edge = NULL;
+
+	if (mesh->arena)
 	{
-		free(mesh->normals);
-		mesh->normals = NULL;
+		void *arena = mesh->arena;
+		mesh->arena = NULL;
+		mesh->arena_size = 0;
+		mp_mesh_free_block(mesh, arena);
 	}
 
-	if (mesh->colours)
+	if (mesh->cache_file.data) { mp_file_close(&(mesh->cache_file)); }
+}
+
+void *mp_mesh_allocate_block(mp_mesh_t *mesh, size_t size)
+{
+	// A header in front of the block records its size, for allocators that need it on free:
+	size_t total_size = MP_MESH_ALIGNMENT + mp_mesh_align_size(size);
+	uint8_t *memory;
+	if (mesh->allocator.allocate)
 	{
-		free(mesh->colours);
-		mesh->colours = NULL;
+		memory = mesh->allocator.allocate(mesh->allocator.context, total_size,
+								MP_MESH_ALIGNMENT);
 	}
+	else
+	{
+		memory = aligned_alloc(MP_MESH_ALIGNMENT, total_size);
+	}
+	if (!memory) { return NULL; }
+
+	*((size_t *)memory) = total_size;
+	return memory + MP_MESH_ALIGNMENT;
+}
 
-	if (mesh->uv_coordinates)
+void mp_mesh_free_block(mp_mesh_t *mesh, void *block)
+{
+	if (!block) { return; }
+
+	// Blocks carved from the arena or mapped from the cache are released with those:
+	uint8_t *address = block;
+	if (mesh->arena && (address >= (uint8_t *)mesh->arena) &&
+		(address < ((uint8_t *)mesh->arena + mesh->arena_size))) { return; }
+	if (mesh->cache_file.data && (address >= (uint8_t *)mesh->cache_file.data) &&
+		(address < ((uint8_t *)mesh->cache_file.data + mesh->cache_file.length))) { return; }
+
+	uint8_t *memory = address - MP_MESH_ALIGNMENT;
+	if (mesh->allocator.free)
+	{
+		mesh->allocator.free(mesh->allocator.context, memory, *((size_t *)memory));
+	}
+	else
 	{
-		free(mesh->uv_coordinates);
-		mesh->uv_coordinates = NULL;
+		free(memory);
 	}
+}
 
-	if (mesh->edges)
+void mp_mesh_free_level(mp_mesh_t *mesh, uint8_t lod)
+{
+	if (lod == 0) { return; }
+
+	// Meshlets refer to the level's faces, so go with them:
+	mp_mesh_free_meshlets(mesh, lod);
+
+	// Frees an additional LOD level's own faces, and points it back at the base level:
+	if (mp_mesh_is_soa(mesh))
+	{
+		if (mesh->soa.p[lod] != mesh->soa.p[0])
+		{
+			mp_mesh_free_block(mesh, mesh->soa.p[lod]);
+			mp_mesh_free_block(mesh, mesh->soa.n[lod]);
+			mp_mesh_free_block(mesh, mesh->soa.c[lod]);
+			mp_mesh_free_block(mesh, mesh->soa.u[lod]);
+		}
+		mesh->soa.p[lod] = mesh->soa.p[0];
+		mesh->soa.n[lod] = mesh->soa.n[0];
+		mesh->soa.c[lod] = mesh->soa.c[0];
+		mesh->soa.u[lod] = mesh->soa.u[0];
+	}
+	else
+	{
+		if (mesh->faces[lod] != mesh->faces[0]) { mp_mesh_free_block(mesh, mesh->faces[lod]); }
+		mesh->faces[lod] = mesh->faces[0];
+	}
+	mesh->num_faces[lod] = mesh->num_faces[0];
+}
+
+void mp_mesh_free_meshlets(mp_mesh_t *mesh, uint8_t lod)
+{
+	mp_mesh_meshlets_t *meshlets = &(mesh->meshlets[lod]);
+	mp_mesh_free_block(mesh, meshlets->meshlets);
+	mp_mesh_free_block(mesh, meshlets->vertices);
+	mp_mesh_free_block(mesh, meshlets->triangles);
+	mp_mesh_free_block(mesh, meshlets->faces);
+	memset(meshlets, 0, sizeof(mp_mesh_meshlets_t));
+}
+
+void mp_mesh_free_quantised(mp_mesh_t *mesh)
+{
+	mp_mesh_free_block(mesh, mesh->quantised.positions);
+	mp_mesh_free_block(mesh, mesh->quantised.uv_coordinates);
+	memset(&(mesh->quantised), 0, sizeof(mp_mesh_quantised_t));
+}
+
+int mp_mesh_build_connectivity(mp_mesh_t *mesh, mp_mesh_connectivity_t *connectivity,
+				uint8_t sort_edges, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	memset(connectivity, 0, sizeof(mp_mesh_connectivity_t));
+	connectivity->num_edges = mesh->num_edges;
+	connectivity->num_vertices = mesh->num_vertices;
+	connectivity->num_duplicate_edges = -1;
+
+	// Only the position indices are read, in either layout:
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, 0, &stride);
+
+	// Vertex degrees with a single counting pass, instead of sorting edges by "from":
+	connectivity->vertex_degrees = calloc(mesh->num_vertices, sizeof(uint32_t));
+	if (!connectivity->vertex_degrees)
 	{
-		free(mesh->edges);
-		mesh->edges = NULL;
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for vertex degrees on mesh \"%s\".", mesh->name);
+		mp_mesh_connectivity_free(connectivity);
+		return -1;
+	}
+	uint64_t start = SDL_GetPerformanceCounter();
+	uint32_t *vertex_degrees = connectivity->vertex_degrees;
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		__atomic_fetch_add(&(vertex_degrees[mp_mesh_edge_from(indices, stride, i)]), 1,
+									__ATOMIC_RELAXED);
 	}
+	connectivity->phase_seconds[MP_CONNECTIVITY_PHASE_DEGREES] = mp_mesh_get_seconds_since(start);
 
-	if (mesh->first_edge)
+	// Hash pairing doesn't need the sorted order:
+	if (!sort_edges) { return 0; }
+
+	start = SDL_GetPerformanceCounter();
+
+	connectivity->keys = malloc(mesh->num_edges * sizeof(uint64_t));
+	connectivity->sorted_edges = malloc(mesh->num_edges * sizeof(uint32_t));
+	if (!connectivity->keys || !connectivity->sorted_edges ||
+		mp_mesh_sort_edges(indices, stride, mesh->num_faces[0], connectivity->keys,
+							connectivity->sorted_edges))
 	{
-		free(mesh->first_edge);
-		mesh->first_edge = NULL;
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for edge sorting on mesh \"%s\".", mesh->name);
+		mp_mesh_connectivity_free(connectivity);
+		return -1;
 	}
+	connectivity->phase_seconds[MP_CONNECTIVITY_PHASE_SORT] = mp_mesh_get_seconds_since(start);
 
-	for (uint8_t i = 0; i < mesh->num_lod_levels; i++)
+	/* Count directed edges repeated within a run of equal undirected keys. Runs are short, so
+	 * each position just looks back through its own run: */
+	const uint64_t *keys = connectivity->keys;
+	const uint32_t *order = connectivity->sorted_edges;
+	int64_t num_duplicate_edges = 0;
+	start = SDL_GetPerformanceCounter();
+	#pragma omp parallel for reduction(+:num_duplicate_edges)
+	for (uint32_t i = 1; i < mesh->num_edges; i++)
 	{
-		if (mesh->faces[i])
+		uint32_t from = mp_mesh_edge_from(indices, stride, order[i]);
+		for (uint32_t j = i; (j > 0) && (keys[j - 1] == keys[i]); j--)
 		{
-			free(mesh->faces[i]);
-			mesh->faces[i] = NULL;
+			if (mp_mesh_edge_from(indices, stride, order[j - 1]) == from)
+			{
+				num_duplicate_edges++;
+				break;
+			}
 		}
 	}
+	connectivity->num_duplicate_edges = num_duplicate_edges;
+	connectivity->phase_seconds[MP_CONNECTIVITY_PHASE_DUPLICATES] =
+							mp_mesh_get_seconds_since(start);
+
+	return 0;
+}
+
+void mp_mesh_connectivity_free(mp_mesh_connectivity_t *connectivity)
+{
+	if (connectivity->keys) { free(connectivity->keys); }
+	if (connectivity->sorted_edges) { free(connectivity->sorted_edges); }
+	if (connectivity->vertex_degrees) { free(connectivity->vertex_degrees); }
+	connectivity->keys = NULL;
+	connectivity->sorted_edges = NULL;
+	connectivity->vertex_degrees = NULL;
 }
 
 int mp_mesh_calculate_edges(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 {
-	for (uint32_t i = 0; i < mesh->num_faces[0]; i++)
+	mp_mesh_connectivity_t connectivity;
+	uint8_t sort_edges = !(mesh->flags & MP_MESH_FLAG_HASH_EDGE_PAIRING);
+	if (mp_mesh_build_connectivity(mesh, &connectivity, sort_edges, error_message)) { return -1; }
+
+	int return_value = mp_mesh_calculate_edges_from_connectivity(mesh, &connectivity,
+										error_message);
+	mp_mesh_connectivity_free(&connectivity);
+	return return_value;
+}
+
+int mp_mesh_calculate_edges_from_connectivity(mp_mesh_t *mesh,
+		mp_mesh_connectivity_t *connectivity, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	// Only the position indices are read, in either layout:
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, 0, &stride);
+
+	if (mesh->edges)
+	{
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_edges; i++)
+		{
+			mesh->edges[i].from		= mp_mesh_edge_from(indices, stride, i);
+			mesh->edges[i].to		= mp_mesh_edge_to(indices, stride, i);
+			mesh->edges[i].next		= (i - (i % 3)) + ((i + 1) % 3);
+			mesh->edges[i].other_half	= -1;
+		}
+	}
+
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		mesh->first_edge[mp_mesh_get_edge_from(mesh, i)] = i;
+	}
+
+	// Compact edges are paired in place:
+	uint32_t *twins = mesh->twins;
+	if (!twins) { twins = malloc(mesh->num_edges * sizeof(uint32_t)); }
+	if (!twins)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Could not allocate memory for edge pairing on mesh \"%s\".", mesh->name);
+		return -1;
+	}
+
+	// Reuse the sorted order if there is one, otherwise pair through the hash table:
+	if (connectivity->sorted_edges)
+	{
+		mp_mesh_pair_sorted_edges(indices, stride, mesh->num_edges, connectivity->keys,
+								connectivity->sorted_edges, twins);
+	}
+	else
+	{
+		uint32_t num_duplicates;
+		if (mp_mesh_pair_edges_hash(indices, stride, mesh->num_faces[0], twins,
+								&num_duplicates))
+		{
+			snprintf(error_message, NM_MAX_ERROR_LENGTH,
+				"Could not allocate memory for edge hashing on mesh \"%s\".", mesh->name);
+			if (twins != mesh->twins) { free(twins); }
+			return -1;
+		}
+		connectivity->num_duplicate_edges = num_duplicates;
+	}
+
+	if (mesh->edges)
+	{
+		#pragma omp parallel for
+		for (uint32_t i = 0; i < mesh->num_edges; i++)
+		{
+			if (twins[i] != MP_EDGE_NONE) { mesh->edges[i].other_half = twins[i]; }
+		}
+		free(twins);
+	}
+
+	return 0;
+}
+
+int mp_mesh_pair_edges(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+							uint32_t *twins, uint32_t flags)
+{
+	if (flags & MP_MESH_FLAG_HASH_EDGE_PAIRING)
+	{
+		return mp_mesh_pair_edges_hash(indices, stride, num_faces, twins, NULL);
+	}
+	return mp_mesh_pair_edges_sort(indices, stride, num_faces, twins);
+}
+
+int mp_mesh_pair_edges_sort(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+								uint32_t *twins)
+{
+	uint32_t num_edges = num_faces * 3;
+	uint64_t *keys = malloc(num_edges * sizeof(uint64_t));
+	uint32_t *order = malloc(num_edges * sizeof(uint32_t));
+	if (!keys || !order || mp_mesh_sort_edges(indices, stride, num_faces, keys, order))
+	{
+		if (keys) { free(keys); }
+		if (order) { free(order); }
+		return -1;
+	}
+
+	mp_mesh_pair_sorted_edges(indices, stride, num_edges, keys, order, twins);
+
+	free(keys);
+	free(order);
+	return 0;
+}
+
+int mp_mesh_sort_edges(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+						uint64_t *keys, uint32_t *order)
+{
+	uint32_t num_edges = num_faces * 3;
+
+	// Sort edges by lower vertex index, then higher, carrying only the edge index:
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_edges; i++)
+	{
+		uint32_t from = mp_mesh_edge_from(indices, stride, i);
+		uint32_t to = mp_mesh_edge_to(indices, stride, i);
+		if (from < to) { keys[i] = ((uint64_t)from << 32) | to; }
+		else { keys[i] = ((uint64_t)to << 32) | from; }
+		order[i] = i;
+	}
+
+	return mp_sort_radix_u64(keys, order, num_edges);
+}
+
+void mp_mesh_pair_sorted_edges(const uint32_t *indices, uint32_t stride, uint32_t num_edges,
+			const uint64_t *keys, const uint32_t *order, uint32_t *twins)
+{
+	/* Other halves are now adjacent. A pair later in the sorted order takes precedence over
+	 * an earlier one, so each position can be resolved independently: */
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_edges; i++)
 	{
-		for (int j = 0; j < 3; j++)
+		uint32_t edge = order[i];
+		if ((i < (num_edges - 1)) && (keys[i] == keys[i + 1]) &&
+			(mp_mesh_edge_from(indices, stride, edge) !=
+			mp_mesh_edge_from(indices, stride, order[i + 1])))
 		{
-			mesh->edges[(i * 3) + j].from		= mesh->faces[0][i].p[j];
-			mesh->edges[(i * 3) + j].to		= mesh->faces[0][i].p[(j + 1) % 3];
-			mesh->edges[(i * 3) + j].next		= (i * 3) + ((j + 1) % 3);
-			mesh->edges[(i * 3) + j].other_half	= -1;
+			twins[edge] = order[i + 1];
+		}
+		else if ((i > 0) && (keys[i] == keys[i - 1]) &&
+			(mp_mesh_edge_from(indices, stride, edge) !=
+			mp_mesh_edge_from(indices, stride, order[i - 1])))
+		{
+			twins[edge] = order[i - 1];
+		}
+		else
+		{
+			twins[edge] = MP_EDGE_NONE;
+		}
+	}
+}
+
+int mp_mesh_pair_edges_hash(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+						uint32_t *twins, uint32_t *num_duplicates)
+{
+	uint32_t num_edges = num_faces * 3;
 
-			mesh->first_edge[mesh->edges[(i * 3) + j].from] = (i * 3) + j;
+	// Keep the load factor at or below one half:
+	uint64_t capacity = 1;
+	while (capacity < ((uint64_t)num_edges * 2)) { capacity <<= 1; }
+	uint64_t mask = capacity - 1;
+
+	uint64_t *keys = malloc(capacity * sizeof(uint64_t));
+	uint32_t *values = malloc(capacity * sizeof(uint32_t));
+	if (!keys || !values)
+	{
+		if (keys) { free(keys); }
+		if (values) { free(values); }
+		return -1;
+	}
+
+	#pragma omp parallel for
+	for (uint64_t i = 0; i < capacity; i++)
+	{
+		keys[i] = MP_EDGE_HASH_EMPTY;
+		values[i] = MP_EDGE_NONE;
+	}
+
+	/* Insert directed edges keyed on (from, to). Slots are claimed with compare-and-swap, and
+	 * duplicated directed edges keep the lowest edge index, so the table is deterministic: */
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < num_edges; i++)
+	{
+		uint64_t key = ((uint64_t)mp_mesh_edge_from(indices, stride, i) << 32) |
+							mp_mesh_edge_to(indices, stride, i);
+		uint64_t slot = mp_mesh_edge_hash(key) & mask;
+		while (1)
+		{
+			uint64_t expected = MP_EDGE_HASH_EMPTY;
+			if (__atomic_compare_exchange_n(&(keys[slot]), &expected, key, 0,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || (expected == key))
+			{
+				break;
+			}
+			slot = (slot + 1) & mask;
 		}
+
+		uint32_t current = __atomic_load_n(&(values[slot]), __ATOMIC_RELAXED);
+		while ((i < current) && !__atomic_compare_exchange_n(&(values[slot]), &current, i,
+						1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 	}
 
-	// Sort edges by lower vertex index, then higher:
-	mp_edge_t *edges = malloc(mesh->num_edges * sizeof(mp_edge_t));
-	if (!edges)
+	// The table is read-only from here, so lookups need no synchronisation:
+	uint32_t duplicates = 0;
+	#pragma omp parallel for reduction(+:duplicates)
+	for (uint32_t i = 0; i < num_edges; i++)
+	{
+		uint32_t from = mp_mesh_edge_from(indices, stride, i);
+		uint32_t to = mp_mesh_edge_to(indices, stride, i);
+		uint32_t twin = mp_mesh_edge_hash_find(keys, values, mask, ((uint64_t)to << 32) | from);
+
+		// Only pair edges that are the representative of their own direction:
+		uint8_t is_representative = (mp_mesh_edge_hash_find(keys, values, mask,
+							((uint64_t)from << 32) | to) == i);
+		if (!is_representative) { duplicates++; }
+		if ((twin != MP_EDGE_NONE) && (from != to) && is_representative)
+		{
+			twins[i] = twin;
+		}
+		else
+		{
+			twins[i] = MP_EDGE_NONE;
+		}
+	}
+	if (num_duplicates) { *num_duplicates = duplicates; }
+
+	free(keys);
+	free(values);
+	return 0;
+}
+
+uint32_t mp_mesh_edge_hash_find(const uint64_t *keys, const uint32_t *values, uint64_t mask,
+										uint64_t key)
+{
+	uint64_t slot = mp_mesh_edge_hash(key) & mask;
+	while (keys[slot] != MP_EDGE_HASH_EMPTY)
+	{
+		if (keys[slot] == key) { return values[slot]; }
+		slot = (slot + 1) & mask;
+	}
+	return MP_EDGE_NONE;
+}
+
+int mp_mesh_convert_to_soa(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	if (mp_mesh_is_soa(mesh)) { return 0; }
+
+	mp_mesh_soa_t soa;
+	memset(&soa, 0, sizeof(soa));
+
+	soa.x = mp_mesh_allocate_block(mesh, mesh->num_vertices * sizeof(float));
+	soa.y = mp_mesh_allocate_block(mesh, mesh->num_vertices * sizeof(float));
+	soa.z = mp_mesh_allocate_block(mesh, mesh->num_vertices * sizeof(float));
+	uint8_t failed = (!soa.x || !soa.y || !soa.z);
+
+	for (int i = 0; (i < NM_MAX_LOD_LEVELS) && !failed; i++)
+	{
+		if ((i > 0) && (mesh->faces[i] == mesh->faces[0])) { continue; }
+		if (!mesh->faces[i]) { continue; }
+
+		size_t size = (size_t)mesh->num_faces[i] * 3 * sizeof(uint32_t);
+		soa.p[i] = mp_mesh_allocate_block(mesh, size);
+		soa.n[i] = mp_mesh_allocate_block(mesh, size);
+		soa.c[i] = mp_mesh_allocate_block(mesh, size);
+		soa.u[i] = mp_mesh_allocate_block(mesh, size);
+		failed = (!soa.p[i] || !soa.n[i] || !soa.c[i] || !soa.u[i]);
+	}
+
+	if (failed)
 	{
 		snprintf(error_message, NM_MAX_ERROR_LENGTH,
-			"Could not allocate memory for edge sorting on mesh \"%s\".", mesh->name);
+			"Could not allocate structure-of-arrays memory for mesh \"%s\".", mesh->name);
+		mp_mesh_soa_free(mesh, &soa);
 		return -1;
 	}
-	memcpy(edges, mesh->edges, mesh->num_edges * sizeof(mp_edge_t));
-	qsort(edges, mesh->num_edges, sizeof(edges[0]), mp_mesh_edge_qsort_compare_low_high);
 
-	// Other halves should now be adjacent:
-	for (uint32_t i = 0; i < (mesh->num_edges - 1); i++)
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
 	{
-		if ((edges[i].from == edges[i + 1].to) &&
-			(edges[i].to == edges[i + 1].from))
+		soa.x[i] = mesh->vertices[i].x;
+		soa.y[i] = mesh->vertices[i].y;
+		soa.z[i] = mesh->vertices[i].z;
+	}
+
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if (!soa.p[i]) { continue; }
+
+		#pragma omp parallel for
+		for (uint32_t j = 0; j < mesh->num_faces[i]; j++)
 		{
-			// Edges were sorted by face, so get original vertex from "next":
-			uint32_t index_left = mp_mesh_get_edge_index(&(edges[i]));
-			uint32_t index_right = mp_mesh_get_edge_index(&(edges[i + 1]));
-			mesh->edges[index_left].other_half = index_right;
-			mesh->edges[index_right].other_half = index_left;
+			for (int k = 0; k < 3; k++)
+			{
+				soa.p[i][(j * 3) + k] = mesh->faces[i][j].p[k];
+				soa.n[i][(j * 3) + k] = mesh->faces[i][j].n[k];
+				soa.c[i][(j * 3) + k] = mesh->faces[i][j].c[k];
+				soa.u[i][(j * 3) + k] = mesh->faces[i][j].u[k];
+			}
 		}
 	}
 
-	free(edges);
+	// LOD levels that share the base level faces share its arrays too:
+	for (int i = 1; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if (mesh->faces[i] != mesh->faces[0]) { continue; }
+		soa.p[i] = soa.p[0];
+		soa.n[i] = soa.n[0];
+		soa.c[i] = soa.c[0];
+		soa.u[i] = soa.u[0];
+	}
+
+	// Arena and cached arrays stay allocated until the mesh is freed:
+	mp_mesh_free_block(mesh, mesh->vertices);
+	for (int i = 1; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if (mesh->faces[i] != mesh->faces[0]) { mp_mesh_free_block(mesh, mesh->faces[i]); }
+	}
+	mp_mesh_free_block(mesh, mesh->faces[0]);
+	mesh->vertices = NULL;
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++) { mesh->faces[i] = NULL; }
+
+	mesh->soa = soa;
 	return 0;
 }
 
-int mp_mesh_check_manifold(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+int mp_mesh_convert_to_aos(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
 {
-	int return_value = 0;
-	uint8_t is_manifold = 1;
-	mp_edge_t *edges = NULL;
-	uint32_t *vertex_degrees = NULL;
+	if (!mp_mesh_is_soa(mesh)) { return 0; }
+
+	mp_position_t *vertices = mp_mesh_allocate_block(mesh, mesh->num_vertices * sizeof(mp_position_t));
+	mp_face_t *faces[NM_MAX_LOD_LEVELS];
+	uint8_t failed = !vertices;
+
+	memset(faces, 0, sizeof(faces));
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if ((i > 0) && (mesh->soa.p[i] == mesh->soa.p[0])) { continue; }
+		if (!mesh->soa.p[i]) { continue; }
+
+		faces[i] = mp_mesh_allocate_block(mesh, mesh->num_faces[i] * sizeof(mp_face_t));
+		if (!faces[i]) { failed = 1; }
+	}
 
-	edges = malloc(mesh->num_edges * sizeof(mp_edge_t));
-	if (!edges)
+	if (failed)
 	{
 		snprintf(error_message, NM_MAX_ERROR_LENGTH,
-			"Could not allocate memory for edge sorting on mesh \"%s\".", mesh->name);
-		return_value = -1;
-		goto cleanup;
+			"Could not allocate array-of-structures memory for mesh \"%s\".", mesh->name);
+		mp_mesh_free_block(mesh, vertices);
+		for (int i = 0; i < NM_MAX_LOD_LEVELS; i++) { mp_mesh_free_block(mesh, faces[i]); }
+		return -1;
 	}
-	memcpy(edges, mesh->edges, mesh->num_edges * sizeof(mp_edge_t));
 
-	/***********************
-	 * Edge duplicate test *
-	 ***********************/
+	#pragma omp parallel for
+	for (uint32_t i = 0; i < mesh->num_vertices; i++)
+	{
+		vertices[i].x = mesh->soa.x[i];
+		vertices[i].y = mesh->soa.y[i];
+		vertices[i].z = mesh->soa.z[i];
+	}
+
+	for (int i = 0; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if (!faces[i]) { continue; }
+
+		#pragma omp parallel for
+		for (uint32_t j = 0; j < mesh->num_faces[i]; j++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				faces[i][j].p[k] = mesh->soa.p[i][(j * 3) + k];
+				faces[i][j].n[k] = mesh->soa.n[i][(j * 3) + k];
+				faces[i][j].c[k] = mesh->soa.c[i][(j * 3) + k];
+				faces[i][j].u[k] = mesh->soa.u[i][(j * 3) + k];
+			}
+		}
+	}
+
+	for (int i = 1; i < NM_MAX_LOD_LEVELS; i++)
+	{
+		if (mesh->soa.p[i] == mesh->soa.p[0]) { faces[i] = faces[0]; }
+	}
 
-	// Sort edges by lower vertex index, then higher:
-	qsort(edges, mesh->num_edges, sizeof(edges[0]), mp_mesh_edge_qsort_compare_low_high);
+	mp_mesh_soa_free(mesh, &(mesh->soa));
+	mesh->vertices = vertices;
+	memcpy(mesh->faces, faces, sizeof(faces));
+	return 0;
+}
+
+void mp_mesh_soa_free(mp_mesh_t *mesh, mp_mesh_soa_t *soa)
+{
+	mp_mesh_free_block(mesh, soa->x);
+	mp_mesh_free_block(mesh, soa->y);
+	mp_mesh_free_block(mesh, soa->z);
 
-	#pragma omp parallel for shared(is_manifold)
-	for (uint32_t i = 0; i < (mesh->num_edges - 1); i++)
+	for (int i = 1; i < NM_MAX_LOD_LEVELS; i++)
 	{
-		if (!is_manifold) { continue; }
-		if ((edges[i].from == edges[i + 1].from) && (edges[i].to == edges[i + 1].to))
+		if (soa->p[i] != soa->p[0])
 		{
-			is_manifold = 0;
+			mp_mesh_free_block(mesh, soa->p[i]);
+			mp_mesh_free_block(mesh, soa->n[i]);
+			mp_mesh_free_block(mesh, soa->c[i]);
+			mp_mesh_free_block(mesh, soa->u[i]);
 		}
 	}
-	mesh->is_manifold = is_manifold;
-	if (!mesh->is_manifold) { goto cleanup; }
+	mp_mesh_free_block(mesh, soa->p[0]);
+	mp_mesh_free_block(mesh, soa->n[0]);
+	mp_mesh_free_block(mesh, soa->c[0]);
+	mp_mesh_free_block(mesh, soa->u[0]);
+
+	memset(soa, 0, sizeof(mp_mesh_soa_t));
+}
+
+void mp_mesh_calculate_bounds(mp_mesh_t *mesh, mp_position_t *minimum, mp_position_t *maximum)
+{
+	float min_x = INFINITY, min_y = INFINITY, min_z = INFINITY;
+	float max_x = -INFINITY, max_y = -INFINITY, max_z = -INFINITY;
+
+	if (mp_mesh_is_soa(mesh))
+	{
+		// Each component streams through its own array:
+		#pragma omp parallel for reduction(min:min_x) reduction(max:max_x)
+		for (uint32_t i = 0; i < mesh->num_vertices; i++)
+		{
+			if (mesh->soa.x[i] < min_x) { min_x = mesh->soa.x[i]; }
+			if (mesh->soa.x[i] > max_x) { max_x = mesh->soa.x[i]; }
+		}
+		#pragma omp parallel for reduction(min:min_y) reduction(max:max_y)
+		for (uint32_t i = 0; i < mesh->num_vertices; i++)
+		{
+			if (mesh->soa.y[i] < min_y) { min_y = mesh->soa.y[i]; }
+			if (mesh->soa.y[i] > max_y) { max_y = mesh->soa.y[i]; }
+		}
+		#pragma omp parallel for reduction(min:min_z) reduction(max:max_z)
+		for (uint32_t i = 0; i < mesh->num_vertices; i++)
+		{
+			if (mesh->soa.z[i] < min_z) { min_z = mesh->soa.z[i]; }
+			if (mesh->soa.z[i] > max_z) { max_z = mesh->soa.z[i]; }
+		}
+	}
+	else
+	{
+		#pragma omp parallel for reduction(min:min_x, min_y, min_z) \
+					reduction(max:max_x, max_y, max_z)
+		for (uint32_t i = 0; i < mesh->num_vertices; i++)
+		{
+			if (mesh->vertices[i].x < min_x) { min_x = mesh->vertices[i].x; }
+			if (mesh->vertices[i].y < min_y) { min_y = mesh->vertices[i].y; }
+			if (mesh->vertices[i].z < min_z) { min_z = mesh->vertices[i].z; }
+			if (mesh->vertices[i].x > max_x) { max_x = mesh->vertices[i].x; }
+			if (mesh->vertices[i].y > max_y) { max_y = mesh->vertices[i].y; }
+			if (mesh->vertices[i].z > max_z) { max_z = mesh->vertices[i].z; }
+		}
+	}
+
+	minimum->x = min_x;
+	minimum->y = min_y;
+	minimum->z = min_z;
+	maximum->x = max_x;
+	maximum->y = max_y;
+	maximum->z = max_z;
+}
+
+int mp_mesh_check_manifold(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	mp_mesh_connectivity_t connectivity;
+	if (mp_mesh_build_connectivity(mesh, &connectivity, 1, error_message)) { return -1; }
+
+	int return_value = mp_mesh_check_manifold_from_connectivity(mesh, &connectivity,
+										error_message);
+	mp_mesh_connectivity_free(&connectivity);
+	return return_value;
+}
+
+int mp_mesh_check_manifold_from_connectivity(mp_mesh_t *mesh,
+		mp_mesh_connectivity_t *connectivity, char error_message[NM_MAX_ERROR_LENGTH])
+{
+	uint8_t is_manifold = 1;
+
+	/***********************
+	 * Edge duplicate test *
+	 ***********************/
+
+	// Counted while sorting, or while hashing during edge calculation:
+	if (connectivity->num_duplicate_edges < 0)
+	{
+		snprintf(error_message, NM_MAX_ERROR_LENGTH,
+			"Duplicate edges of mesh \"%s\" were not counted before the manifold check.",
+			mesh->name);
+		return -1;
+	}
+	mesh->is_manifold = (connectivity->num_duplicate_edges == 0);
+	if (!mesh->is_manifold) { return 0; }
 
 	/*******************
 	 * Edge pairs test *
@@ -174,41 +786,25 @@ int mp_mesh_check_manifold(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENG
 	 * Vertex cycles test *
 	 **********************/
 
-	// Sort edges by "from":
-	qsort(edges, mesh->num_edges, sizeof(edges[0]), mp_mesh_edge_qsort_compare_from);
-
-	vertex_degrees = malloc(mesh->num_vertices * sizeof(uint32_t));
-	if (!vertex_degrees)
-	{
-		snprintf(error_message, NM_MAX_ERROR_LENGTH,
-			"Could not allocate memory for vertex degrees on mesh \"%s\".", mesh->name);
-		return_value = -1;
-		goto cleanup;
-	}
-	memset(vertex_degrees, 0, mesh->num_vertices * sizeof(uint32_t));
-
-	uint32_t current_edge = 0;
+	/* Each vertex only rewrites its own first edge, so fans are checked independently. The
+	 * first failure is published atomically and the remaining vertices skip their walks. An
+	 * isolated vertex has no fan at all, so it fails without walking: */
+	const uint32_t *vertex_degrees = connectivity->vertex_degrees;
+	uint64_t start = SDL_GetPerformanceCounter();
+	#pragma omp parallel for schedule(dynamic, MP_MESH_MANIFOLD_CHUNK_SIZE)
 	for (uint32_t i = 0; i < mesh->num_vertices; i++)
 	{
-		while (edges[current_edge].from == i)
+		if (!__atomic_load_n(&is_manifold, __ATOMIC_RELAXED)) { continue; }
+		if ((vertex_degrees[i] == 0) || mp_mesh_triangle_fan_check(mesh, i, vertex_degrees[i]))
 		{
-			vertex_degrees[i]++;
-			current_edge++;
+			__atomic_store_n(&is_manifold, 0, __ATOMIC_RELAXED);
 		}
 	}
-
-	#pragma omp parallel for shared(is_manifold)
-	for (uint32_t i = 0; i < mesh->num_vertices; i++)
-	{
-		if (!is_manifold) { continue; }
-		if (mp_mesh_triangle_fan_check(mesh, i, vertex_degrees[i])) { is_manifold = 0; }
-	}
+	connectivity->phase_seconds[MP_CONNECTIVITY_PHASE_TRIANGLE_FANS] =
+							mp_mesh_get_seconds_since(start);
 	mesh->is_manifold = is_manifold;
 
-	cleanup:
-	if (vertex_degrees) { free(vertex_degrees); }
-	if (edges) { free(edges); }
-	return return_value;
+	return 0;
 }
 
 uint32_t mp_mesh_triangle_fan_check(mp_mesh_t *mesh, uint32_t vertex, uint32_t vertex_degree)
@@ -256,17 +852,17 @@ uint32_t mp_mesh_get_edge_index(mp_edge_t *edge)
 int64_t mp_mesh_get_next_vertex_edge(mp_mesh_t *mesh, uint32_t vertex, uint32_t edge)
 {
 	int64_t next_edge = edge;
-	if (mesh->edges[next_edge].from == vertex)
+	if (mp_mesh_get_edge_from(mesh, next_edge) == vertex)
 	{
-		next_edge = mesh->edges[next_edge].next;
-		if (mesh->edges[next_edge].to != vertex)
+		next_edge = mp_mesh_get_edge_next(mesh, next_edge);
+		if (mp_mesh_get_edge_to(mesh, next_edge) != vertex)
 		{
-			next_edge = mesh->edges[next_edge].next;
+			next_edge = mp_mesh_get_edge_next(mesh, next_edge);
 		}
 	}
-	else if (mesh->edges[next_edge].to == vertex)
+	else if (mp_mesh_get_edge_to(mesh, next_edge) == vertex)
 	{
-		next_edge = mesh->edges[next_edge].other_half;
+		next_edge = mp_mesh_get_edge_other_half(mesh, next_edge);
 	}
 	return next_edge;
 }
@@ -274,17 +870,17 @@ int64_t mp_mesh_get_next_vertex_edge(mp_mesh_t *mesh, uint32_t vertex, uint32_t
 int64_t mp_mesh_get_previous_vertex_edge(mp_mesh_t *mesh, uint32_t vertex, uint32_t edge)
 {
 	int64_t previous_edge = edge;
-	if (mesh->edges[previous_edge].to == vertex)
+	if (mp_mesh_get_edge_to(mesh, previous_edge) == vertex)
 	{
-		previous_edge = mesh->edges[previous_edge].next;
-		if (mesh->edges[previous_edge].from != vertex)
+		previous_edge = mp_mesh_get_edge_next(mesh, previous_edge);
+		if (mp_mesh_get_edge_from(mesh, previous_edge) != vertex)
 		{
-			previous_edge = mesh->edges[previous_edge].next;
+			previous_edge = mp_mesh_get_edge_next(mesh, previous_edge);
 		}
 	}
-	else if (mesh->edges[previous_edge].from == vertex)
+	else if (mp_mesh_get_edge_from(mesh, previous_edge) == vertex)
 	{
-		previous_edge = mesh->edges[previous_edge].other_half;
+		previous_edge = mp_mesh_get_edge_other_half(mesh, previous_edge);
 	}
 	return previous_edge;
 }
@@ -340,6 +936,95 @@ int mp_mesh_edge_qsort_compare_low_high(const void *a, const void *b)
 }
 
 #ifdef MP_DEBUG
+int mp_mesh_benchmark_edge_pairing(FILE *file, mp_mesh_t *mesh, uint32_t num_runs)
+{
+	const char *names[2] = { "Sort", "Hash" };
+	const uint32_t flags[2] = { 0, MP_MESH_FLAG_HASH_EDGE_PAIRING };
+	uint32_t *twins[2];
+	double seconds[2] = { 0.0, 0.0 };
+
+	twins[0] = malloc(mesh->num_edges * sizeof(uint32_t));
+	twins[1] = malloc(mesh->num_edges * sizeof(uint32_t));
+	if (!twins[0] || !twins[1])
+	{
+		if (twins[0]) { free(twins[0]); }
+		if (twins[1]) { free(twins[1]); }
+		return -1;
+	}
+
+	// Structure-of-arrays meshes have no faces array, so go through the layout accessor:
+	uint32_t stride;
+	const uint32_t *indices = mp_mesh_get_position_indices(mesh, 0, &stride);
+	for (uint32_t run = 0; run < num_runs; run++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			uint64_t start = SDL_GetPerformanceCounter();
+			if (mp_mesh_pair_edges(indices, stride, mesh->num_faces[0], twins[i], flags[i]))
+			{
+				free(twins[0]);
+				free(twins[1]);
+				return -1;
+			}
+			seconds[i] += mp_mesh_get_seconds_since(start);
+		}
+	}
+
+	uint32_t num_mismatches = 0;
+	for (uint32_t i = 0; i < mesh->num_edges; i++)
+	{
+		if (twins[0][i] != twins[1][i]) { num_mismatches++; }
+	}
+
+	fprintf(file, "Edge pairing on mesh \"%s\" (%u edges, %u runs):\n", mesh->name,
+								mesh->num_edges, num_runs);
+	for (int i = 0; i < 2; i++)
+	{
+		fprintf(file, "--> %s: %f ms per run\n", names[i],
+				(seconds[i] * 1000.0) / (num_runs ? num_runs : 1));
+	}
+	fprintf(file, "--> Mismatched other halves: %u\n", num_mismatches);
+
+	free(twins[0]);
+	free(twins[1]);
+	return 0;
+}
+
+int mp_mesh_benchmark_manifold_check(FILE *file, mp_mesh_t *mesh, uint32_t num_runs)
+{
+	const char *names[MP_CONNECTIVITY_NUM_PHASES] = { "Sort", "Degrees", "Duplicates",
+										"Triangle fans" };
+	double seconds[MP_CONNECTIVITY_NUM_PHASES] = { 0.0 };
+	char error_message[NM_MAX_ERROR_LENGTH];
+
+	for (uint32_t run = 0; run < num_runs; run++)
+	{
+		mp_mesh_connectivity_t connectivity;
+		if (mp_mesh_build_connectivity(mesh, &connectivity, 1, error_message)) { return -1; }
+		if (mp_mesh_check_manifold_from_connectivity(mesh, &connectivity, error_message))
+		{
+			mp_mesh_connectivity_free(&connectivity);
+			return -1;
+		}
+		for (int i = 0; i < MP_CONNECTIVITY_NUM_PHASES; i++)
+		{
+			seconds[i] += connectivity.phase_seconds[i];
+		}
+		mp_mesh_connectivity_free(&connectivity);
+	}
+
+	fprintf(file, "Manifold check on mesh \"%s\" (%u vertices, %u edges, %u runs):\n",
+				mesh->name, mesh->num_vertices, mesh->num_edges, num_runs);
+	for (int i = 0; i < MP_CONNECTIVITY_NUM_PHASES; i++)
+	{
+		fprintf(file, "--> %s: %f ms per run\n", names[i],
+				(seconds[i] * 1000.0) / (num_runs ? num_runs : 1));
+	}
+	fprintf(file, "--> Manifold: %s\n", mesh->is_manifold ? "Yes" : "No");
+
+	return 0;
+}
+
 void mp_mesh_print_short(FILE *file, mp_mesh_t *mesh)
 {
 	fprintf(file, "*******************\n");
@@ -371,46 +1056,47 @@ void mp_mesh_print(FILE *file, mp_mesh_t *mesh)
 {
 	mp_mesh_print_short(file, mesh);
 
-	if ((mesh->num_faces[0] > 0) && mesh->vertices && mesh->faces[0])
+	if ((mesh->num_faces[0] > 0) && (mp_mesh_is_soa(mesh) || (mesh->vertices && mesh->faces[0])))
 	{
+		mp_face_t face = mp_mesh_get_face(mesh, 0, 0);
+
 		fprintf(file, "\n");
 
 		fprintf(file, "Data for vertices in first face:\n");
 		for (int i = 0; i < 3; i++)
 		{
+			mp_position_t position = mp_mesh_get_position(mesh, face.p[i]);
 			fprintf(file, "Vertex %d:\n", i);
-			fprintf(file, "--> Position %u: %f, %f, %f\n", mesh->faces[0][0].p[i],
-				mesh->vertices[mesh->faces[0][0].p[i]].x,
-				mesh->vertices[mesh->faces[0][0].p[i]].y,
-				mesh->vertices[mesh->faces[0][0].p[i]].z);
-			fprintf(file, "--> Normal %u: %d, %d, %d\n", mesh->faces[0][0].n[i],
-				mesh->normals[mesh->faces[0][0].n[i]].x,
-				mesh->normals[mesh->faces[0][0].n[i]].y,
-				mesh->normals[mesh->faces[0][0].n[i]].z);
-			fprintf(file, "--> Colour %u: %u, %u, %u, %u\n", mesh->faces[0][0].c[i],
-				mesh->colours[mesh->faces[0][0].c[i]].r,
-				mesh->colours[mesh->faces[0][0].c[i]].g,
-				mesh->colours[mesh->faces[0][0].c[i]].b,
-				mesh->colours[mesh->faces[0][0].c[i]].a);
-			fprintf(file, "--> UV coordinates %u: %f, %f\n", mesh->faces[0][0].u[i],
-				mesh->uv_coordinates[mesh->faces[0][0].u[i]].u,
-				mesh->uv_coordinates[mesh->faces[0][0].u[i]].v);
+			fprintf(file, "--> Position %u: %f, %f, %f\n", face.p[i],
+				position.x, position.y, position.z);
+			float normal[3];
+			mp_mesh_decode_normal(mesh->normals[face.n[i]], normal);
+			fprintf(file, "--> Normal %u: %f, %f, %f\n", face.n[i],
+				normal[0], normal[1], normal[2]);
+			fprintf(file, "--> Colour %u: %u, %u, %u, %u\n", face.c[i],
+				mesh->colours[face.c[i]].r,
+				mesh->colours[face.c[i]].g,
+				mesh->colours[face.c[i]].b,
+				mesh->colours[face.c[i]].a);
+			fprintf(file, "--> UV coordinates %u: %f, %f\n", face.u[i],
+				mesh->uv_coordinates[face.u[i]].u,
+				mesh->uv_coordinates[face.u[i]].v);
 			fprintf(file, "--> First edge: %d\n", mesh->first_edge[i]);
 		}
 
 		fprintf(file, "\nData for edges in first face:\n");
 		for (int i = 0; i < 3; i++)
 		{
+			int64_t other_half = mp_mesh_get_edge_other_half(mesh, i);
 			fprintf(file, "Edge %d:\n", i);
-			fprintf(file, "--> From vertex %u to %u\n", mesh->edges[i].from,
-								mesh->edges[i].to);
-			fprintf(file, "--> Next edge: %u\n", mesh->edges[i].next);
+			fprintf(file, "--> From vertex %u to %u\n", mp_mesh_get_edge_from(mesh, i),
+								mp_mesh_get_edge_to(mesh, i));
+			fprintf(file, "--> Next edge: %u\n", mp_mesh_get_edge_next(mesh, i));
 			fprintf(file, "--> Face: %u\n", (i - (i % 3)) / 3);
-			fprintf(file, "--> Other half: %ld\n", mesh->edges[i].other_half);
-			if (mesh->edges[i].other_half != -1)
+			fprintf(file, "--> Other half: %ld\n", other_half);
+			if (other_half != -1)
 			{
-				fprintf(file, "--> Other face: %ld\n", (mesh->edges[i].other_half -
-							(mesh->edges[i].other_half % 3)) / 3);
+				fprintf(file, "--> Other face: %ld\n", (other_half - (other_half % 3)) / 3);
 			}
 			else
 			{
@@ -2,12 +2,26 @@
 #define MP_MESH_H
 
 #include <NM-Config/Config.h>
+#include <SDL2/SDL_timer.h>
 
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "File.h"
+
+// Options for mp_mesh_load(), set in mp_mesh_t.flags before loading:
+#define MP_MESH_FLAG_PARALLEL_OBJ_LOADER	(1 << 0)
+#define MP_MESH_FLAG_NO_FILE_MAPPING		(1 << 1)
+#define MP_MESH_FLAG_NO_CACHE			(1 << 2)
+#define MP_MESH_FLAG_HASH_EDGE_PAIRING		(1 << 3)
+#define MP_MESH_FLAG_COMPACT_EDGES		(1 << 4)	// Store twins only, not mp_edge_t.
+#define MP_MESH_FLAG_STRUCTURE_OF_ARRAYS	(1 << 5)	// Store mesh soa, not vertices/faces.
+#define MP_MESH_FLAG_WELD_VERTICES		(1 << 6)	// Merge positions within weld_epsilon.
+#define MP_MESH_FLAG_GENERATE_NORMALS		(1 << 7)	// If the file has none, by normal_weighting.
+#define MP_MESH_FLAG_QUANTISE_ATTRIBUTES	(1 << 8)	// Fill mesh quantised, UVs as uv_format.
+
 typedef struct
 {
 	float x;
@@ -15,11 +29,22 @@ typedef struct
 	float z;
 } mp_position_t;
 
+/* Unit normal in octahedral encoding: the sphere is folded onto an octahedron, which is unfolded
+ * onto a square of two signed normalised components. Components are 16-bit, with a worst case
+ * error of about 0.004 degrees, or 8-bit when built with MP_NORMAL_OCT8, with about 0.95 degrees.
+ * Use mp_mesh_encode_normal() and mp_mesh_decode_normal() to convert: */
+#ifdef MP_NORMAL_OCT8
+typedef int8_t mp_normal_component_t;
+#define MP_NORMAL_COMPONENT_MAX	INT8_MAX
+#else
+typedef int16_t mp_normal_component_t;
+#define MP_NORMAL_COMPONENT_MAX	INT16_MAX
+#endif
+
 typedef struct
 {
-	int8_t x;
-	int8_t y;
-	int8_t z;
+	mp_normal_component_t x;
+	mp_normal_component_t y;
 } mp_normal_t;
 
 typedef struct
@@ -52,16 +77,136 @@ typedef struct
 	uint32_t u[3];
 } mp_face_t;
 
+/* Meshlet within a level's flat meshlet arrays. The normal cone is for backface culling: every
+ * face is back facing when dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff: */
+typedef struct
+{
+	uint32_t vertex_offset;		// First entry in the level's meshlet vertices.
+	uint32_t triangle_offset;	// First triangle in the level's meshlet triangles and faces.
+	uint16_t num_vertices;
+	uint16_t num_triangles;
+
+	float centre[3];		// Bounding sphere.
+	float radius;
+	float cone_apex[3];
+	float cone_axis[3];
+	float cone_cutoff;		// 1 when the faces spread too widely to cull.
+} mp_meshlet_t;
+
+typedef struct
+{
+	uint32_t num_meshlets;
+	mp_meshlet_t *meshlets;
+
+	uint32_t num_vertices;
+	uint32_t *vertices;		// Position index of each meshlet vertex.
+
+	uint32_t num_triangles;
+	uint8_t *triangles;		// Three local vertex indices per triangle.
+	uint32_t *faces;		// Level face of each triangle, for its attribute indices.
+} mp_mesh_meshlets_t;
+
+// Storage of quantised UVs:
+enum
+{
+	MP_UV_FORMAT_UNORM16,
+	MP_UV_FORMAT_HALF
+};
+
+/* 16-bit copies of positions and UVs, for streaming and upload. Each position component is
+ * minimum + q * scale across the mesh bounds, and unorm16 UVs likewise across the UV bounds: */
+typedef struct
+{
+	float position_minimum[3];
+	float position_scale[3];
+	uint16_t *positions;		// Three per vertex.
+
+	uint8_t uv_format;
+	float uv_minimum[2];		// Unorm16 only.
+	float uv_scale[2];
+	uint16_t *uv_coordinates;	// Two per UV.
+
+	float position_error;		// Largest distance from a position to its dequantised value.
+	float uv_error;			// Largest difference in a UV component.
+} mp_mesh_quantised_t;
+
+// Alignment of mesh arrays, and of the header in front of each allocated block:
+#define MP_MESH_ALIGNMENT	64
+#define MP_MESH_ZERO_BLOCK_SIZE	(1 << 20)
+
+/* Optional allocator hooks. "allocate" must return memory aligned to "alignment", and "free"
+ * receives the same size that was requested. Leave both NULL to use the system heap: */
+typedef struct
+{
+	void *(*allocate)(void *context, size_t size, size_t alignment);
+	void (*free)(void *context, void *memory, size_t size);
+	void *context;
+} mp_allocator_t;
+
+// Structure-of-arrays layout. Face index arrays hold three entries per face:
+typedef struct
+{
+	float *x;
+	float *y;
+	float *z;
+
+	uint32_t *p[NM_MAX_LOD_LEVELS];
+	uint32_t *n[NM_MAX_LOD_LEVELS];
+	uint32_t *c[NM_MAX_LOD_LEVELS];
+	uint32_t *u[NM_MAX_LOD_LEVELS];
+} mp_mesh_soa_t;
+
+// Distance between consecutive faces' position indices, in indices:
+#define MP_FACE_STRIDE	(sizeof(mp_face_t) / sizeof(uint32_t))
+
+// Marks a boundary edge in arrays of 32-bit edge indices:
+#define MP_EDGE_NONE	UINT32_MAX
+
+// Empty slot in the edge hash table. Not a valid (from, to) key, as indices are below UINT32_MAX:
+#define MP_EDGE_HASH_EMPTY	UINT64_MAX
+
+// Vertices per work chunk in the manifold check. Fan walks vary in cost, so chunks are dynamic:
+#define MP_MESH_MANIFOLD_CHUNK_SIZE	4096
+
+enum
+{
+	MP_CONNECTIVITY_PHASE_SORT,
+	MP_CONNECTIVITY_PHASE_DEGREES,
+	MP_CONNECTIVITY_PHASE_DUPLICATES,
+	MP_CONNECTIVITY_PHASE_TRIANGLE_FANS,
+	MP_CONNECTIVITY_NUM_PHASES
+};
+
+// Edge order and vertex degrees, built once and shared by edge calculation and manifold check:
+typedef struct
+{
+	uint32_t num_edges;
+	uint64_t *keys;			// Undirected (low, high) keys in sorted order.
+	uint32_t *sorted_edges;		// Edge indices in the same order, NULL if not sorted.
+	int64_t num_duplicate_edges;	// Repeated directed edges, or -1 if not yet known.
+
+	uint32_t num_vertices;
+	uint32_t *vertex_degrees;	// Outgoing edges per vertex.
+
+	double phase_seconds[MP_CONNECTIVITY_NUM_PHASES];	// Time spent in each phase.
+} mp_mesh_connectivity_t;
+
 typedef struct
 {
 	char name[NM_MAX_NAME_LENGTH];
 	char path[NM_MAX_PATH_LENGTH];
+	uint32_t flags;
+	float weld_epsilon;		// Set before loading with MP_MESH_FLAG_WELD_VERTICES.
+	uint32_t num_welded_vertices;	// Removed by welding.
+	uint8_t normal_weighting;	// Set before loading with MP_MESH_FLAG_GENERATE_NORMALS.
+	uint8_t uv_format;		// Set before loading with MP_MESH_FLAG_QUANTISE_ATTRIBUTES.
 
 	uint8_t is_manifold;
 
 	uint32_t num_vertices;
 	mp_position_t *vertices;
 
+	uint8_t has_normals;	// 0 if normals holds a single placeholder, as the file had none.
 	uint32_t num_normals;
 	mp_normal_t *normals;
 
@@ -72,19 +217,59 @@ typedef struct
 	mp_uv_t *uv_coordinates;
 
 	uint32_t num_edges;
-	mp_edge_t *edges;
+	mp_edge_t *edges;	// NULL with compact edges.
+	uint32_t *twins;	// Compact edges only: other half, or MP_EDGE_NONE on boundaries.
 	uint32_t *first_edge;	// Per vertex.
 
 	uint8_t num_lod_levels;
 	uint32_t num_faces[NM_MAX_LOD_LEVELS];
 	mp_face_t *faces[NM_MAX_LOD_LEVELS];
+	mp_mesh_meshlets_t meshlets[NM_MAX_LOD_LEVELS];	// Empty until built.
+
+	mp_mesh_soa_t soa;	// Replaces vertices and faces in structure-of-arrays layout.
+	mp_mesh_quantised_t quantised;	// Empty until quantised.
+
+	mp_allocator_t allocator;	// Set before loading, or leave zeroed for the system heap.
+	void *arena;			// Single block holding the arrays from mp_mesh_allocate().
+	size_t arena_size;
+
+	mp_file_t cache_file;	// Backs the arrays above when loaded from a cache.
 } mp_mesh_t;
 
 int mp_mesh_allocate(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
 void mp_mesh_free(mp_mesh_t *mesh);
+void *mp_mesh_allocate_block(mp_mesh_t *mesh, size_t size);
+void mp_mesh_free_block(mp_mesh_t *mesh, void *block);
+void mp_mesh_free_level(mp_mesh_t *mesh, uint8_t lod);
+void mp_mesh_free_meshlets(mp_mesh_t *mesh, uint8_t lod);
+void mp_mesh_free_quantised(mp_mesh_t *mesh);
+int mp_mesh_build_connectivity(mp_mesh_t *mesh, mp_mesh_connectivity_t *connectivity,
+				uint8_t sort_edges, char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_connectivity_free(mp_mesh_connectivity_t *connectivity);
 int mp_mesh_calculate_edges(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_calculate_edges_from_connectivity(mp_mesh_t *mesh,
+		mp_mesh_connectivity_t *connectivity, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_pair_edges(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+							uint32_t *twins, uint32_t flags);
+int mp_mesh_pair_edges_sort(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+								uint32_t *twins);
+int mp_mesh_sort_edges(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+						uint64_t *keys, uint32_t *order);
+void mp_mesh_pair_sorted_edges(const uint32_t *indices, uint32_t stride, uint32_t num_edges,
+			const uint64_t *keys, const uint32_t *order, uint32_t *twins);
+int mp_mesh_pair_edges_hash(const uint32_t *indices, uint32_t stride, uint32_t num_faces,
+						uint32_t *twins, uint32_t *num_duplicates);
+uint32_t mp_mesh_edge_hash_find(const uint64_t *keys, const uint32_t *values, uint64_t mask,
+										uint64_t key);
+
+int mp_mesh_convert_to_soa(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_convert_to_aos(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+void mp_mesh_soa_free(mp_mesh_t *mesh, mp_mesh_soa_t *soa);
+void mp_mesh_calculate_bounds(mp_mesh_t *mesh, mp_position_t *minimum, mp_position_t *maximum);
 
 int mp_mesh_check_manifold(mp_mesh_t *mesh, char error_message[NM_MAX_ERROR_LENGTH]);
+int mp_mesh_check_manifold_from_connectivity(mp_mesh_t *mesh,
+		mp_mesh_connectivity_t *connectivity, char error_message[NM_MAX_ERROR_LENGTH]);
 uint32_t mp_mesh_triangle_fan_check(mp_mesh_t *mesh, uint32_t vertex, uint32_t vertex_degree);
 uint32_t mp_mesh_get_edge_index(mp_edge_t *edge);
 int64_t mp_mesh_get_next_vertex_edge(mp_mesh_t *mesh, uint32_t vertex, uint32_t edge);
@@ -93,7 +278,115 @@ int64_t mp_mesh_get_previous_vertex_edge(mp_mesh_t *mesh, uint32_t vertex, uint3
 int mp_mesh_edge_qsort_compare_from(const void *a, const void *b);
 int mp_mesh_edge_qsort_compare_low_high(const void *a, const void *b);
 
+// Edge endpoints, from position indices of faces "stride" indices apart:
+static inline uint32_t mp_mesh_edge_from(const uint32_t *indices, uint32_t stride, uint32_t edge)
+{
+	return indices[((edge / 3) * stride) + (edge % 3)];
+}
+
+static inline uint32_t mp_mesh_edge_to(const uint32_t *indices, uint32_t stride, uint32_t edge)
+{
+	return indices[((edge / 3) * stride) + ((edge + 1) % 3)];
+}
+
+static inline size_t mp_mesh_align_size(size_t size)
+{
+	return (size + MP_MESH_ALIGNMENT - 1) & ~((size_t)MP_MESH_ALIGNMENT - 1);
+}
+
+// Layout accessors, for either array-of-structures or structure-of-arrays meshes:
+static inline uint8_t mp_mesh_is_soa(mp_mesh_t *mesh)
+{
+	return (mesh->soa.p[0] != NULL);
+}
+
+static inline const uint32_t *mp_mesh_get_position_indices(mp_mesh_t *mesh, uint8_t lod,
+										uint32_t *stride)
+{
+	if (mp_mesh_is_soa(mesh))
+	{
+		*stride = 3;
+		return mesh->soa.p[lod];
+	}
+	*stride = MP_FACE_STRIDE;
+	return mesh->faces[lod][0].p;
+}
+
+static inline uint32_t mp_mesh_get_face_vertex(mp_mesh_t *mesh, uint8_t lod, uint32_t face,
+										uint32_t corner)
+{
+	if (mp_mesh_is_soa(mesh)) { return mesh->soa.p[lod][(face * 3) + corner]; }
+	return mesh->faces[lod][face].p[corner];
+}
+
+static inline mp_face_t mp_mesh_get_face(mp_mesh_t *mesh, uint8_t lod, uint32_t face)
+{
+	if (!mp_mesh_is_soa(mesh)) { return mesh->faces[lod][face]; }
+
+	mp_face_t result;
+	for (int i = 0; i < 3; i++)
+	{
+		result.p[i] = mesh->soa.p[lod][(face * 3) + i];
+		result.n[i] = mesh->soa.n[lod][(face * 3) + i];
+		result.c[i] = mesh->soa.c[lod][(face * 3) + i];
+		result.u[i] = mesh->soa.u[lod][(face * 3) + i];
+	}
+	return result;
+}
+
+static inline mp_position_t mp_mesh_get_position(mp_mesh_t *mesh, uint32_t vertex)
+{
+	if (!mp_mesh_is_soa(mesh)) { return mesh->vertices[vertex]; }
+
+	mp_position_t result = { mesh->soa.x[vertex], mesh->soa.y[vertex], mesh->soa.z[vertex] };
+	return result;
+}
+
+/* Edge accessors, for either edge layout. In a triangle mesh, the face and next edge are implicit
+ * in the edge index, and the vertices can be read from the base level faces: */
+static inline uint32_t mp_mesh_get_edge_from(mp_mesh_t *mesh, uint32_t edge)
+{
+	if (mesh->edges) { return mesh->edges[edge].from; }
+	return mp_mesh_get_face_vertex(mesh, 0, edge / 3, edge % 3);
+}
+
+static inline uint32_t mp_mesh_get_edge_to(mp_mesh_t *mesh, uint32_t edge)
+{
+	if (mesh->edges) { return mesh->edges[edge].to; }
+	return mp_mesh_get_face_vertex(mesh, 0, edge / 3, (edge + 1) % 3);
+}
+
+static inline uint32_t mp_mesh_get_edge_next(mp_mesh_t *mesh, uint32_t edge)
+{
+	if (mesh->edges) { return mesh->edges[edge].next; }
+	return (edge - (edge % 3)) + ((edge + 1) % 3);
+}
+
+static inline int64_t mp_mesh_get_edge_other_half(mp_mesh_t *mesh, uint32_t edge)
+{
+	if (mesh->edges) { return mesh->edges[edge].other_half; }
+	if (mesh->twins[edge] == MP_EDGE_NONE) { return -1; }
+	return mesh->twins[edge];
+}
+
+static inline uint64_t mp_mesh_edge_hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+static inline double mp_mesh_get_seconds_since(uint64_t start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
 #ifdef MP_DEBUG
+int mp_mesh_benchmark_edge_pairing(FILE *file, mp_mesh_t *mesh, uint32_t num_runs);
+int mp_mesh_benchmark_manifold_check(FILE *file, mp_mesh_t *mesh, uint32_t num_runs);
 void mp_mesh_print_short(FILE *file, mp_mesh_t *mesh);
 void mp_mesh_print(FILE *file, mp_mesh_t *mesh);
 #endif
@@ -0,0 +1,119 @@
+#include "Sort.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+int mp_sort_radix_u64(uint64_t *keys, uint32_t *values, uint32_t count)
+{
+	if (count < 2) { return 0; }
+
+	uint32_t num_threads = 1;
+	#ifdef _OPENMP
+	if (count >= MP_SORT_PARALLEL_THRESHOLD) { num_threads = omp_get_max_threads(); }
+	#endif
+
+	uint64_t *temporary_keys = malloc(count * sizeof(uint64_t));
+	uint32_t *temporary_values = malloc(count * sizeof(uint32_t));
+	uint32_t *histograms = malloc(num_threads * MP_SORT_RADIX_BUCKETS * sizeof(uint32_t));
+	if (!temporary_keys || !temporary_values || !histograms)
+	{
+		if (temporary_keys) { free(temporary_keys); }
+		if (temporary_values) { free(temporary_values); }
+		if (histograms) { free(histograms); }
+		return -1;
+	}
+
+	// Digits that are the same for every key don't need a pass:
+	uint64_t all_or = 0;
+	uint64_t all_and = UINT64_MAX;
+	#pragma omp parallel for reduction(|:all_or) reduction(&:all_and)
+	for (uint32_t i = 0; i < count; i++)
+	{
+		all_or |= keys[i];
+		all_and &= keys[i];
+	}
+	uint64_t varying = all_or ^ all_and;
+
+	uint64_t *source_keys = keys;
+	uint32_t *source_values = values;
+	uint64_t *target_keys = temporary_keys;
+	uint32_t *target_values = temporary_values;
+	for (uint32_t shift = 0; shift < 64; shift += MP_SORT_RADIX_BITS)
+	{
+		if (!((varying >> shift) & (MP_SORT_RADIX_BUCKETS - 1))) { continue; }
+
+		mp_sort_radix_u64_pass(source_keys, source_values, target_keys, target_values,
+						count, shift, histograms, num_threads);
+
+		uint64_t *swap_keys = source_keys;
+		uint32_t *swap_values = source_values;
+		source_keys = target_keys;
+		source_values = target_values;
+		target_keys = swap_keys;
+		target_values = swap_values;
+	}
+
+	if (source_keys != keys)
+	{
+		memcpy(keys, source_keys, count * sizeof(uint64_t));
+		memcpy(values, source_values, count * sizeof(uint32_t));
+	}
+
+	free(temporary_keys);
+	free(temporary_values);
+	free(histograms);
+	return 0;
+}
+
+void mp_sort_radix_u64_pass(uint64_t *keys, uint32_t *values, uint64_t *keys_out,
+			uint32_t *values_out, uint32_t count, uint32_t shift,
+			uint32_t *histograms, uint32_t num_threads)
+{
+	// One histogram per thread, over a contiguous block each, so the scatter stays stable:
+	memset(histograms, 0, num_threads * MP_SORT_RADIX_BUCKETS * sizeof(uint32_t));
+
+	/* The team may be smaller than asked for (nested, dynamic or limited threads), so blocks are
+	 * split over the threads actually running. Histograms are sized for the largest team: */
+	#pragma omp parallel num_threads(num_threads)
+	{
+		uint32_t thread = 0;
+		uint32_t team_size = 1;
+		#ifdef _OPENMP
+		thread = omp_get_thread_num();
+		team_size = omp_get_num_threads();
+		#endif
+		uint32_t start = ((uint64_t)count * thread) / team_size;
+		uint32_t end = ((uint64_t)count * (thread + 1)) / team_size;
+
+		uint32_t *histogram = &(histograms[thread * MP_SORT_RADIX_BUCKETS]);
+		for (uint32_t i = start; i < end; i++)
+		{
+			histogram[(keys[i] >> shift) & (MP_SORT_RADIX_BUCKETS - 1)]++;
+		}
+
+		#pragma omp barrier
+		#pragma omp single
+		{
+			// Exclusive prefix sum over buckets, then threads within each bucket:
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < MP_SORT_RADIX_BUCKETS; bucket++)
+			{
+				for (uint32_t i = 0; i < team_size; i++)
+				{
+					uint32_t *entry = &(histograms[(i * MP_SORT_RADIX_BUCKETS) + bucket]);
+					uint32_t bucket_count = *entry;
+					*entry = offset;
+					offset += bucket_count;
+				}
+			}
+		}
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			uint32_t position = histogram[(keys[i] >> shift) & (MP_SORT_RADIX_BUCKETS - 1)]++;
+			keys_out[position] = keys[i];
+			values_out[position] = values[i];
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef MP_SORT_H
+#define MP_SORT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MP_SORT_RADIX_BITS		8
+#define MP_SORT_RADIX_BUCKETS		(1 << MP_SORT_RADIX_BITS)
+#define MP_SORT_PARALLEL_THRESHOLD	(1 << 16)
+
+int mp_sort_radix_u64(uint64_t *keys, uint32_t *values, uint32_t count);
+void mp_sort_radix_u64_pass(uint64_t *keys, uint32_t *values, uint64_t *keys_out,
+			uint32_t *values_out, uint32_t count, uint32_t shift,
+			uint32_t *histograms, uint32_t num_threads);
+
+#endif